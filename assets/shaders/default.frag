@@ -1,11 +1,20 @@
 #version 330 core
+#include "features.glsl"
+#include "lighting.glsl"
 // Output the fragment vector
 out vec4 FragColor;
 // inputs a vec3 from the vertex shader
 in vec3 color;
+#ifdef FACE_LIGHTING
+in vec3 viewPosition;
+#endif
 
 void main()
 {
+#ifdef FACE_LIGHTING
+    FragColor = vec4(lambert(color, viewPosition), 1.0);
+#else
     // Sets the fragment color to be the colors from the vertex shader.
     FragColor = vec4(color,1.0);
-}
\ No newline at end of file
+#endif
+}
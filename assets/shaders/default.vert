@@ -1,15 +1,52 @@
 #version 330 core
+#include "features.glsl"
+#include "frame.glsl"
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aColor;
+#ifdef INSTANCING
+// one InstanceData per instance, see InstanceBuffer.h
+layout (location = 2) in vec4 instancePositionScale;
+layout (location = 3) in vec4 instanceRotation;
+layout (location = 4) in vec4 instanceColor;
+#ifdef QUANTIZED_POSITIONS
+// the instance transform comes between this and the model matrix, so it can't be folded into the model matrix
+uniform mat4 positionTransform;
+#endif
+
+vec3 rotate(vec4 quaternion, vec3 vector)
+{
+    return vector + 2.0 * cross(quaternion.xyz, cross(quaternion.xyz, vector) + quaternion.w * vector);
+}
+#endif
 // output the color vector to the fragment shader
 out vec3 color;
-// uniforms to get the model, view, and projection matrix from the CPU
+#ifdef FACE_LIGHTING
+// the position in view space, the fragment shader gets the face normal from it
+out vec3 viewPosition;
+#endif
+// the model matrix from the CPU, the view and projection come from the Frame block
 uniform mat4 modelMatrix;
-uniform mat4 viewMatrix;
-uniform mat4 projectionMatrix;
 
 void main()
 {
-    gl_Position = projectionMatrix * viewMatrix * modelMatrix * vec4(aPos,1.0f);
+#ifdef INSTANCING
+    vec3 position = aPos;
+#ifdef QUANTIZED_POSITIONS
+    position = (positionTransform * vec4(position, 1.0)).xyz;
+#endif
+    position = rotate(instanceRotation, position * instancePositionScale.w) + instancePositionScale.xyz;
+    vec4 worldPosition = modelMatrix * vec4(position, 1.0);
+#else
+    vec4 worldPosition = modelMatrix * vec4(aPos,1.0f);
+#endif
+    // with view and projection already multiplied together, this is one matrix-vector product
+    gl_Position = viewProjectionMatrix * worldPosition;
+#ifdef FACE_LIGHTING
+    viewPosition = (viewMatrix * worldPosition).xyz;
+#endif
+#ifdef INSTANCING
+    color = aColor * instanceColor.rgb;
+#else
     color = aColor;
-}
\ No newline at end of file
+#endif
+}
@@ -0,0 +1,6 @@
+// Included by both stages so they agree on what a variant passes between them. The feature defines are
+// added by the ShaderLibrary.
+// lines have no face to light, so wireframe keeps the plain vertex colors
+#if defined(LIGHTING_LAMBERT) && !defined(WIREFRAME)
+#define FACE_LIGHTING
+#endif
@@ -0,0 +1,10 @@
+// The values that are the same for every draw in a frame, from one uniform buffer shared by every program.
+// std140 so the layout is FrameUniforms in FrameUniforms.h.
+layout (std140) uniform Frame
+{
+    mat4 viewMatrix;
+    mat4 projectionMatrix;
+    mat4 viewProjectionMatrix;
+    vec4 viewport;
+    float time;
+};
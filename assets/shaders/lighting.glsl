@@ -0,0 +1,13 @@
+#ifdef FACE_LIGHTING
+// the light is in view space, a little above and to the right of the camera, so it stays put while the shape turns
+const vec3 LIGHT_DIRECTION = normalize(vec3(0.3, 0.5, 1.0));
+const float AMBIENT = 0.25;
+
+vec3 lambert(vec3 albedo, vec3 viewPosition)
+{
+    // the position changes along the face, so its derivatives give the flat normal without storing any normals
+    vec3 normal = normalize(cross(dFdx(viewPosition), dFdy(viewPosition)));
+    float diffuse = max(dot(normal, LIGHT_DIRECTION), 0.0);
+    return albedo * (AMBIENT + (1.0 - AMBIENT) * diffuse);
+}
+#endif
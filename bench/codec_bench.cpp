@@ -0,0 +1,76 @@
+/* Compresses the vertices and indices of a generated icosphere with MeshCodec and reports the compression
+ * ratio and how fast the streams decode on 1, 2, 4 ... threads up to the number of hardware threads.
+ *
+ * Usage: codec_bench [icosphere frequency, default 400]
+ */
+#include "../include/MeshCodec.h"
+#include "../include/MeshOptimizer.h"
+#include "../include/ShapeGenerator.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+static double secondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char **argv)
+{
+    std::uint32_t frequency = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 400;
+
+    // welded and in fetch order like shapecook writes them, without the slower cache pass
+    GeneratedMesh mesh = generatePolyhedron({PolyhedronType::Icosahedron, frequency, true});
+    weldVertices(mesh.vertices, mesh.indices, 0.0f);
+    optimizeVertexFetch(mesh.vertices, mesh.indices);
+    std::size_t vertexCount = mesh.vertices.size() / 6;
+    std::size_t vertexBytes = mesh.vertices.size() * sizeof(float);
+    std::size_t indexBytes = mesh.indices.size() * sizeof(std::uint32_t);
+    std::printf("input: %zu vertices, %zu indices, %.1f MB\n", vertexCount, mesh.indices.size(), (vertexBytes + indexBytes) / 1e6);
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::uint8_t> vertexStream = encodeVertexStream(mesh.vertices.data(), vertexCount, 6 * sizeof(float));
+    std::vector<std::uint8_t> indexStream = encodeIndexStream(mesh.indices.data(), mesh.indices.size());
+    double encodeSeconds = secondsSince(start);
+    std::printf("%-10s %10.3f MB -> %8.3f MB  ratio %6.2f\n", "vertices", vertexBytes / 1e6, vertexStream.size() / 1e6,
+                static_cast<double>(vertexBytes) / vertexStream.size());
+    std::printf("%-10s %10.3f MB -> %8.3f MB  ratio %6.2f\n", "indices", indexBytes / 1e6, indexStream.size() / 1e6,
+                static_cast<double>(indexBytes) / indexStream.size());
+    std::printf("encode: %.3f s, %.2f GB/s on the shared pool\n\n", encodeSeconds, (vertexBytes + indexBytes) / encodeSeconds / 1e9);
+
+    std::vector<float> vertices(mesh.vertices.size());
+    std::vector<std::uint32_t> indices(mesh.indices.size());
+    std::size_t hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+    std::printf("%8s %12s %12s\n", "threads", "decode ms", "GB/s");
+    // doubling each time and finishing on the hardware thread count
+    for (std::size_t threads = 1;; threads = std::min(threads * 2, hardwareThreads))
+    {
+        // ParallelFor runs on the caller as well, so the pool needs one thread less than the count
+        std::unique_ptr<ThreadPool> pool = threads > 1 ? std::make_unique<ThreadPool>(threads - 1) : nullptr;
+        double best = 1e9;
+        for (int repeat = 0; repeat < 5; repeat++)
+        {
+            start = std::chrono::steady_clock::now();
+            decodeVertexStream(vertexStream.data(), vertexStream.size(), vertices.data(), vertexCount, 6 * sizeof(float), pool.get());
+            decodeIndexStream(indexStream.data(), indexStream.size(), indices.data(), indices.size(), pool.get());
+            best = std::min(best, secondsSince(start));
+        }
+        std::printf("%8zu %12.2f %12.2f\n", threads, best * 1e3, (vertexBytes + indexBytes) / best / 1e9);
+        if (threads == hardwareThreads)
+        {
+            break;
+        }
+    }
+
+    if (std::memcmp(vertices.data(), mesh.vertices.data(), vertexBytes) != 0 || indices != mesh.indices)
+    {
+        std::printf("decoded data does not match the input\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,84 @@
+/* Culls bounding spheres scattered around a camera against its frustum with each instruction set the CPU
+ * supports, on one thread and across the shared thread pool, and reports microseconds per million spheres.
+ * Every run is checked against the scalar result.
+ *
+ * Usage: cull_bench [largest sphere count, default 10000000]
+ */
+#include "../include/FrustumCulling.h"
+#include "../include/Meshlet.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+// A column major perspective projection times a view that looks down -z from the origin.
+static MeshletFrustum makeFrustum(float fovY, float aspect, float nearPlane, float farPlane)
+{
+    float f = 1.0f / std::tan(fovY / 2.0f);
+    float viewProjection[16] = {f / aspect, 0.0f, 0.0f, 0.0f,
+                                0.0f, f, 0.0f, 0.0f,
+                                0.0f, 0.0f, (farPlane + nearPlane) / (nearPlane - farPlane), -1.0f,
+                                0.0f, 0.0f, 2.0f * farPlane * nearPlane / (nearPlane - farPlane), 0.0f};
+    float camera[3] = {0.0f, 0.0f, 0.0f};
+    return makeMeshletFrustum(viewProjection, camera);
+}
+
+int main(int argc, char **argv)
+{
+    std::size_t largest = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10000000;
+    MeshletFrustum frustum = makeFrustum(0.8f, 16.0f / 9.0f, 0.1f, 100.0f);
+    std::mt19937 random(1234);
+    std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+    std::uniform_real_distribution<float> size(0.1f, 2.0f);
+
+    std::printf("%10s %8s %8s %8s %10s %12s\n", "spheres", "visible", "isa", "threads", "us", "us per 1M");
+    for (std::size_t count = 1000; count <= largest; count *= 10)
+    {
+        BoundingSpheres spheres;
+        spheres.Resize(count);
+        for (std::size_t i = 0; i < count; i++)
+        {
+            float center[3] = {position(random), position(random), position(random)};
+            spheres.Set(i, center, size(random));
+        }
+        FrustumCuller reference;
+        reference.setIsa(CullingIsa::Scalar);
+        reference.setThreaded(false);
+        std::vector<std::uint32_t> expected = reference.Cull(spheres, frustum.planes);
+
+        for (int isa = 0; isa < static_cast<int>(CullingIsa::Count); isa++)
+        {
+            if (!isCullingIsaSupported(static_cast<CullingIsa>(isa)))
+            {
+                continue;
+            }
+            for (bool threaded : {false, true})
+            {
+                FrustumCuller culler;
+                culler.setIsa(static_cast<CullingIsa>(isa));
+                culler.setThreaded(threaded);
+                // repeat small counts so the timing means something, and keep the fastest run
+                int repeats = static_cast<int>(std::clamp<std::size_t>(10000000 / count, 3, 1000));
+                double best = 1e30;
+                for (int i = 0; i < repeats; i++)
+                {
+                    culler.Cull(spheres, frustum.planes);
+                    best = std::min(best, culler.getStats().microseconds);
+                }
+                if (culler.Cull(spheres, frustum.planes) != expected)
+                {
+                    std::printf("%s culled differently from scalar at %zu spheres\n",
+                                getCullingIsaName(static_cast<CullingIsa>(isa)), count);
+                    return 1;
+                }
+                const CullingStats &stats = culler.getStats();
+                std::printf("%10zu %8zu %8s %8zu %10.1f %12.1f\n", count, stats.visible, getCullingIsaName(stats.isa),
+                            stats.threads, best, best * 1e6 / count);
+            }
+        }
+    }
+    return 0;
+}
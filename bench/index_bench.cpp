@@ -0,0 +1,47 @@
+/* Narrows the index buffer of synthetic meshes of increasing size and reports which index type was
+ * picked, the bytes saved against 32-bit indices and how fast the narrowing runs.
+ *
+ * Usage: index_bench [largest vertex count, default 10000000]
+ */
+#include "../include/IndexFormat.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+int main(int argc, char **argv)
+{
+    std::size_t largest = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10000000;
+    std::mt19937 random(1234);
+
+    std::printf("%10s %10s %8s %12s %12s %8s %10s\n", "vertices", "indices", "type", "32-bit MB", "packed MB", "saved", "GB/s");
+    for (std::size_t vertexCount = 8; vertexCount <= largest; vertexCount *= 8)
+    {
+        // about two triangles per vertex like a closed mesh
+        std::size_t indexCount = vertexCount * 6;
+        std::vector<GLuint> indices(indexCount);
+        std::uniform_int_distribution<GLuint> distribution(0, static_cast<GLuint>(vertexCount - 1));
+        for (GLuint &index : indices)
+        {
+            index = distribution(random);
+        }
+
+        // repeat small meshes so the timing means something
+        int repeats = static_cast<int>(std::max<std::size_t>(1, 10000000 / indexCount));
+        PackedIndices packed;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < repeats; i++)
+        {
+            packed = packIndices(indices.data(), indexCount, vertexCount);
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / repeats;
+
+        double wideBytes = indexCount * sizeof(GLuint);
+        std::printf("%10zu %10zu %8s %12.3f %12.3f %7.0f%% %10.2f\n", vertexCount, indexCount, getIndexTypeName(packed.type),
+                    wideBytes / 1e6, packed.data.size() / 1e6, 100.0 * (1.0 - packed.data.size() / wideBytes),
+                    wideBytes / seconds / 1e9);
+    }
+    return 0;
+}
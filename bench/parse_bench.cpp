@@ -0,0 +1,83 @@
+/* Compares the operator>> loop the Shape loader used to have against parseFloats on a synthetic
+ * vertex file.
+ *
+ * Usage: parse_bench [float count, default 100000000]
+ */
+#include "../include/MeshParser.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+static double secondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void report(const char *name, std::size_t bytes, std::size_t count, double seconds)
+{
+    std::printf("%-24s %10zu floats %8.3f s %8.3f GB/s\n", name, count, seconds, bytes / seconds / 1e9);
+}
+
+int main(int argc, char **argv)
+{
+    std::size_t floatCount = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100000000;
+
+    // six floats per line laid out like the files in assets/data/Vertices
+    std::string text;
+    text.reserve(floatCount * 10);
+    std::mt19937 random(1234);
+    std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+    char number[32];
+    for (std::size_t i = 0; i < floatCount; i++)
+    {
+        int length = std::snprintf(number, sizeof(number), "%.5f", distribution(random));
+        text.append(number, length);
+        text.push_back((i % 6 == 5) ? '\n' : ' ');
+    }
+    std::filesystem::path path = std::filesystem::temp_directory_path() / "parse_bench_vertices.txt";
+    {
+        std::ofstream file(path, std::ios::binary);
+        file.write(text.data(), text.size());
+    }
+    std::printf("input: %zu floats, %.1f MB\n", floatCount, text.size() / 1e6);
+
+    // the old loader
+    auto start = std::chrono::steady_clock::now();
+    std::vector<float> expected;
+    {
+        std::ifstream file(path);
+        float value;
+        while (file >> value)
+        {
+            expected.emplace_back(value);
+        }
+    }
+    report("iostream", text.size(), expected.size(), secondsSince(start));
+
+    start = std::chrono::steady_clock::now();
+    std::vector<float> serial = parseFloats(text, nullptr);
+    report("from_chars 1 thread", text.size(), serial.size(), secondsSince(start));
+
+    start = std::chrono::steady_clock::now();
+    std::vector<float> parallel = parseFloats(text);
+    report("from_chars pool", text.size(), parallel.size(), secondsSince(start));
+
+    start = std::chrono::steady_clock::now();
+    std::vector<float> fromFile = readVertexFile(path.c_str());
+    report("readVertexFile", text.size(), fromFile.size(), secondsSince(start));
+
+    std::filesystem::remove(path);
+    if (serial != expected || parallel != expected || fromFile != expected)
+    {
+        std::cerr << "parsed values don't match the iostream loader" << std::endl;
+        return 1;
+    }
+    std::printf("pool threads: %zu\n", ThreadPool::getShared().getThreadCount());
+    return 0;
+}
@@ -0,0 +1,45 @@
+/* Packs a synthetic mesh into every vertex format and reports the size, the bandwidth saved against
+ * Float32 and the largest position error. GPU draw time for the same formats is shown in the demo under
+ * "Vertex Format".
+ *
+ * Usage: vertex_format_bench [vertex count, default 10000000]
+ */
+#include "../include/VertexFormat.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+int main(int argc, char **argv)
+{
+    std::size_t vertexCount = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10000000;
+
+    // positions spread over a few units like a scaled up shape, colors in [0, 1]
+    std::vector<float> vertices(vertexCount * 6);
+    std::mt19937 random(1234);
+    std::uniform_real_distribution<float> position(-4.0f, 4.0f);
+    std::uniform_real_distribution<float> color(0.0f, 1.0f);
+    for (std::size_t v = 0; v < vertexCount; v++)
+    {
+        for (int i = 0; i < 3; i++)
+        {
+            vertices[v * 6 + i] = position(random);
+            vertices[v * 6 + 3 + i] = color(random);
+        }
+    }
+
+    double floatBytes = static_cast<double>(vertexCount) * getVertexLayout(VertexFormat::Float32).stride;
+    std::printf("%zu vertices\n", vertexCount);
+    std::printf("%-10s %6s %10s %10s %12s %10s\n", "format", "stride", "MB", "vs Float32", "max error", "pack ms");
+    for (int f = 0; f < static_cast<int>(VertexFormat::Count); f++)
+    {
+        VertexFormat format = static_cast<VertexFormat>(f);
+        auto start = std::chrono::steady_clock::now();
+        PackedVertices packed = packVertices(vertices.data(), vertexCount, format);
+        double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::printf("%-10s %6d %10.1f %9.0f%% %12.3g %10.1f\n", getVertexFormatName(format), getVertexLayout(format).stride,
+                    packed.data.size() / 1e6, 100.0 * packed.data.size() / floatBytes, packed.maxPositionError, milliseconds);
+    }
+    return 0;
+}
@@ -0,0 +1,136 @@
+#ifndef ASSET_PACK_H
+#define ASSET_PACK_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+/*
+ * Every asset in one file so startup maps a single file instead of opening each asset on its own. The file is
+ * a header, a table of contents sorted by name hash, the names, and then the payloads, each starting on an
+ * ASSET_PACK_ALIGNMENT boundary so cooked meshes can be used straight out of the mapping. Names are the asset
+ * paths relative to the assets folder, like "data/Meshes/cube.mesh".
+ */
+
+// "SHPK" when read as little endian bytes
+constexpr std::uint32_t ASSET_PACK_MAGIC = 0x4B504853;
+constexpr std::uint32_t ASSET_PACK_VERSION = 1;
+constexpr std::size_t ASSET_PACK_ALIGNMENT = 4096;
+
+enum class AssetType : std::uint32_t
+{
+    Other = 0,
+    Vertices,
+    Indices,
+    Mesh,
+    Shader
+};
+
+struct AssetPackHeader
+{
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint32_t entryCount;
+    std::uint32_t flags;
+    std::uint64_t tocOffset;
+    std::uint64_t nameOffset;
+    std::uint64_t nameBytes;
+    std::uint8_t reserved[24];
+};
+static_assert(sizeof(AssetPackHeader) == 64, "AssetPackHeader must stay 64 bytes");
+
+struct AssetPackEntry
+{
+    std::uint64_t nameHash;
+    std::uint64_t offset;
+    std::uint64_t size;
+    // the name is in the name table so hash collisions can be told apart
+    std::uint32_t nameOffset;
+    std::uint32_t nameLength;
+    std::uint32_t type;
+    std::uint32_t padding;
+};
+static_assert(sizeof(AssetPackEntry) == 40, "AssetPackEntry must stay 40 bytes");
+
+// FNV-1a of the name, which is what the table of contents is sorted by.
+std::uint64_t assetNameHash(std::string_view name);
+AssetType getAssetType(std::string_view name);
+const char *getAssetTypeName(AssetType type);
+
+// A file to put in a pack, read from path and stored under name.
+struct AssetPackSource
+{
+    std::string name;
+    std::string path;
+};
+
+// Every file under root, named by its path relative to root. Hidden files are skipped.
+std::vector<AssetPackSource> listAssetFiles(const char *root);
+// Writes the sources to path. Throws if a file can't be read or two sources have the same name.
+void writeAssetPack(const char *path, const std::vector<AssetPackSource> &sources);
+
+/*
+ * A read only memory mapping of a pack. The table of contents is validated against the file size when it
+ * is opened so every payload it hands out is in range.
+ */
+class AssetPack
+{
+    private:
+        void *mapping = nullptr;
+        std::size_t mappingSize = 0;
+        const AssetPackHeader *header = nullptr;
+        const AssetPackEntry *entries = nullptr;
+        const char *names = nullptr;
+    public:
+        explicit AssetPack(const char *path);
+        ~AssetPack();
+        AssetPack(const AssetPack &) = delete;
+        AssetPack &operator=(const AssetPack &) = delete;
+
+        // Binary searches the table of contents. Returns nullptr if the pack has no asset with that name.
+        const AssetPackEntry *find(std::string_view name) const;
+        std::string_view getContents(const AssetPackEntry &entry) const;
+        std::string_view getName(const AssetPackEntry &entry) const;
+        std::size_t getCount() const;
+        const AssetPackEntry *getEntries() const;
+};
+
+/*
+ * The pack the loaders look in before going to the disk. Paths under the root it was mounted with are
+ * looked up in the pack and anything else, or anything the pack doesn't have, is read from the loose files.
+ */
+class AssetPackMount
+{
+    private:
+        std::optional<AssetPack> pack;
+        std::string root;
+        // loose files that were edited after the pack was built, these are read from disk from then on
+        std::unordered_set<std::string> overridden;
+        mutable std::mutex mutex;
+
+        std::optional<std::string_view> relativeName(std::string_view path) const;
+    public:
+        // The mount every loader uses.
+        static AssetPackMount &getShared();
+
+        // Maps the pack at packPath for the assets under root. Returns false and leaves nothing mounted if
+        // there is no pack or it can't be read, so the loose files are used.
+        bool Mount(const char *packPath, const char *assetRoot);
+        void Unmount();
+        // Reads path from the disk from now on, for hot reloading a file that is also in the pack.
+        void Override(const std::string &path);
+
+        // The contents of path in the pack. They stay valid until Unmount.
+        std::optional<std::string_view> find(const char *path) const;
+        // Whether path is in the pack or on the disk.
+        bool exists(const char *path) const;
+        bool isMounted() const;
+        std::size_t getCount() const;
+};
+
+#endif
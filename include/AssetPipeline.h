@@ -0,0 +1,128 @@
+#ifndef ASSET_PIPELINE_H
+#define ASSET_PIPELINE_H
+
+#include "ThreadPool.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+// The stages an asset goes through while it loads. Wait is the time spent queued for the render thread.
+enum class LoadStage
+{
+    Read,
+    Parse,
+    Optimize,
+    Wait,
+    Upload,
+    Total,
+    Count
+};
+
+const char *getLoadStageName(LoadStage stage);
+
+/*
+ * A latency histogram with power of two buckets in microseconds. Samples can be recorded from any thread.
+ */
+class LatencyHistogram
+{
+    public:
+        // bucket i counts samples below 2^i microseconds, the last bucket also counts everything above it
+        static constexpr std::size_t BUCKET_COUNT = 24;
+
+        void Record(std::chrono::steady_clock::duration duration);
+
+        std::uint64_t getCount();
+        double getMeanMicroseconds();
+        double getMaxMicroseconds();
+        // An upper bound for the given percentile (0 to 1) taken from the bucket edges.
+        double getPercentileMicroseconds(double percentile);
+        std::array<float, BUCKET_COUNT> getBuckets();
+    private:
+        std::mutex mutex;
+        std::array<std::uint64_t, BUCKET_COUNT> buckets{};
+        std::uint64_t count = 0;
+        double sumMicroseconds = 0.0;
+        double maxMicroseconds = 0.0;
+};
+
+/*
+ * The return type of asset loading coroutines. They start running straight away and clean themselves up
+ * when they finish, so the caller never has to hold on to anything.
+ */
+struct LoadTask
+{
+    struct promise_type
+    {
+        LoadTask get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception();
+    };
+};
+
+/*
+ * Moves loading coroutines between the worker threads and the render thread. File reading and parsing
+ * co_await ResumeOnWorker(), anything that touches OpenGL co_awaits ResumeOnRenderThread() and is resumed
+ * from Pump() which the render loop calls once per frame with a time budget.
+ */
+class AssetPipeline
+{
+    private:
+        ThreadPool &pool;
+        std::mutex mutex;
+        std::deque<std::coroutine_handle<>> renderQueue;
+        std::atomic<int> inFlight{0};
+        std::atomic<bool> cancelled{false};
+        std::array<LatencyHistogram, static_cast<std::size_t>(LoadStage::Count)> histograms;
+    public:
+        // Counts a coroutine as in flight for as long as it is alive.
+        class Ticket
+        {
+            private:
+                AssetPipeline *pipeline;
+            public:
+                explicit Ticket(AssetPipeline &pipeline);
+                ~Ticket();
+                Ticket(const Ticket &) = delete;
+                Ticket &operator=(const Ticket &) = delete;
+        };
+
+        struct WorkerAwaiter
+        {
+            ThreadPool &pool;
+            bool await_ready() { return false; }
+            void await_suspend(std::coroutine_handle<> handle);
+            void await_resume() {}
+        };
+
+        struct RenderThreadAwaiter
+        {
+            AssetPipeline &pipeline;
+            bool await_ready() { return false; }
+            void await_suspend(std::coroutine_handle<> handle);
+            // false once the pipeline is shutting down, the coroutine should stop without touching OpenGL
+            bool await_resume();
+        };
+
+        explicit AssetPipeline(ThreadPool &pool = ThreadPool::getShared());
+
+        WorkerAwaiter ResumeOnWorker();
+        RenderThreadAwaiter ResumeOnRenderThread();
+        void Record(LoadStage stage, std::chrono::steady_clock::duration duration);
+
+        // Resumes render thread work until the queue is empty or the budget is used up. Returns how many ran.
+        std::size_t Pump(std::chrono::steady_clock::duration budget);
+        // Cancels everything still loading and waits for the coroutines to finish. Call before deleting GL objects.
+        void Shutdown();
+
+        int getInFlight();
+        LatencyHistogram &getHistogram(LoadStage stage);
+};
+
+#endif
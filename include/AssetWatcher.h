@@ -0,0 +1,44 @@
+#ifndef ASSET_WATCHER_H
+#define ASSET_WATCHER_H
+
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// A file that was written, with the time the watcher saw the write.
+struct AssetChange
+{
+    std::string path;
+    std::chrono::steady_clock::time_point detected;
+};
+
+/*
+ * Watches asset directories with inotify on a background thread. Files that are written in place or
+ * renamed over (which is how most editors save) are queued until the render loop calls Poll().
+ */
+class AssetWatcher
+{
+    private:
+        int inotifyFd = -1;
+        int stopFd = -1;
+        std::map<int, std::string> watches;
+        std::thread thread;
+        std::mutex mutex;
+        std::vector<AssetChange> changes;
+
+        void run();
+    public:
+        explicit AssetWatcher(const std::vector<std::string> &directories);
+        ~AssetWatcher();
+        AssetWatcher(const AssetWatcher &) = delete;
+        AssetWatcher &operator=(const AssetWatcher &) = delete;
+
+        // Returns and clears the changes seen since the last call, each path at most once.
+        std::vector<AssetChange> Poll();
+        bool isWatching();
+};
+
+#endif
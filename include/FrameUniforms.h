@@ -0,0 +1,48 @@
+#ifndef FRAME_UNIFORMS_H
+#define FRAME_UNIFORMS_H
+
+#include "glad/glad.h"
+#include "StreamRing.h"
+#include <glm/glm.hpp>
+#include <cstddef>
+
+// The uniform buffer binding the Frame block in assets/shaders/frame.glsl reads from.
+constexpr GLuint FRAME_UNIFORM_BINDING = 0;
+constexpr const char *FRAME_UNIFORM_BLOCK = "Frame";
+
+// The std140 layout of the Frame block, so it can be copied into the buffer as it is.
+struct FrameUniforms
+{
+    glm::mat4 viewMatrix;
+    glm::mat4 projectionMatrix;
+    // projection * view, so the vertex shader has one matrix fewer to multiply by for every vertex
+    glm::mat4 viewProjectionMatrix;
+    // x, y, width and height in pixels
+    glm::vec4 viewport;
+    // seconds since the demo started
+    float time;
+    float padding[3];
+};
+static_assert(sizeof(glm::mat4) == 64 && sizeof(glm::vec4) == 16, "glm types don't match std140");
+static_assert(offsetof(FrameUniforms, viewport) == 192 && offsetof(FrameUniforms, time) == 208 &&
+              sizeof(FrameUniforms) == 224, "FrameUniforms doesn't match the std140 layout of the Frame block");
+
+/*
+ * The Frame block shared by every program for the values that are the same for the whole frame. Each frame
+ * writes them into its region of the stream ring, so the CPU never writes over uniforms the GPU is still
+ * reading. Programs find the block through the binding, set by Shader::SetBlockBinding.
+ */
+class FrameUniformBuffer
+{
+    private:
+        StreamRing &stream;
+        // GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+        GLsizeiptr alignment = 1;
+    public:
+        explicit FrameUniformBuffer(StreamRing &stream);
+        // Writes uniforms into the stream and binds them to FRAME_UNIFORM_BINDING. Call once a frame after
+        // StreamRing::BeginFrame() and before drawing.
+        void Update(const FrameUniforms &uniforms);
+};
+
+#endif
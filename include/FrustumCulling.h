@@ -0,0 +1,84 @@
+#ifndef FRUSTUM_CULLING_H
+#define FRUSTUM_CULLING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// The instruction sets the culling loop is built for, picked at runtime from what the CPU has.
+enum class CullingIsa
+{
+    Scalar,
+    SSE4,
+    AVX2,
+    Count
+};
+
+// Spheres are stored this many to a block, the widest loop tests one block per iteration.
+constexpr std::size_t CULLING_BLOCK = 8;
+// Below this many spheres the culling stays on the calling thread.
+constexpr std::size_t CULLING_PARALLEL_THRESHOLD = 1 << 16;
+
+const char *getCullingIsaName(CullingIsa isa);
+bool isCullingIsaSupported(CullingIsa isa);
+// The widest instruction set the CPU supports.
+CullingIsa getBestCullingIsa();
+
+/*
+ * Bounding spheres in structure of arrays form, so each load fills a register with the same coordinate of
+ * CULLING_BLOCK spheres. The arrays are padded to a whole block with spheres that are never visible.
+ */
+class BoundingSpheres
+{
+    private:
+        std::vector<float> centerX, centerY, centerZ, radius;
+        std::size_t count = 0;
+    public:
+        void Resize(std::size_t count);
+        void Set(std::size_t index, const float *center, float radius);
+
+        std::size_t getCount() const;
+        const float *getCenterX() const;
+        const float *getCenterY() const;
+        const float *getCenterZ() const;
+        const float *getRadius() const;
+};
+
+struct CullingStats
+{
+    std::size_t tested = 0;
+    std::size_t visible = 0;
+    std::size_t culled = 0;
+    double microseconds = 0.0;
+    // microseconds scaled to a million spheres, so different counts can be compared
+    double microsecondsPerMillion = 0.0;
+    CullingIsa isa = CullingIsa::Scalar;
+    // threads the last Cull() was split across, the calling thread included
+    std::size_t threads = 1;
+};
+
+/*
+ * Tests bounding spheres against the six planes of a frustum and keeps the indices of the ones that are at
+ * least partly inside, in order. The planes point inwards and are normalized, as makeMeshletFrustum makes
+ * them. Large counts are split into chunks across the shared thread pool, each chunk compacting into its own
+ * part of the output before the parts are joined.
+ */
+class FrustumCuller
+{
+    private:
+        CullingIsa isa = getBestCullingIsa();
+        bool threaded = true;
+        std::vector<std::uint32_t> visible;
+        std::vector<std::size_t> chunkVisible;
+        CullingStats stats;
+    public:
+        // The indices of the visible spheres, valid until the next call.
+        const std::vector<std::uint32_t> &Cull(const BoundingSpheres &spheres, const float (&planes)[6][4]);
+        // Falls back to the widest supported instruction set at or below isa.
+        void setIsa(CullingIsa isa);
+        CullingIsa getIsa();
+        void setThreaded(bool threaded);
+        const CullingStats &getStats();
+};
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef GL_STATE_CACHE_H
+#define GL_STATE_CACHE_H
+
+#include "glad/glad.h"
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+/*
+ * The fixed function state a pass draws with. A RenderState can't be changed after it is made, a different
+ * state is a new one, so a pass can bake its state once and GLStateCache::Apply() it every frame for free.
+ */
+class RenderState
+{
+    private:
+        GLenum polygonMode;
+        bool cullFace;
+        bool multisample;
+        bool depthTest;
+    public:
+        RenderState(GLenum polygonMode = GL_FILL, bool cullFace = true, bool multisample = true, bool depthTest = true);
+
+        GLenum getPolygonMode() const;
+        bool isCullFace() const;
+        bool isMultisample() const;
+        bool isDepthTest() const;
+};
+
+struct GLStateStats
+{
+    // state calls made to the cache
+    std::size_t submitted = 0;
+    // the ones that didn't reach GL because the state was already set
+    std::size_t filtered = 0;
+};
+
+/*
+ * Remembers the GL state that goes through it and drops calls that wouldn't change anything. State starts
+ * out unknown, so the first call for each piece always reaches GL. Code that changes state behind the
+ * cache's back has to put it back or call Invalidate(), the ImGui renderer puts back everything it changes.
+ * Everything here has to run on the thread with the GL context.
+ */
+class GLStateCache
+{
+    private:
+        // capabilities that have been enabled or disabled, with whether they are on
+        std::vector<std::pair<GLenum, bool>> capabilities;
+        GLenum polygonMode = GL_FILL;
+        bool polygonModeKnown = false;
+        GLuint program = 0;
+        bool programKnown = false;
+        GLStateStats stats;
+
+        // Whether a call has to be made, counting it either way.
+        bool submit(bool changed);
+    public:
+        static GLStateCache &getShared();
+
+        void setEnabled(GLenum capability, bool enabled);
+        void Enable(GLenum capability);
+        void Disable(GLenum capability);
+        // Always for GL_FRONT_AND_BACK, which is the only face core profile allows.
+        void PolygonMode(GLenum mode);
+        void UseProgram(GLuint program);
+        // Sets only the parts of state that differ from what is set now.
+        void Apply(const RenderState &state);
+        // Call when program is deleted, a new program can get the same name.
+        void ForgetProgram(GLuint program);
+        // Forgets everything, the next call for each piece of state reaches GL again.
+        void Invalidate();
+
+        const GLStateStats &getStats();
+        void resetStats();
+};
+
+#endif
@@ -0,0 +1,128 @@
+#ifndef GEOMETRY_ARENA_H
+#define GEOMETRY_ARENA_H
+
+#include "glad/glad.h"
+#include "StreamRing.h"
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+class InstanceBuffer;
+
+/*
+ * First fit allocator over a range of [0, capacity) elements. Freed blocks are merged with their neighbors,
+ * so a range that is allocated and freed in any order ends up as one block again.
+ */
+class FreeList
+{
+    private:
+        // offset to size, sorted so neighbors can be found when a block is freed
+        std::map<std::size_t, std::size_t> blocks;
+        std::size_t capacity = 0;
+        std::size_t freeSize = 0;
+    public:
+        // Everything after used is free.
+        void Reset(std::size_t capacity, std::size_t used = 0);
+        // The offset of size free elements, or SIZE_MAX if no block is big enough.
+        std::size_t Allocate(std::size_t size);
+        void Free(std::size_t offset, std::size_t size);
+
+        std::size_t getCapacity();
+        std::size_t getFreeSize();
+        std::size_t getLargestBlock();
+        std::size_t getBlockCount();
+};
+
+// An allocation in the arena, valid until it is removed.
+using ArenaHandle = std::uint32_t;
+constexpr ArenaHandle INVALID_ARENA_HANDLE = UINT32_MAX;
+
+// The layout glMultiDrawElementsIndirect reads.
+struct DrawElementsIndirectCommand
+{
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+static_assert(sizeof(DrawElementsIndirectCommand) == 20, "DrawElementsIndirectCommand is read by the GPU");
+
+struct GeometryArenaStats
+{
+    // in vertices and indices, not bytes
+    std::size_t vertexCapacity = 0;
+    std::size_t verticesUsed = 0;
+    std::size_t indexCapacity = 0;
+    std::size_t indicesUsed = 0;
+    std::size_t allocations = 0;
+    // free blocks in the vertex and index buffers, more than one each means the arena is fragmented
+    std::size_t freeBlocks = 0;
+    // times the allocations were packed together, which also happens whenever the buffers grow
+    std::size_t defragmentations = 0;
+    // what the last DrawQueued() drew and how many draw calls it took
+    std::size_t draws = 0;
+    std::size_t drawCalls = 0;
+};
+
+/*
+ * Every shape's vertices and indices in one vertex buffer and one index buffer behind one VAO, so any number
+ * of shapes can be drawn without binding anything in between. Vertices are always the Float32 format and
+ * indices 32-bit, and each shape's indices stay relative to its first vertex, which is passed as the base
+ * vertex. Draws are queued with AddDraw() and DrawQueued() issues all of them with one
+ * glMultiDrawElementsIndirect. Contexts older than 4.3 fall back to a glDrawElementsInstancedBaseVertex per
+ * draw, still without binding anything in between.
+ */
+class GeometryArena
+{
+    private:
+        struct Allocation
+        {
+            std::size_t vertexOffset = 0;
+            std::size_t vertexCount = 0;
+            std::size_t indexOffset = 0;
+            std::size_t indexCount = 0;
+            bool live = false;
+        };
+        GLuint VAO = 0, VBO = 0, EBO = 0, indirectBuffer = 0;
+        GLsizeiptr indirectCapacity = 0;
+        FreeList vertexBlocks;
+        FreeList indexBlocks;
+        std::vector<Allocation> allocations;
+        std::vector<ArenaHandle> freeHandles;
+        std::vector<DrawElementsIndirectCommand> commands;
+        // the instance buffer the VAO's instance attributes point at, and from which instance
+        std::uint64_t instanceBufferId = 0;
+        GLsizei boundFirstInstance = 0;
+        GeometryArenaStats stats;
+
+        // Moves every allocation into new buffers of the given capacities, packed from the start.
+        void relocate(std::size_t vertexCapacity, std::size_t indexCapacity);
+        // Makes room for the allocation, compacting if there is enough free space and growing if there isn't.
+        void reserve(std::size_t vertexCount, std::size_t indexCount);
+    public:
+        // The buffers start at these sizes, in vertices and indices, and double whenever they are full.
+        static constexpr std::size_t INITIAL_VERTEX_CAPACITY = 1 << 16;
+        static constexpr std::size_t INITIAL_INDEX_CAPACITY = 1 << 18;
+
+        // Copies a mesh into the arena. vertices are 6 floats each and every index must be below the vertex
+        // count. The buffers are made on the first call, so an arena can be declared before the GL context.
+        ArenaHandle Add(const GLfloat *vertices, std::size_t vertexFloatCount, const GLuint *indices, std::size_t indexCount);
+        void Remove(ArenaHandle handle);
+        // Packs every allocation at the start of the buffers so the free space is one block again.
+        void Defragment();
+        // Queues indexCount indices from firstIndex of the mesh, drawn for instanceCount instances starting at
+        // baseInstance of the instance buffer given to DrawQueued(). Throws if handle isn't live.
+        void AddDraw(ArenaHandle handle, GLuint firstIndex, GLuint indexCount, GLuint instanceCount = 1, GLuint baseInstance = 0);
+        // Draws and clears the queue with the instance attributes read from instances. The indirect commands
+        // are written into this frame's region of stream.
+        void DrawQueued(InstanceBuffer &instances, StreamRing &stream);
+        void Delete();
+
+        // Whether DrawQueued() can draw everything with one call.
+        static bool isIndirectSupported();
+        GeometryArenaStats getStats();
+};
+
+#endif
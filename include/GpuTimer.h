@@ -0,0 +1,29 @@
+#ifndef GPU_TIMER_H
+#define GPU_TIMER_H
+
+#include "glad/glad.h"
+
+/*
+ * Measures GPU time between Begin() and End() with timer queries. The result is read a couple of frames
+ * later so asking for it never makes the CPU wait for the GPU.
+ */
+class GpuTimer
+{
+    private:
+        static constexpr int QUERY_COUNT = 3;
+        GLuint queries[QUERY_COUNT];
+        bool pending[QUERY_COUNT] = {};
+        int current = 0;
+        bool skipped = false;
+        double lastMicroseconds = 0.0;
+    public:
+        GpuTimer();
+        void Begin();
+        void End();
+        void Delete();
+
+        // The most recent result that the GPU has finished.
+        double getMicroseconds();
+};
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef INDEX_FORMAT_H
+#define INDEX_FORMAT_H
+
+#include "glad/glad.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+ * Index buffers are stored with the smallest type that can address every vertex of the mesh:
+ * GL_UNSIGNED_BYTE up to 256 vertices, GL_UNSIGNED_SHORT up to 65536 and GL_UNSIGNED_INT above that.
+ */
+
+struct PackedIndices
+{
+    GLenum type = GL_UNSIGNED_INT;
+    std::vector<std::uint8_t> data;
+};
+
+GLenum chooseIndexType(std::size_t vertexCount);
+std::size_t getIndexSize(GLenum type);
+const char *getIndexTypeName(GLenum type);
+
+// Narrows indexCount indices to the type chooseIndexType picks for vertexCount. Throws std::out_of_range if any
+// index isn't below vertexCount.
+PackedIndices packIndices(const GLuint *indices, std::size_t indexCount, std::size_t vertexCount);
+std::vector<GLuint> unpackIndices(const PackedIndices &packed);
+
+#endif
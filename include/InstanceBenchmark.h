@@ -0,0 +1,46 @@
+#ifndef INSTANCE_BENCHMARK_H
+#define INSTANCE_BENCHMARK_H
+
+#include <cstddef>
+#include <vector>
+
+struct InstanceBenchmarkResult
+{
+    std::size_t instances;
+    // means over the measured frames
+    double frameMilliseconds;
+    // CPU time spent issuing the instanced draw
+    double submitMicroseconds;
+    double gpuMicroseconds;
+};
+
+/*
+ * Steps the instance count from 1 up to a maximum, 1, 3, 10, 30 and so on, and averages the frame time,
+ * CPU submission time and GPU time of each step. The demo draws getInstanceCount() instances every frame and
+ * hands the times to Record().
+ */
+class InstanceBenchmark
+{
+    private:
+        // frames thrown away after the count changes, while the new instances are uploaded and drivers settle
+        static constexpr std::size_t WARMUP_FRAMES = 10;
+        static constexpr std::size_t MEASURED_FRAMES = 60;
+        std::vector<std::size_t> counts;
+        std::size_t step = 0;
+        std::size_t frame = 0;
+        bool running = false;
+        InstanceBenchmarkResult sum = {};
+        std::vector<InstanceBenchmarkResult> results;
+    public:
+        void Start(std::size_t maxInstances);
+        void Stop();
+        // Adds one frame's times. Moves on to the next count when this one has enough frames.
+        void Record(double frameMilliseconds, double submitMicroseconds, double gpuMicroseconds);
+
+        bool isRunning();
+        std::size_t getInstanceCount();
+        // finished steps, in order
+        const std::vector<InstanceBenchmarkResult> &getResults();
+};
+
+#endif
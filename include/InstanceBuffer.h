@@ -0,0 +1,65 @@
+#ifndef INSTANCE_BUFFER_H
+#define INSTANCE_BUFFER_H
+
+#include "glad/glad.h"
+#include "StreamRing.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// The first vertex attribute location the instance data uses, the shape's own attributes are 0 and 1.
+constexpr GLuint INSTANCE_ATTRIBUTE_LOCATION = 2;
+
+/*
+ * Where one instance of a shape is drawn, read by the INSTANCING variant of default.vert. 36 bytes, so a
+ * million instances fit in 36 MB.
+ */
+struct InstanceData
+{
+    float position[3];
+    // the same in every direction
+    float scale;
+    // a unit quaternion, x, y, z, w
+    float rotation[4];
+    // multiplies the vertex colors, normalized
+    std::uint8_t color[4];
+};
+static_assert(sizeof(InstanceData) == 36, "InstanceData is read by the vertex shader with a 36 byte stride");
+
+// A cube of count instances in [-1, 1], each with a random rotation and color, the same for the same seed.
+std::vector<InstanceData> makeInstanceField(std::size_t count, std::uint32_t seed = 1);
+// How big each instance of makeInstanceField(count) is.
+float getInstanceFieldScale(std::size_t count);
+
+/*
+ * A buffer of per instance attributes. Shape::DrawInstanced points its VAO at the buffer with a divisor of
+ * one, so each instance reads the next InstanceData. Instances that change every frame can be streamed
+ * through a StreamRing instead, and are then read from there until the next Update or Stream.
+ */
+class InstanceBuffer
+{
+    private:
+        GLuint buffer = 0;
+        GLsizeiptr capacity = 0;
+        GLsizei count = 0;
+        // where the attributes are read from, the buffer itself or a stream ring region
+        GLuint source = 0;
+        GLintptr sourceOffset = 0;
+        // tells shapes apart from an earlier buffer that got the same name, changes whenever the source moves
+        std::uint64_t id;
+    public:
+        InstanceBuffer();
+        // Replaces every instance. The storage is orphaned first, so the GPU can keep drawing the old ones.
+        void Update(const std::vector<InstanceData> &instances);
+        // Writes the instances into this frame's region of stream, falling back to Update() if it is full.
+        void Stream(StreamRing &stream, const std::vector<InstanceData> &instances);
+        // Sets up the instance attributes in the bound VAO, so instance 0 of a draw reads firstInstance.
+        void BindAttributes(GLsizei firstInstance = 0);
+        void Delete();
+
+        GLsizei getCount();
+        std::uint64_t getId();
+        GLsizeiptr getSizeInBytes();
+};
+
+#endif
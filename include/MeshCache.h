@@ -0,0 +1,84 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include "MeshFile.h"
+#include "MeshSimplifier.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*
+ * Keeps the cooked result of every text mesh on disk so the next launch can map it instead of parsing and
+ * optimizing the text again. Entries are mesh files named by a hash of the source bytes, the settings that
+ * change the result and MESH_CACHE_VERSION. Anything that changes the output of the text path has to bump
+ * MESH_CACHE_VERSION so old entries stop matching.
+ *
+ * The modification time of an entry is its last use. When the cache grows past its size limit the entries
+ * that were used longest ago are deleted.
+ */
+
+constexpr std::uint32_t MESH_CACHE_VERSION = 1;
+constexpr std::uint64_t MESH_CACHE_DEFAULT_LIMIT = 256ull * 1024 * 1024;
+
+struct MeshCacheStats
+{
+    std::size_t hits = 0;
+    std::size_t misses = 0;
+    std::size_t stores = 0;
+    std::size_t evictions = 0;
+};
+
+// What the cache takes up on disk.
+struct MeshCacheUsage
+{
+    std::size_t entries = 0;
+    std::uint64_t bytes = 0;
+};
+
+// $XDG_CACHE_HOME/GraphicsDemo/<subdirectory>, or under ~/.cache when that isn't set. Shared by the caches.
+std::string getCacheDirectory(const char *subdirectory);
+
+class MeshCache
+{
+    private:
+        std::string directory;
+        std::atomic<std::uint64_t> limit;
+        std::atomic<std::size_t> hits{0};
+        std::atomic<std::size_t> misses{0};
+        std::atomic<std::size_t> stores{0};
+        std::atomic<std::size_t> evictions{0};
+        // eviction walks the whole directory, only one thread does it at a time
+        std::mutex evictionMutex;
+
+        std::string getPath(std::uint64_t key) const;
+        void Evict();
+    public:
+        // An empty directory uses getCacheDirectory("meshes").
+        explicit MeshCache(std::string directory = "", std::uint64_t limit = MESH_CACHE_DEFAULT_LIMIT);
+        MeshCache(const MeshCache &) = delete;
+        MeshCache &operator=(const MeshCache &) = delete;
+
+        static std::uint64_t makeKey(std::string_view verticesText, std::string_view indicesText, float weldEpsilon);
+
+        // Maps the entry for key, or returns nullptr on a miss. A corrupt entry is deleted and counts as a miss.
+        std::unique_ptr<MappedMesh> Open(std::uint64_t key);
+        // Writes the entry for key. The file is written next to the entry and renamed over it, so a reader
+        // never sees half an entry. Failing to write is not an error, the mesh just isn't cached.
+        void Store(std::uint64_t key, const std::vector<float> &vertices, const std::vector<std::uint32_t> &indices,
+                   const std::vector<LodLevel> &lods);
+        // Deletes every entry.
+        void Clear();
+
+        void setLimit(std::uint64_t bytes);
+        const std::string &getDirectory() const;
+        MeshCacheStats getStats() const;
+        // Walks the cache directory, so don't call it every frame.
+        MeshCacheUsage getUsage() const;
+};
+
+#endif
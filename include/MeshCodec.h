@@ -0,0 +1,42 @@
+#ifndef MESH_CODEC_H
+#define MESH_CODEC_H
+
+#include "ThreadPool.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+ * A lossless codec for the vertex and index blobs of cooked meshes. A stream is cut into blocks that are
+ * encoded and decoded on their own, so the blocks of a big mesh decode in parallel straight into the buffer
+ * that gets uploaded.
+ *
+ * Each block is filtered first so the LZ stage has something to find. Indices become the zigzagged
+ * difference from the index before them. Vertices become the difference from the same 32-bit word of the
+ * vertex before them, and the bytes are then split into planes so byte 0 of every vertex comes first, then
+ * byte 1 and so on. After optimizeVertexFetch neighboring vertices are close together, so most high bytes
+ * end up in long runs of zeros.
+ */
+
+// Vertices and indices per block. Blocks are small enough to stay in L2 while they are filtered.
+constexpr std::size_t MESH_CODEC_BLOCK_VERTICES = 4096;
+constexpr std::size_t MESH_CODEC_BLOCK_INDICES = 16384;
+
+// vertexSize has to be a multiple of 4 bytes.
+std::vector<std::uint8_t> encodeVertexStream(const void *vertices, std::size_t vertexCount, std::size_t vertexSize,
+                                             ThreadPool *pool = &ThreadPool::getShared());
+std::vector<std::uint8_t> encodeIndexStream(const std::uint32_t *indices, std::size_t indexCount,
+                                            ThreadPool *pool = &ThreadPool::getShared());
+
+// Decode into destination, which must have room for the whole mesh. Throws std::runtime_error if the stream
+// is corrupt or doesn't hold exactly that many vertices or indices.
+void decodeVertexStream(const void *stream, std::size_t streamSize, void *destination, std::size_t vertexCount,
+                        std::size_t vertexSize, ThreadPool *pool = &ThreadPool::getShared());
+void decodeIndexStream(const void *stream, std::size_t streamSize, std::uint32_t *destination, std::size_t indexCount,
+                       ThreadPool *pool = &ThreadPool::getShared());
+
+// The LZ stage on its own. lzDecompress throws if the input would write past outputSize or doesn't fill it.
+std::vector<std::uint8_t> lzCompress(const std::uint8_t *input, std::size_t size);
+void lzDecompress(const std::uint8_t *input, std::size_t size, std::uint8_t *output, std::size_t outputSize);
+
+#endif
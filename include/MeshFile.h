@@ -0,0 +1,113 @@
+#ifndef MESH_FILE_H
+#define MESH_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+ * A binary container for a cooked mesh. The file is a fixed size header followed by the vertex blob, the
+ * index blob and the LOD table, each starting on a MESH_FILE_ALIGNMENT boundary so they can be uploaded
+ * straight out of a memory mapping. The index blob holds every LOD level back to back. Compressed files store
+ * the two blobs as MeshCodec streams instead, which are decoded when the file is opened.
+ */
+
+// "SHPM" when read as little endian bytes
+constexpr std::uint32_t MESH_FILE_MAGIC = 0x4D504853;
+// version 2 added the LOD table and version 3 compression, version 1 files are still read as a single level
+constexpr std::uint32_t MESH_FILE_VERSION = 3;
+constexpr std::size_t MESH_FILE_ALIGNMENT = 64;
+// the vertex and index blobs are MeshCodec streams, vertexBytes and indexBytes are the stream sizes
+constexpr std::uint32_t MESH_FILE_COMPRESSED = 1;
+
+enum class MeshVertexLayout : std::uint32_t
+{
+    // 3 floats of position followed by 3 floats of color, the same layout as the text files
+    PositionColorF32 = 0
+};
+
+struct MeshFileHeader
+{
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint32_t vertexLayout;
+    std::uint32_t vertexStride;
+    std::uint32_t indexSize;
+    std::uint32_t flags;
+    std::uint64_t vertexCount;
+    std::uint64_t indexCount;
+    std::uint64_t vertexOffset;
+    std::uint64_t vertexBytes;
+    std::uint64_t indexOffset;
+    std::uint64_t indexBytes;
+    float boundsMin[3];
+    float boundsMax[3];
+    // FNV-1a over the vertex blob, the index blob and then the LOD table
+    std::uint64_t checksum;
+    std::uint32_t lodCount;
+    std::uint32_t lodPadding;
+    std::uint64_t lodOffset;
+    std::uint8_t reserved[8];
+};
+static_assert(sizeof(MeshFileHeader) == 128, "MeshFileHeader must stay 128 bytes");
+
+struct MeshFileLod
+{
+    // in indices from the start of the index blob
+    std::uint64_t indexOffset;
+    std::uint64_t indexCount;
+    float error;
+    std::uint32_t padding;
+};
+static_assert(sizeof(MeshFileLod) == 24, "MeshFileLod must stay 24 bytes");
+
+std::uint64_t meshChecksum(const void *data, std::size_t size, std::uint64_t seed = 0xcbf29ce484222325ull);
+
+// Writes a position/color mesh to path. vertices holds 6 floats per vertex. Without lods the whole index
+// blob is one level.
+void writeMeshFile(const char *path, const float *vertices, std::size_t vertexFloatCount,
+                   const std::uint32_t *indices, std::size_t indexCount,
+                   const MeshFileLod *lods = nullptr, std::size_t lodCount = 0, bool compress = false);
+
+/*
+ * A read only memory mapping of a mesh file. The header is validated against the file size when it is
+ * opened so the blob pointers are always in range. A compressed file is decoded across the shared thread
+ * pool when it is opened, and the data pointers then point at the decoded copy. Every index is checked
+ * against the vertex count once the data is decoded, so a mesh that opens can be uploaded as it is.
+ */
+class MappedMesh
+{
+    private:
+        void *mapping = nullptr;
+        std::size_t mappingSize = 0;
+        const MeshFileHeader *header = nullptr;
+        // false when the mesh lives in the mounted asset pack, which owns the mapping
+        bool ownsMapping = true;
+        std::vector<float> decodedVertices;
+        std::vector<std::uint32_t> decodedIndices;
+
+        void validate(const char *path);
+        void decode(const char *path);
+        void checkIndices(const char *path);
+        const void *getStoredVertexData() const;
+        const void *getStoredIndexData() const;
+    public:
+        // Uses the mesh from the mounted asset pack if it is there, otherwise maps the file.
+        explicit MappedMesh(const char *path);
+        ~MappedMesh();
+        MappedMesh(const MappedMesh &) = delete;
+        MappedMesh &operator=(const MappedMesh &) = delete;
+
+        // Checks the blobs as they are stored in the file, before any decoding.
+        bool verifyChecksum() const;
+        bool isCompressed() const;
+
+        const MeshFileHeader &getHeader() const;
+        const void *getVertexData() const;
+        const void *getIndexData() const;
+        // Empty for a version 1 file.
+        const MeshFileLod *getLods() const;
+        std::size_t getLodCount() const;
+};
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+ * Reorders triangle lists for the GPU. Vertices are the usual 6 floats (position then color) and
+ * indices are 32-bit triangle lists. Nothing here changes what is drawn, only the order it is drawn in.
+ */
+
+// The size of the FIFO cache used to measure ACMR/ATVR.
+constexpr std::size_t VERTEX_CACHE_SIZE = 16;
+// Vertices whose position and color all round to the same multiple of this are welded into one.
+constexpr float WELD_EPSILON = 1e-5f;
+// How far a cluster's ACMR can rise above the cache optimized order before overdraw sorting stops splitting it.
+constexpr float OVERDRAW_THRESHOLD = 1.05f;
+
+struct VertexCacheStats
+{
+    std::size_t misses = 0;
+    // average cache misses per triangle, 0.5 is the best a regular mesh can do and 3 the worst
+    float acmr = 0.0f;
+    // average transforms per vertex, 1 is ideal
+    float atvr = 0.0f;
+};
+
+struct WeldReport
+{
+    std::size_t verticesRemoved = 0;
+    // bytes of float vertex data removed, the saving on the GPU depends on the vertex format
+    std::size_t bytesRemoved = 0;
+};
+
+struct MeshOptimizationReport
+{
+    WeldReport weld;
+    VertexCacheStats before;
+    VertexCacheStats after;
+};
+
+/*
+ * Merges vertices with the same position and color in one pass over a hash table, remaps the indices and
+ * drops the merged vertices. An epsilon of 0 only merges exact duplicates. Values are snapped to a grid of
+ * epsilon, so two vertices closer than epsilon that land either side of a grid line are kept apart.
+ */
+WeldReport weldVertices(std::vector<float> &vertices, std::vector<std::uint32_t> &indices, float epsilon = WELD_EPSILON);
+
+VertexCacheStats analyzeVertexCache(const std::uint32_t *indices, std::size_t indexCount, std::size_t vertexCount,
+                                    std::size_t cacheSize = VERTEX_CACHE_SIZE);
+
+// Tom Forsyth's linear-speed vertex cache optimization.
+void optimizeVertexCache(std::uint32_t *indices, std::size_t indexCount, std::size_t vertexCount);
+
+/*
+ * Splits the cache optimized order into clusters and sorts them so clusters facing away from the mesh
+ * center are drawn first, which lets early depth testing reject more of what is drawn after them.
+ */
+void optimizeOverdraw(std::uint32_t *indices, std::size_t indexCount, const float *vertices, std::size_t vertexCount,
+                      float threshold = OVERDRAW_THRESHOLD);
+
+// Renumbers vertices in the order the indices first use them and drops unused vertices.
+void optimizeVertexFetch(std::vector<float> &vertices, std::vector<std::uint32_t> &indices);
+
+// Welds the mesh, runs all three ordering passes and reports the cache statistics before and after. The
+// overdraw order is only kept if it stays within OVERDRAW_THRESHOLD of the cache optimized ACMR.
+MeshOptimizationReport optimizeMesh(std::vector<float> &vertices, std::vector<std::uint32_t> &indices,
+                                    float weldEpsilon = WELD_EPSILON);
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef MESH_PARSER_H
+#define MESH_PARSER_H
+
+#include "ThreadPool.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*
+ * Parsers for the whitespace separated Vertices/Indices text files. Whitespace is skipped 16 bytes at a
+ * time with SSE2 and the numbers are converted with std::from_chars. Large inputs are split at line
+ * boundaries and the chunks are parsed on the thread pool.
+ */
+
+// Inputs smaller than this are parsed on the calling thread.
+constexpr std::size_t PARALLEL_PARSE_THRESHOLD = 4 * 1024 * 1024;
+
+std::vector<float> parseFloats(std::string_view text, ThreadPool *pool = &ThreadPool::getShared());
+std::vector<std::uint32_t> parseIndices(std::string_view text, ThreadPool *pool = &ThreadPool::getShared());
+
+// Reads a whole file into memory. Throws std::runtime_error if it can't be read.
+std::string readTextFile(const char *path);
+
+// Read a whole file and parse it. Throws std::runtime_error if the file can't be read or has a bad token.
+std::vector<float> readVertexFile(const char *path);
+std::vector<std::uint32_t> readIndexFile(const char *path);
+
+#endif
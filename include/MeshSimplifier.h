@@ -0,0 +1,51 @@
+#ifndef MESH_SIMPLIFIER_H
+#define MESH_SIMPLIFIER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+ * Quadric error simplification for LOD chains. Every collapse moves a vertex onto one of its neighbours
+ * instead of making a new one, so all levels index the same vertex buffer and only the index ranges differ.
+ * Vertices are the usual 6 floats.
+ */
+
+// Each level aims for this fraction of the triangles of the level before it.
+constexpr float LOD_TRIANGLE_RATIO = 0.5f;
+// Level 0 included.
+constexpr std::size_t LOD_MAX_LEVELS = 6;
+// Meshes smaller than this are cheap enough that they don't get LODs.
+constexpr std::size_t LOD_MIN_TRIANGLES = 64;
+// The coarsest level that is picked is the one that strays from the full mesh by at most this many pixels.
+constexpr float LOD_PIXEL_ERROR = 1.0f;
+
+struct LodLevel
+{
+    std::uint32_t indexOffset;
+    std::uint32_t indexCount;
+    // how far this level's surface is from the full mesh's, in the same units as the positions
+    float error;
+};
+
+/*
+ * Simplifies a triangle list down to about targetIndexCount indices and returns the new indices. Vertices on
+ * a seam (the same position with a different color) are never moved so colors don't crack apart, and vertices
+ * on an open border only slide along it. error is set to the distance estimate for the result.
+ */
+std::vector<std::uint32_t> simplifyMesh(const float *vertices, std::size_t vertexCount, const std::uint32_t *indices,
+                                        std::size_t indexCount, std::size_t targetIndexCount, float &error);
+
+/*
+ * Appends progressively simpler copies of indices to the end of it and returns one level per copy, level 0
+ * being the original. Each new level is optimized for the vertex cache. A mesh under LOD_MIN_TRIANGLES, or
+ * one that won't simplify any further, gets fewer than LOD_MAX_LEVELS levels.
+ */
+std::vector<LodLevel> buildLodChain(const std::vector<float> &vertices, std::vector<std::uint32_t> &indices);
+
+// The coarsest level whose error is under LOD_PIXEL_ERROR when seen from distance away. pixelsPerUnit is how
+// many pixels tall one unit is at a distance of one, the viewport height over 2 tan(fov / 2).
+std::size_t selectLodLevel(const std::vector<LodLevel> &levels, float distance, float pixelsPerUnit,
+                           float maxPixelError = LOD_PIXEL_ERROR);
+
+#endif
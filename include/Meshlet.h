@@ -0,0 +1,50 @@
+#ifndef MESHLET_H
+#define MESHLET_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+ * Meshlets are small runs of triangles from a mesh's index buffer with bounds that are cheap to test, so
+ * whole runs can be skipped on the CPU before they reach the vertex shader. Vertices are the usual 6 floats.
+ */
+
+constexpr std::size_t MESHLET_MAX_VERTICES = 64;
+constexpr std::size_t MESHLET_MAX_TRIANGLES = 124;
+
+struct Meshlet
+{
+    // where the meshlet's triangles start in the index buffer and how many indices there are
+    std::uint32_t indexOffset;
+    std::uint32_t indexCount;
+    float center[3];
+    float radius;
+    // the average direction the triangles face, and the sine of the widest angle any of them faces away from it.
+    // A cutoff of 1 means the triangles face too many ways for the meshlet to ever be backface culled.
+    float coneAxis[3];
+    float coneCutoff;
+};
+
+// The 6 frustum planes and the camera position in the mesh's own space, so meshlet bounds can be tested as is.
+struct MeshletFrustum
+{
+    float planes[6][4];
+    float cameraPosition[3];
+};
+
+/*
+ * Splits the index buffer into meshlets without reordering it, each meshlet being the longest run of triangles
+ * that stays under MESHLET_MAX_VERTICES and MESHLET_MAX_TRIANGLES. Run it after optimizeMesh so the runs are
+ * spatially tight. Throws if an index is out of range.
+ */
+std::vector<Meshlet> buildMeshlets(const float *vertices, std::size_t vertexCount, const std::uint32_t *indices,
+                                   std::size_t indexCount);
+
+// modelViewProjection is a column major matrix, cameraPosition is already in model space.
+MeshletFrustum makeMeshletFrustum(const float *modelViewProjection, const float *cameraPosition);
+
+// False when the meshlet is outside the frustum, or, with coneCulling, when every triangle faces away.
+bool isMeshletVisible(const Meshlet &meshlet, const MeshletFrustum &frustum, bool coneCulling);
+
+#endif
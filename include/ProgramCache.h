@@ -0,0 +1,55 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include "glad/glad.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+struct ProgramCacheStats
+{
+    std::size_t hits = 0;
+    std::size_t misses = 0;
+    std::size_t stores = 0;
+    // binaries the driver refused, usually because it was updated since they were saved
+    std::size_t rejected = 0;
+};
+
+/*
+ * Saves linked programs with glGetProgramBinary so later runs can skip compiling and linking. Entries are
+ * keyed by a hash of the shader sources and the driver's vendor, renderer and version strings, because a
+ * binary only loads on the driver that made it. Does nothing when the driver has no binary formats.
+ * Everything here has to run on the thread with the GL context.
+ */
+class ProgramCache
+{
+    private:
+        std::string directory;
+        // read from the driver the first time the cache is used, once there is a context
+        std::string driver;
+        bool initialized = false;
+        bool supported = false;
+        ProgramCacheStats stats;
+
+        void initialize();
+        std::string getPath(std::uint64_t key) const;
+    public:
+        // An empty directory uses getCacheDirectory("programs").
+        explicit ProgramCache(std::string directory = "");
+
+        static ProgramCache &getShared();
+
+        bool isSupported();
+        std::uint64_t makeKey(std::string_view vertexCode, std::string_view fragmentCode);
+        // Creates a program from the saved binary for key. Returns 0 on a miss or if the driver rejects the
+        // binary, in which case the entry is deleted.
+        GLuint Load(std::uint64_t key);
+        // Saves the binary of a program that linked. The program has to be linked with
+        // GL_PROGRAM_BINARY_RETRIEVABLE_HINT set or some drivers return nothing.
+        void Store(std::uint64_t key, GLuint program);
+
+        const ProgramCacheStats &getStats() const;
+};
+
+#endif
@@ -2,7 +2,13 @@
 #define SHADER_CLASS_H
 
 #include <glad/glad.h>
+#include "ShaderCompiler.h"
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
 #include <string>
+#include <utility>
+#include <vector>
 #include <fstream>
 #include <sstream>
 #include <iostream>
@@ -10,14 +16,136 @@
 
 std::string get_file_contents(const char *filename);
 
+// An active uniform of the linked program, as glGetActiveUniform reports it. Arrays are named without the [0].
+struct ShaderUniformInfo
+{
+    std::string name;
+    GLint location;
+    GLenum type;
+    // the array length, 1 for anything that isn't an array
+    GLint size;
+};
+
+struct ShaderBlockInfo
+{
+    std::string name;
+    GLuint index;
+    GLint dataSize;
+    GLint binding;
+};
+
+// Counted over every Shader since the last resetUniformStats().
+struct UniformUploadStats
+{
+    std::size_t uploads = 0;
+    // Set() calls that didn't reach GL because the program already had the value
+    std::size_t skipped = 0;
+};
+
+// The GL type a Uniform<T> has to have in the shader.
+template <typename T> inline constexpr GLenum UNIFORM_TYPE = 0;
+template <> inline constexpr GLenum UNIFORM_TYPE<GLfloat> = GL_FLOAT;
+template <> inline constexpr GLenum UNIFORM_TYPE<GLint> = GL_INT;
+template <> inline constexpr GLenum UNIFORM_TYPE<glm::vec3> = GL_FLOAT_VEC3;
+template <> inline constexpr GLenum UNIFORM_TYPE<glm::vec4> = GL_FLOAT_VEC4;
+template <> inline constexpr GLenum UNIFORM_TYPE<glm::mat4> = GL_FLOAT_MAT4;
+
+/*
+ * A uniform of one Shader, looked up by name once. It stays valid when the program is rebuilt or reloaded,
+ * and setting a uniform that isn't active, or has another type in the shader, does nothing.
+ */
+template <typename T>
+struct Uniform
+{
+    std::size_t slot = SIZE_MAX;
+};
+
 class Shader
 {
     public:
         GLuint ID;
         Shader(const char *vertexPath, const char *fragmentPath);
+        // Submits the files to compiler and draws with its fallback program until Update() sees the real one
+        // is ready.
+        Shader(ShaderCompiler &compiler, const char *vertexPath, const char *fragmentPath);
+        // The same from sources that were already read, used by the ShaderLibrary for its variants.
+        Shader(ShaderCompiler &compiler, const char *name, const std::string &vertexCode, const std::string &fragmentCode);
 
         void Activate();
         void Delete();
+        // Rebuilds the program from the files. Returns false if they can't be read.
+        bool Reload();
+        // Starts building a new program from the sources on the compiler. The old program stays in use until
+        // Update() sees the new one is ready, and for good if it doesn't build. A Shader made without a
+        // compiler builds right away and returns false if the sources don't compile.
+        bool Rebuild(const std::string &vertexCode, const std::string &fragmentCode);
+        // Switches to the program from the compiler once it is ready. Returns true on the call that switches.
+        bool Update();
+        bool isReady();
+
+        const std::string &getVertexPath();
+        const std::string &getFragmentPath();
+        // How long the last build or reload took, and whether it came from the program binary cache.
+        double getBuildMilliseconds();
+        bool isFromProgramCache();
+
+        // What the linked program has, read once each time the program changes.
+        const std::vector<ShaderUniformInfo> &getActiveUniforms();
+        const std::vector<ShaderBlockInfo> &getActiveBlocks();
+        template <typename T>
+        Uniform<T> getUniform(const char *name)
+        {
+            static_assert(UNIFORM_TYPE<T> != 0, "There is no glUniform call for this type");
+            return {findSlot(name, UNIFORM_TYPE<T>)};
+        }
+        // Uploads to the program, which has to be active. A value the program already has isn't uploaded again.
+        void Set(Uniform<GLfloat> uniform, GLfloat value);
+        void Set(Uniform<GLint> uniform, GLint value);
+        void Set(Uniform<glm::vec3> uniform, const glm::vec3 &value);
+        void Set(Uniform<glm::vec4> uniform, const glm::vec4 &value);
+        void Set(Uniform<glm::mat4> uniform, const glm::mat4 &value);
+        static const UniformUploadStats &getUniformStats();
+        static void resetUniformStats();
+        // GLSL 330 can't give a block its binding, so every program with a block called blockName gets binding
+        // when it is linked. Set these before the first Shader is made.
+        static void SetBlockBinding(const char *blockName, GLuint binding);
+    private:
+        // A uniform that was asked for by name, with the value the program was last given.
+        struct UniformSlot
+        {
+            std::string name;
+            GLenum type;
+            GLint location = -1;
+            bool hasValue = false;
+            unsigned char value[sizeof(glm::mat4)] = {};
+        };
+        std::string vertexPath;
+        std::string fragmentPath;
+        double buildMilliseconds = 0.0;
+        bool fromProgramCache = false;
+        // the compiler that builds the program, with the job that is still building while pending is set
+        ShaderCompiler *compiler = nullptr;
+        std::string name;
+        CompileHandle compileHandle = 0;
+        bool pending = false;
+        // false while ID is the compiler's fallback, which the compiler deletes
+        bool ownsProgram = true;
+        std::vector<ShaderUniformInfo> uniforms;
+        std::vector<ShaderBlockInfo> blocks;
+        std::vector<UniformSlot> slots;
+        static UniformUploadStats uniformStats;
+        static std::vector<std::pair<std::string, GLuint>> blockBindings;
+
+        static GLuint compileShader(GLenum type, const char *source, const char *stageName);
+        // Returns 0 if either stage doesn't compile or the program doesn't link. Loads the program from the
+        // program binary cache when the same sources were built before on this driver.
+        GLuint buildProgram(const std::string &vertexCode, const std::string &fragmentCode);
+        // Lists the active uniforms and blocks of ID and finds the slots again. Called whenever ID changes.
+        void reflect();
+        void resolve(UniformSlot &slot);
+        std::size_t findSlot(const char *name, GLenum type);
+        // Whether value has to be uploaded to the slot, remembering it if so.
+        bool changed(std::size_t slot, const void *value, std::size_t size);
 };
 
-#endif
\ No newline at end of file
+#endif
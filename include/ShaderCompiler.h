@@ -0,0 +1,96 @@
+#ifndef SHADER_COMPILER_H
+#define SHADER_COMPILER_H
+
+#include "glad/glad.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// GL_KHR_parallel_shader_compile isn't in the glad loader, so its pieces are declared here.
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+
+// A program that was submitted to the compiler, valid until it is released or the compiler is deleted.
+using CompileHandle = std::size_t;
+
+enum class CompileState
+{
+    Compiling,
+    Linking,
+    Ready,
+    Failed
+};
+
+/*
+ * Compiles and links programs without waiting on the driver. Submit() only starts the work, and Poll(), once
+ * a frame, asks whether each step is done and moves the program on to the next. With
+ * GL_KHR_parallel_shader_compile (or the ARB version) the driver compiles on its own threads and the status
+ * checks never block. Without it the checks in Poll() can still block, but every program has been handed to
+ * the driver before the first check. Until a program is ready, getProgram() returns a small fallback program
+ * that takes the same inputs and draws in flat grey.
+ *
+ * Programs go through the ProgramCache, so a program that was built before is ready as soon as it is
+ * submitted. Every handle has to be released once its caller is done with it, which also deletes a program
+ * that was never taken, and a released handle is given to a later Submit().
+ */
+class ShaderCompiler
+{
+    private:
+        struct Job
+        {
+            std::string name;
+            GLuint vertexShader = 0;
+            GLuint fragmentShader = 0;
+            GLuint program = 0;
+            CompileState state = CompileState::Compiling;
+            std::uint64_t cacheKey = 0;
+            std::chrono::steady_clock::time_point start;
+            double milliseconds = 0.0;
+            bool fromProgramCache = false;
+            std::string error;
+            bool live = false;
+        };
+        std::vector<Job> jobs;
+        std::vector<CompileHandle> freeHandles;
+        // the jobs still compiling or linking, the only ones Poll() has to look at
+        std::vector<CompileHandle> active;
+        PFNGLMAXSHADERCOMPILERTHREADSKHRPROC maxShaderCompilerThreads = nullptr;
+        bool parallel = false;
+        GLuint fallbackProgram = 0;
+
+        bool isComplete(GLuint object, bool isProgram);
+        void finishCompiling(Job &job);
+        void finishLinking(Job &job);
+        void fail(Job &job, const std::string &error);
+        // Deletes whatever shaders and program the job still has.
+        void deleteObjects(Job &job);
+        Job &getJob(CompileHandle handle);
+    public:
+        // getProcAddress loads the extension's entry point, glfwGetProcAddress in the demo.
+        explicit ShaderCompiler(GLADloadproc getProcAddress);
+
+        CompileHandle Submit(const char *name, const std::string &vertexCode, const std::string &fragmentCode);
+        // Moves every program as far along as it can go. Call once a frame.
+        void Poll();
+        CompileState getState(CompileHandle handle);
+        // The program once it is ready, the fallback program until then or if it failed.
+        GLuint getProgram(CompileHandle handle);
+        // Hands a ready program over to the caller, who deletes it from then on. Returns 0 if it isn't ready.
+        GLuint Take(CompileHandle handle);
+        // Drops the job, deleting a program that wasn't taken and stopping one that is still being built.
+        void Release(CompileHandle handle);
+        const std::string &getError(CompileHandle handle);
+        // From Submit() until the program was ready.
+        double getMilliseconds(CompileHandle handle);
+        bool isFromProgramCache(CompileHandle handle);
+        std::size_t getPendingCount();
+        bool isParallel();
+        GLuint getFallbackProgram();
+        void Delete();
+};
+
+#endif
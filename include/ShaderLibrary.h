@@ -0,0 +1,128 @@
+#ifndef SHADER_LIBRARY_H
+#define SHADER_LIBRARY_H
+
+#include "ShaderClass.h"
+#include "ShaderCompiler.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+enum class LightingModel
+{
+    // the vertex colors as they are
+    Unlit,
+    // vertex colors lit by one directional light, with flat normals worked out in the fragment shader
+    Lambert,
+    Count
+};
+
+/*
+ * What a variant of a shader program is built for. Every feature that is on becomes a #define in both stages,
+ * so the shaders pick their code with #ifdef and a variant has no branches on settings it doesn't use.
+ */
+struct ShaderFeatures
+{
+    // INSTANCING, the per instance attributes are read
+    bool instancing = false;
+    // QUANTIZED_POSITIONS, the positions are normalized int16 relative to the shape's bounds
+    bool quantizedPositions = false;
+    // WIREFRAME, the shape is drawn as lines
+    bool wireframe = false;
+    // LIGHTING_<NAME>, LIGHTING_LAMBERT for example
+    LightingModel lighting = LightingModel::Unlit;
+};
+
+// A program registered with the library, valid until the library is deleted.
+using ShaderProgramId = std::uint32_t;
+
+struct PreprocessedShader
+{
+    std::string code;
+    // the file and everything it included, in the order given to the #line directives
+    std::vector<std::string> files;
+};
+
+struct ShaderLibraryStats
+{
+    // permutation keys that have been asked for
+    std::size_t variants = 0;
+    // programs actually built, keys whose sources came out the same share one
+    std::size_t programs = 0;
+    std::size_t shared = 0;
+};
+
+const char *getLightingModelName(LightingModel model);
+// The defines for features, in a fixed order so the same features always give the same sources.
+std::vector<std::string> getFeatureDefines(const ShaderFeatures &features);
+// Program in the high 32 bits, the features in the low ones.
+std::uint64_t makePermutationKey(ShaderProgramId program, const ShaderFeatures &features);
+/*
+ * Reads path and replaces every #include "file" line with the file, relative to the folder of the file that
+ * includes it. A file is only included once per stage, which also stops include cycles. The defines go right
+ * after the #version line, but only the ones whose name appears somewhere in the sources. Each file gets a
+ * #line directive, so compile errors point at "<index in files>(<line>)". Throws if a file can't be read or
+ * an #include has no quoted name.
+ */
+PreprocessedShader preprocessShader(const std::string &path, const std::vector<std::string> &defines);
+
+/*
+ * Builds the variants of each shader program as they are asked for. A variant is looked up by its 64-bit
+ * permutation key, and variants whose preprocessed sources hash the same share one program, so a feature
+ * that a program never mentions doesn't cost another build. The programs are built on the ShaderCompiler and
+ * draw with its fallback until they are ready.
+ */
+class ShaderLibrary
+{
+    private:
+        struct Program
+        {
+            std::string name;
+            std::string vertexPath;
+            std::string fragmentPath;
+        };
+        struct Variant
+        {
+            std::unique_ptr<Shader> shader;
+            ShaderProgramId program;
+            ShaderFeatures features;
+            std::string name;
+            std::uint64_t sourceHash;
+            // every file either stage read, for hot reloads
+            std::vector<std::string> files;
+        };
+        ShaderCompiler &compiler;
+        std::vector<Program> programs;
+        std::vector<Variant> shaders;
+        // permutation key to shader index, and preprocessed source hash to shader index
+        std::unordered_map<std::uint64_t, std::size_t> variants;
+        std::unordered_map<std::uint64_t, std::size_t> sources;
+        ShaderLibraryStats stats;
+
+        static std::string getVariantName(const Program &program, const ShaderFeatures &features);
+        static std::uint64_t hashSources(const std::string &vertexCode, const std::string &fragmentCode);
+        // Preprocesses both stages of program for features, the files of both end up in files.
+        void preprocess(const Program &program, const ShaderFeatures &features, std::string &vertexCode,
+                        std::string &fragmentCode, std::vector<std::string> &files);
+    public:
+        explicit ShaderLibrary(ShaderCompiler &compiler);
+
+        ShaderProgramId Register(const char *name, const char *vertexPath, const char *fragmentPath);
+        // The variant of program for features. The first call for a key preprocesses the sources and starts
+        // the build. Throws if the sources can't be read.
+        Shader &getShader(ShaderProgramId program, const ShaderFeatures &features);
+        // Switches every variant whose program finished building since the last call, and calls onReady for
+        // each of them. Call once a frame after ShaderCompiler::Poll().
+        std::size_t Update(const std::function<void(const std::string &name, Shader &shader)> &onReady = nullptr);
+        // Rebuilds the variants that read path. A variant that doesn't compile keeps its old program, and a key
+        // whose sources no longer match the variant it shared is built again the next time it is asked for.
+        // Returns how many variants were rebuilt.
+        std::size_t Reload(const std::string &path);
+        const ShaderLibraryStats &getStats();
+        void Delete();
+};
+
+#endif
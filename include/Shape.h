@@ -2,24 +2,93 @@
 #define SHAPE_H
 
 #include "glad/glad.h"
+#include "VertexFormat.h"
+#include "IndexFormat.h"
+#include "MeshOptimizer.h"
+#include "Meshlet.h"
+#include "MeshSimplifier.h"
+#include <glm/glm.hpp>
 #include <vector>
 #include <fstream>
 
+class MappedMesh;
+class InstanceBuffer;
+
 class Shape
 {
     private:
         GLuint VAO, VBO, EBO;
+        VertexFormat format = VertexFormat::Float32;
+        GLsizeiptr vertexCount;
         GLsizeiptr indexCount;
+        // the smallest index type that can address every vertex
+        GLenum indexType = GL_UNSIGNED_INT;
+        // how many bytes the buffers have room for, updates that fit are written in place
+        GLsizeiptr vertexCapacity;
+        GLsizeiptr indexCapacity;
+        // turns the positions stored on the GPU back into the positions from the file
+        float positionScale[3] = {1.0f, 1.0f, 1.0f};
+        float positionOffset[3] = {0.0f, 0.0f, 0.0f};
+        float maxPositionError = 0.0f;
         std::vector<GLfloat> vertices;
-        std::vector<GLuint> indices;
+        PackedIndices indices;
+        // meshlets only cover level 0, coarser levels are small enough to draw whole
+        std::vector<Meshlet> meshlets;
+        // every level is a range of the one index buffer, an empty list means the whole buffer is one level
+        std::vector<LodLevel> lods;
+        std::size_t currentLod = 0;
+        // a sphere around the positions from the file, used to pick the LOD
+        float boundsCenter[3] = {0.0f, 0.0f, 0.0f};
+        float boundsRadius = 0.0f;
+        // the ranges of the index buffer that survived culling, kept so drawing doesn't allocate
+        std::vector<GLsizei> drawCounts;
+        std::vector<const void *> drawOffsets;
+        std::size_t culledMeshlets = 0;
+        // the instance buffer the VAO's instance attributes point at
+        std::uint64_t instanceBufferId = 0;
 
-        std::vector<GLfloat> readVertices(const char *verticesPath);
-        std::vector<GLuint> readIndices(const char *indicesPath);
+        static std::vector<GLfloat> readVertices(const char *verticesPath);
+        static std::vector<GLuint> readIndices(const char *indicesPath);
+        PackedIndices upload(const GLfloat *vertexData, GLsizeiptr vertexFloatCount, const GLuint *indexData, GLsizeiptr indexCount);
+        void writeVertices(const GLfloat *vertexData, GLsizeiptr vertexFloatCount);
+        PackedIndices writeIndices(const GLuint *indexData, GLsizeiptr indexCount);
+        void writeBuffer(GLenum target, GLuint buffer, GLsizeiptr &capacity, const void *data, GLsizeiptr bytes);
+        static void validate(GLsizeiptr vertexFloatCount, const GLuint *indices, GLsizeiptr indexCount);
+        void create(std::vector<GLuint> indices);
+        void setBounds(const float *boundsMin, const float *boundsMax);
+        void computeBounds(const GLfloat *vertexData, GLsizeiptr vertexFloatCount);
+        void readLods(const MappedMesh &mesh);
     public:
-        Shape(const char *verticesPath, const char *indicesPath);
+        Shape(const char *verticesPath, const char *indicesPath, VertexFormat format = VertexFormat::Float32);
+        // Loads a cooked binary mesh. The file is mapped and uploaded directly so no CPU copy is kept.
+        explicit Shape(const char *meshPath, VertexFormat format = VertexFormat::Float32);
+        // Uploads data that has already been read and optimized, used by the asynchronous loaders.
+        Shape(std::vector<GLfloat> vertices, std::vector<GLuint> indices, VertexFormat format = VertexFormat::Float32);
+        explicit Shape(const MappedMesh &mesh, VertexFormat format = VertexFormat::Float32);
+        // Checks that vertices and indices make a valid mesh, welds duplicate vertices and reorders the rest for
+        // the vertex cache and overdraw.
+        static MeshOptimizationReport optimize(std::vector<GLfloat> &vertices, std::vector<GLuint> &indices,
+                                               float weldEpsilon = WELD_EPSILON);
         void Draw();
+        // Draws only the meshlets that pass isMeshletVisible, in as few draws as the visible ranges allow.
+        void DrawMeshlets(const MeshletFrustum &frustum, bool coneCulling);
+        // Draws the current LOD once for every instance in one call, with the INSTANCING shader variant.
+        void DrawInstanced(InstanceBuffer &instances);
         void Delete();
 
+        // Replace the data of a shape. Throws and keeps the old data if the new data isn't a valid mesh.
+        void Update(std::vector<GLfloat> newVertices, std::vector<GLuint> newIndices);
+        void Update(const MappedMesh &mesh);
+        // Meshlets have to be built from the same indices the shape was created or updated with.
+        void setMeshlets(std::vector<Meshlet> meshlets);
+        // Levels made by buildLodChain from the indices the shape was created or updated with. Throws if a level
+        // is out of range.
+        void setLods(std::vector<LodLevel> lods);
+        // Picks the coarsest level that looks the same as the full mesh from cameraPosition, which is in the
+        // shape's own space. pixelsPerUnit is as for selectLodLevel.
+        std::size_t SelectLod(const float *cameraPosition, float pixelsPerUnit);
+        void setLod(std::size_t level);
+
 
         std::vector<GLfloat> getVertices();
         std::vector<GLuint> getIndices();
@@ -28,7 +97,25 @@ class Shape
         GLsizeiptr getIndicesSize();
         GLsizeiptr getVerticesSizeInBytes();
         GLsizeiptr getIndicesSizeInBytes();
+        GLsizeiptr getCpuSizeInBytes();
+        GLsizeiptr getGpuSizeInBytes();
+        VertexFormat getVertexFormat();
+        GLenum getIndexType();
+        float getMaxPositionError();
+        // Multiply the model matrix by this so quantized positions come out the same size as the file says.
+        glm::mat4 getPositionTransform();
+        // A sphere around the positions from the file, worked out when the shape was loaded.
+        glm::vec3 getBoundsCenter();
+        float getBoundsRadius();
+        std::size_t getLod();
+        std::size_t getLodCount();
+        float getLodError();
+        GLsizeiptr getLodIndexOffset();
+        GLsizeiptr getLodIndexCount();
+        std::size_t getMeshletCount();
+        // How many meshlets the last DrawMeshlets skipped.
+        std::size_t getCulledMeshletCount();
         char* getName();
 
 };
-#endif
\ No newline at end of file
+#endif
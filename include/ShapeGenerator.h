@@ -0,0 +1,55 @@
+#ifndef SHAPE_GENERATOR_H
+#define SHAPE_GENERATOR_H
+
+#include "ThreadPool.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+ * Builds the demo's shapes in code instead of reading them from assets/data, and subdivides them into meshes
+ * of any size for load and render benchmarks. At a frequency of 1 each shape is exactly what its text files
+ * parse to, vertex for vertex and index for index. Vertices are the usual 6 floats.
+ */
+
+enum class PolyhedronType
+{
+    Octagon,
+    Pyramid,
+    Cube,
+    Octahedron,
+    Icosahedron,
+    Dodecahedron,
+    // there is no file for this one
+    Tetrahedron,
+    Count
+};
+
+struct PolyhedronSettings
+{
+    PolyhedronType type = PolyhedronType::Icosahedron;
+    // every triangle's edges are split into this many parts, giving frequency squared triangles per triangle
+    std::uint32_t frequency = 1;
+    // push the new vertices out onto a sphere, which turns an icosahedron into an icosphere and so on
+    bool spherical = false;
+};
+
+struct GeneratedMesh
+{
+    std::vector<float> vertices;
+    std::vector<std::uint32_t> indices;
+};
+
+const char *getPolyhedronName(PolyhedronType type);
+
+// The triangle count generatePolyhedron will produce, so callers can check a size before building it.
+std::size_t getPolyhedronTriangleCount(const PolyhedronSettings &settings);
+
+/*
+ * Each face is subdivided on its own across the pool, so vertices on the edges between faces come out once per
+ * face. They come out bit for bit the same, so the weld pass at load time merges them. Throws if the mesh would
+ * need more vertices than 32-bit indices can address.
+ */
+GeneratedMesh generatePolyhedron(const PolyhedronSettings &settings, ThreadPool *pool = &ThreadPool::getShared());
+
+#endif
@@ -0,0 +1,109 @@
+#ifndef SHAPE_REGISTRY_H
+#define SHAPE_REGISTRY_H
+
+#include "AssetPipeline.h"
+#include "GeometryArena.h"
+#include "MeshCache.h"
+#include "MeshOptimizer.h"
+#include "Shape.h"
+#include "ShapeGenerator.h"
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+// A handle is the index of the shape in the registry. It stays valid until the registry is deleted.
+using ShapeHandle = std::size_t;
+
+// Counters so long running sessions can check that memory stays flat.
+struct ShapeRegistryStats
+{
+    std::size_t liveShapes = 0;
+    std::size_t loadingShapes = 0;
+    std::size_t failedShapes = 0;
+    std::size_t liveVertexArrays = 0;
+    std::size_t liveBuffers = 0;
+    std::size_t gpuBytes = 0;
+    // how much smaller the index buffers are than they would be with 32-bit indices
+    std::size_t indexBytesSaved = 0;
+    // how much smaller the vertex buffers are after welding duplicate vertices
+    std::size_t weldBytesSaved = 0;
+    std::size_t cpuBytes = 0;
+    std::size_t bytesResident = 0;
+};
+
+/*
+ * Owns every shape in the program. Each shape is loaded from its files exactly once and the
+ * render loop only ever looks shapes up by handle. Loading happens on the asset pipeline, so a
+ * handle is returned straight away and the shape becomes available once isLoaded() says so.
+ */
+class ShapeRegistry
+{
+    private:
+        struct Entry
+        {
+            std::string name;
+            std::string verticesPath;
+            std::string indicesPath;
+            std::string meshPath;
+            // set for shapes that are generated instead of read, which have no paths
+            std::optional<PolyhedronSettings> polyhedron;
+            std::optional<Shape> shape;
+            std::string error;
+            // ACMR/ATVR of the shape's indices as they were read and as they are drawn
+            MeshOptimizationReport optimization;
+            // the copy of the shape in the geometry arena
+            ArenaHandle arenaHandle = INVALID_ARENA_HANDLE;
+            bool loading = false;
+        };
+        std::vector<Entry> entries;
+        VertexFormat vertexFormat = VertexFormat::Float32;
+        float weldEpsilon = WELD_EPSILON;
+        // cooked text shapes from earlier runs
+        MeshCache meshCache;
+        // every loaded shape again, so they can all be drawn together
+        GeometryArena arena;
+
+        void install(ShapeHandle handle, Shape shape, const MeshOptimizationReport &optimization);
+        // Replaces the shape's copy in the arena.
+        void placeInArena(ShapeHandle handle, const GLfloat *vertices, std::size_t vertexFloatCount, const GLuint *indices,
+                          std::size_t indexCount);
+        void placeInArena(ShapeHandle handle, const MappedMesh &mesh);
+        ShapeHandle addEntry(const char *name, const char *verticesPath, const char *indicesPath, const char *meshPath);
+        LoadTask loadText(AssetPipeline &pipeline, ShapeHandle handle);
+        LoadTask loadMesh(AssetPipeline &pipeline, ShapeHandle handle);
+        LoadTask reload(AssetPipeline &pipeline, ShapeHandle handle, std::string path, std::function<void()> onApplied);
+    public:
+        ShapeHandle Load(AssetPipeline &pipeline, const char *name, const char *verticesPath, const char *indicesPath);
+        ShapeHandle LoadMesh(AssetPipeline &pipeline, const char *name, const char *meshPath);
+        // Generates the shape on the asset pipeline instead of reading it. The same settings give the same handle.
+        ShapeHandle LoadPolyhedron(AssetPipeline &pipeline, const char *name, const PolyhedronSettings &settings);
+        /*
+         * Reloads every shape that uses the file at path. onApplied runs on the render thread once the new
+         * data is on the GPU. Returns how many shapes are being reloaded.
+         */
+        std::size_t Reload(AssetPipeline &pipeline, const std::string &path, std::function<void()> onApplied);
+        void Delete();
+        // Loads every shape again with the new vertex format. Shapes loaded after this use it too.
+        void setVertexFormat(AssetPipeline &pipeline, VertexFormat format);
+        VertexFormat getVertexFormat();
+        // Loads every text shape again with the new weld epsilon. Cooked meshes were welded by shapecook.
+        void setWeldEpsilon(AssetPipeline &pipeline, float epsilon);
+        float getWeldEpsilon();
+        MeshCache &getMeshCache();
+        GeometryArena &getArena();
+
+        bool isLoaded(ShapeHandle handle);
+        Shape &getShape(ShapeHandle handle);
+        const char *getName(ShapeHandle handle);
+        // The reason loading failed, or an empty string.
+        const std::string &getError(ShapeHandle handle);
+        const MeshOptimizationReport &getOptimizationReport(ShapeHandle handle);
+        // Where the shape is in getArena(), or INVALID_ARENA_HANDLE while it isn't loaded.
+        ArenaHandle getArenaHandle(ShapeHandle handle);
+        std::size_t getCount();
+        ShapeRegistryStats getStats();
+};
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef STREAM_RING_H
+#define STREAM_RING_H
+
+#include "glad/glad.h"
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// Room in the ring for one piece of this frame's data. data is null if the frame's region is full.
+struct StreamAllocation
+{
+    void *data = nullptr;
+    GLintptr offset = 0;
+    GLsizeiptr size = 0;
+};
+
+struct StreamRingStats
+{
+    // frames that had to wait for the GPU to finish with their region
+    std::size_t stalls = 0;
+    // allocations that didn't fit in their frame's region
+    std::size_t overflows = 0;
+    GLsizeiptr regionSize = 0;
+    GLsizeiptr bytesLastFrame = 0;
+    GLsizeiptr peakFrameBytes = 0;
+    bool persistent = false;
+};
+
+/*
+ * One buffer for the data that is written again every frame, split into REGION_COUNT regions that frames use
+ * in turn. Each frame bump-allocates from its region, and a fence at the end of the frame says when the GPU
+ * is done with it, so a region is only written again REGION_COUNT frames later. With GL 4.4 the buffer is
+ * made with glBufferStorage and stays mapped persistent and coherent, so writes go straight to the memory
+ * the GPU reads with no copies or implicit syncs in the driver. Older contexts write into a copy of the
+ * buffer instead and Flush() uploads what was written with an unsynchronized map.
+ */
+class StreamRing
+{
+    private:
+        static constexpr int REGION_COUNT = 3;
+        GLuint buffer = 0;
+        GLsizeiptr regionSize = 0;
+        // the persistent mapping, or the CPU copy of the buffer when there is none
+        unsigned char *memory = nullptr;
+        std::vector<unsigned char> staging;
+        GLsync fences[REGION_COUNT] = {};
+        int current = 0;
+        // bytes allocated in the current region, and how many of them Flush() has uploaded
+        std::atomic<GLsizeiptr> head = 0;
+        GLsizeiptr flushed = 0;
+        std::atomic<std::size_t> overflows = 0;
+        StreamRingStats stats;
+    public:
+        // regionSize is how many bytes each frame can allocate.
+        explicit StreamRing(GLsizeiptr regionSize);
+        // Moves to the next region, waiting for the GPU if it is still reading it. Call once a frame before
+        // anything is allocated.
+        void BeginFrame();
+        // size bytes at an offset that is a multiple of alignment, valid until the end of the frame. Lock-free,
+        // so other threads can allocate and write while the render thread draws. Returns a null allocation
+        // when the region is full.
+        StreamAllocation Allocate(GLsizeiptr size, GLsizeiptr alignment = 4);
+        // Makes everything written so far visible to the GPU. Call before the draws that read it, once the
+        // writes are done. Does nothing when the buffer is persistently mapped.
+        void Flush();
+        // Call after the frame's draws, the region isn't handed out again until they are done with it.
+        void EndFrame();
+        void Delete();
+
+        GLuint getBuffer();
+        StreamRingStats getStats();
+};
+
+#endif
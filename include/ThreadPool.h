@@ -0,0 +1,60 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/*
+ * A fixed set of worker threads that run jobs from a shared queue. Used for the CPU side of asset
+ * loading so the render thread only has to deal with OpenGL.
+ */
+class ThreadPool
+{
+    private:
+        std::vector<std::thread> workers;
+        std::queue<std::function<void()>> jobs;
+        std::mutex mutex;
+        std::condition_variable condition;
+        bool stopping = false;
+
+        void workerLoop();
+    public:
+        explicit ThreadPool(std::size_t threadCount = std::thread::hardware_concurrency());
+        ~ThreadPool();
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool &operator=(const ThreadPool &) = delete;
+
+        // The pool shared by the loaders, sized to the number of hardware threads.
+        static ThreadPool &getShared();
+
+        void Enqueue(std::function<void()> job);
+
+        template <typename F>
+        std::future<std::invoke_result_t<F>> Submit(F function)
+        {
+            using Result = std::invoke_result_t<F>;
+            // packaged_task is move only and std::function needs a copyable target
+            auto task = std::make_shared<std::packaged_task<Result()>>(std::move(function));
+            std::future<Result> result = task->get_future();
+            Enqueue([task]() { (*task)(); });
+            return result;
+        }
+
+        /*
+         * Runs body(0) .. body(count - 1) across the pool and the calling thread and returns when all of them
+         * are done. The caller takes items too, so it is safe to call from inside a job on this pool.
+         */
+        void ParallelFor(std::size_t count, const std::function<void(std::size_t)> &body);
+
+        std::size_t getThreadCount();
+};
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef VERTEX_FORMAT_H
+#define VERTEX_FORMAT_H
+
+#include "glad/glad.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+ * The ways a Shape can store its position/color vertices on the GPU. The text and mesh files are always
+ * 6 floats per vertex, the other formats are packed from that when the shape is loaded.
+ */
+enum class VertexFormat
+{
+    // 3 floats position, 3 floats color, 24 bytes
+    Float32,
+    // 3 half floats position, 3 half floats color, each padded to 8 bytes, 16 bytes
+    Half,
+    // 3 normalized int16 position relative to the mesh bounds, 3 normalized uint8 color, padded to 12 bytes
+    Quantized,
+    Count
+};
+
+struct VertexAttribute
+{
+    GLint size;
+    GLenum type;
+    GLboolean normalized;
+    GLuint offset;
+};
+
+struct VertexLayout
+{
+    GLsizei stride;
+    VertexAttribute position;
+    VertexAttribute color;
+};
+
+const char *getVertexFormatName(VertexFormat format);
+VertexLayout getVertexLayout(VertexFormat format);
+
+struct PackedVertices
+{
+    VertexFormat format = VertexFormat::Float32;
+    std::vector<std::uint8_t> data;
+    // the stored position times scale plus offset gives back the original position
+    float positionScale[3] = {1.0f, 1.0f, 1.0f};
+    float positionOffset[3] = {0.0f, 0.0f, 0.0f};
+    // the largest distance between an original position and the one the GPU will see
+    float maxPositionError = 0.0f;
+};
+
+// Packs vertexCount vertices of 6 floats each into the given format.
+PackedVertices packVertices(const float *vertices, std::size_t vertexCount, VertexFormat format);
+
+std::uint16_t floatToHalf(float value);
+float halfToFloat(std::uint16_t value);
+
+#endif
@@ -0,0 +1,353 @@
+#include "../include/AssetPack.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static std::uint64_t alignUp(std::uint64_t value, std::uint64_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+std::uint64_t assetNameHash(std::string_view name)
+{
+    std::uint64_t hash = 0xcbf29ce484222325ull;
+    for (char character : name)
+    {
+        hash ^= static_cast<unsigned char>(character);
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+AssetType getAssetType(std::string_view name)
+{
+    if (name.ends_with(".mesh"))
+    {
+        return AssetType::Mesh;
+    }
+    if (name.ends_with(".vert") || name.ends_with(".frag") || name.ends_with(".glsl"))
+    {
+        return AssetType::Shader;
+    }
+    if (name.starts_with("data/Vertices/"))
+    {
+        return AssetType::Vertices;
+    }
+    if (name.starts_with("data/Indices/"))
+    {
+        return AssetType::Indices;
+    }
+    return AssetType::Other;
+}
+
+const char *getAssetTypeName(AssetType type)
+{
+    switch (type)
+    {
+        case AssetType::Vertices: return "Vertices";
+        case AssetType::Indices: return "Indices";
+        case AssetType::Mesh: return "Mesh";
+        case AssetType::Shader: return "Shader";
+        default: return "Other";
+    }
+}
+
+std::vector<AssetPackSource> listAssetFiles(const char *root)
+{
+    std::vector<AssetPackSource> sources;
+    for (const std::filesystem::directory_entry &file : std::filesystem::recursive_directory_iterator(root))
+    {
+        std::string name = std::filesystem::relative(file.path(), root).generic_string();
+        bool hidden = name.starts_with('.') || name.find("/.") != std::string::npos;
+        if (file.is_regular_file() && !hidden)
+        {
+            sources.push_back({name, file.path().string()});
+        }
+    }
+    return sources;
+}
+
+void writeAssetPack(const char *path, const std::vector<AssetPackSource> &sources)
+{
+    std::vector<const AssetPackSource *> sorted;
+    for (const AssetPackSource &source : sources)
+    {
+        sorted.push_back(&source);
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const AssetPackSource *a, const AssetPackSource *b)
+    {
+        std::uint64_t hashA = assetNameHash(a->name);
+        std::uint64_t hashB = assetNameHash(b->name);
+        return hashA != hashB ? hashA < hashB : a->name < b->name;
+    });
+
+    AssetPackHeader header{};
+    header.magic = ASSET_PACK_MAGIC;
+    header.version = ASSET_PACK_VERSION;
+    header.entryCount = sorted.size();
+    header.tocOffset = sizeof(AssetPackHeader);
+    header.nameOffset = header.tocOffset + sorted.size() * sizeof(AssetPackEntry);
+
+    std::vector<AssetPackEntry> entries(sorted.size());
+    std::string names;
+    for (std::size_t i = 0; i < sorted.size(); i++)
+    {
+        if (i > 0 && sorted[i]->name == sorted[i - 1]->name)
+        {
+            throw std::runtime_error("Asset " + sorted[i]->name + " is in the pack twice");
+        }
+        entries[i].nameHash = assetNameHash(sorted[i]->name);
+        entries[i].nameOffset = names.size();
+        entries[i].nameLength = sorted[i]->name.size();
+        entries[i].type = static_cast<std::uint32_t>(getAssetType(sorted[i]->name));
+        names += sorted[i]->name;
+    }
+    header.nameBytes = names.size();
+
+    std::uint64_t offset = alignUp(header.nameOffset + header.nameBytes, ASSET_PACK_ALIGNMENT);
+    for (std::size_t i = 0; i < sorted.size(); i++)
+    {
+        std::error_code error;
+        std::uintmax_t size = std::filesystem::file_size(sorted[i]->path, error);
+        if (error)
+        {
+            throw std::runtime_error("Could not open file " + sorted[i]->path);
+        }
+        entries[i].offset = offset;
+        entries[i].size = size;
+        offset = alignUp(offset + size, ASSET_PACK_ALIGNMENT);
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+    {
+        throw std::runtime_error("Could not open file " + std::string(path));
+    }
+    static const char padding[ASSET_PACK_ALIGNMENT] = {};
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(entries.data()), entries.size() * sizeof(AssetPackEntry));
+    file.write(names.data(), names.size());
+    std::uint64_t written = header.nameOffset + header.nameBytes;
+    for (std::size_t i = 0; i < sorted.size(); i++)
+    {
+        file.write(padding, entries[i].offset - written);
+        std::ifstream source(sorted[i]->path, std::ios::binary);
+        std::string contents(entries[i].size, '\0');
+        source.read(contents.data(), contents.size());
+        if (!source)
+        {
+            throw std::runtime_error("Could not read file " + sorted[i]->path);
+        }
+        file.write(contents.data(), contents.size());
+        written = entries[i].offset + entries[i].size;
+    }
+    if (!file)
+    {
+        throw std::runtime_error("Could not write file " + std::string(path));
+    }
+}
+
+AssetPack::AssetPack(const char *path)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        throw std::runtime_error("Could not open file " + std::string(path));
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<std::size_t>(info.st_size) < sizeof(AssetPackHeader))
+    {
+        close(fd);
+        throw std::runtime_error("Asset pack " + std::string(path) + " is too small");
+    }
+    mappingSize = info.st_size;
+    mapping = mmap(nullptr, mappingSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        mapping = nullptr;
+        throw std::runtime_error("Could not map file " + std::string(path));
+    }
+    // lookups jump around the file, the OS shouldn't read ahead of them
+    madvise(mapping, mappingSize, MADV_RANDOM);
+
+    const char *bytes = static_cast<const char *>(mapping);
+    header = static_cast<const AssetPackHeader *>(mapping);
+    entries = reinterpret_cast<const AssetPackEntry *>(bytes + header->tocOffset);
+    names = bytes + header->nameOffset;
+    std::string error;
+    if (header->magic != ASSET_PACK_MAGIC)
+    {
+        error = "is not an asset pack";
+    }
+    else if (header->version != ASSET_PACK_VERSION)
+    {
+        error = "has unsupported version " + std::to_string(header->version);
+    }
+    else if (header->tocOffset % alignof(AssetPackEntry) != 0 || header->tocOffset > mappingSize ||
+             header->entryCount > (mappingSize - header->tocOffset) / sizeof(AssetPackEntry) ||
+             header->nameOffset > mappingSize || header->nameBytes > mappingSize - header->nameOffset)
+    {
+        error = "has a truncated table of contents";
+    }
+    else
+    {
+        for (std::size_t i = 0; i < header->entryCount && error.empty(); i++)
+        {
+            const AssetPackEntry &entry = entries[i];
+            if (entry.offset > mappingSize || entry.size > mappingSize - entry.offset ||
+                entry.nameOffset > header->nameBytes || entry.nameLength > header->nameBytes - entry.nameOffset)
+            {
+                error = "has an entry outside the file";
+            }
+            else if (i > 0 && entry.nameHash < entries[i - 1].nameHash)
+            {
+                error = "has an unsorted table of contents";
+            }
+        }
+    }
+    if (!error.empty())
+    {
+        munmap(mapping, mappingSize);
+        mapping = nullptr;
+        throw std::runtime_error("Asset pack " + std::string(path) + " " + error);
+    }
+}
+
+AssetPack::~AssetPack()
+{
+    if (mapping != nullptr)
+    {
+        munmap(mapping, mappingSize);
+    }
+}
+
+const AssetPackEntry *AssetPack::find(std::string_view name) const
+{
+    std::uint64_t hash = assetNameHash(name);
+    const AssetPackEntry *end = entries + header->entryCount;
+    const AssetPackEntry *entry = std::lower_bound(entries, end, hash,
+                                                   [](const AssetPackEntry &entry, std::uint64_t hash) { return entry.nameHash < hash; });
+    for (; entry != end && entry->nameHash == hash; entry++)
+    {
+        if (getName(*entry) == name)
+        {
+            return entry;
+        }
+    }
+    return nullptr;
+}
+
+std::string_view AssetPack::getContents(const AssetPackEntry &entry) const
+{
+    return std::string_view(static_cast<const char *>(mapping) + entry.offset, entry.size);
+}
+
+std::string_view AssetPack::getName(const AssetPackEntry &entry) const
+{
+    return std::string_view(names + entry.nameOffset, entry.nameLength);
+}
+
+std::size_t AssetPack::getCount() const
+{
+    return header->entryCount;
+}
+
+const AssetPackEntry *AssetPack::getEntries() const
+{
+    return entries;
+}
+
+// Private Methods
+std::optional<std::string_view> AssetPackMount::relativeName(std::string_view path) const
+{
+    if (!path.starts_with(root) || path.size() <= root.size() || path[root.size()] != '/')
+    {
+        return std::nullopt;
+    }
+    return path.substr(root.size() + 1);
+}
+
+// Public Methods
+AssetPackMount &AssetPackMount::getShared()
+{
+    static AssetPackMount mount;
+    return mount;
+}
+
+bool AssetPackMount::Mount(const char *packPath, const char *assetRoot)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    pack.reset();
+    overridden.clear();
+    root = assetRoot;
+    while (root.size() > 1 && root.back() == '/')
+    {
+        root.pop_back();
+    }
+    try
+    {
+        pack.emplace(packPath);
+    }
+    catch (const std::exception &)
+    {
+        // no pack is normal when running from the source tree, the loose files are used
+        return false;
+    }
+    return true;
+}
+
+void AssetPackMount::Unmount()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    pack.reset();
+    overridden.clear();
+}
+
+void AssetPackMount::Override(const std::string &path)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    overridden.insert(path);
+}
+
+std::optional<std::string_view> AssetPackMount::find(const char *path) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!pack || overridden.contains(path))
+    {
+        return std::nullopt;
+    }
+    std::optional<std::string_view> name = relativeName(path);
+    if (!name)
+    {
+        return std::nullopt;
+    }
+    const AssetPackEntry *entry = pack->find(*name);
+    if (entry == nullptr)
+    {
+        return std::nullopt;
+    }
+    return pack->getContents(*entry);
+}
+
+bool AssetPackMount::exists(const char *path) const
+{
+    return find(path).has_value() || std::filesystem::exists(path);
+}
+
+bool AssetPackMount::isMounted() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return pack.has_value();
+}
+
+std::size_t AssetPackMount::getCount() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return pack ? pack->getCount() : 0;
+}
@@ -0,0 +1,201 @@
+#include "../include/AssetPipeline.h"
+#include <algorithm>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+const char *getLoadStageName(LoadStage stage)
+{
+    switch (stage)
+    {
+        case LoadStage::Read: return "Read";
+        case LoadStage::Parse: return "Parse";
+        case LoadStage::Optimize: return "Optimize";
+        case LoadStage::Wait: return "Wait";
+        case LoadStage::Upload: return "Upload";
+        case LoadStage::Total: return "Total";
+        default: return "Unknown";
+    }
+}
+
+// LatencyHistogram
+void LatencyHistogram::Record(std::chrono::steady_clock::duration duration)
+{
+    double microseconds = std::chrono::duration<double, std::micro>(duration).count();
+    std::size_t bucket = 0;
+    while (bucket < BUCKET_COUNT - 1 && microseconds >= static_cast<double>(1ull << bucket))
+    {
+        bucket++;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    buckets[bucket]++;
+    count++;
+    sumMicroseconds += microseconds;
+    maxMicroseconds = std::max(maxMicroseconds, microseconds);
+}
+
+std::uint64_t LatencyHistogram::getCount()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return count;
+}
+
+double LatencyHistogram::getMeanMicroseconds()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return count == 0 ? 0.0 : sumMicroseconds / count;
+}
+
+double LatencyHistogram::getMaxMicroseconds()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return maxMicroseconds;
+}
+
+double LatencyHistogram::getPercentileMicroseconds(double percentile)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (count == 0)
+    {
+        return 0.0;
+    }
+    std::uint64_t target = static_cast<std::uint64_t>(percentile * count);
+    std::uint64_t seen = 0;
+    for (std::size_t bucket = 0; bucket < BUCKET_COUNT; bucket++)
+    {
+        seen += buckets[bucket];
+        if (seen > target)
+        {
+            return std::min(static_cast<double>(1ull << bucket), maxMicroseconds);
+        }
+    }
+    return maxMicroseconds;
+}
+
+std::array<float, LatencyHistogram::BUCKET_COUNT> LatencyHistogram::getBuckets()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    std::array<float, BUCKET_COUNT> values;
+    for (std::size_t bucket = 0; bucket < BUCKET_COUNT; bucket++)
+    {
+        values[bucket] = static_cast<float>(buckets[bucket]);
+    }
+    return values;
+}
+
+// LoadTask
+void LoadTask::promise_type::unhandled_exception()
+{
+    // loaders catch their own errors, this only happens if reporting the error failed too
+    try
+    {
+        throw;
+    }
+    catch (const std::exception &error)
+    {
+        std::cout << "ERROR::ASSET::LOAD_FAILED\n" << error.what() << std::endl;
+    }
+    catch (...)
+    {
+        std::cout << "ERROR::ASSET::LOAD_FAILED" << std::endl;
+    }
+}
+
+// AssetPipeline
+AssetPipeline::Ticket::Ticket(AssetPipeline &pipeline) : pipeline(&pipeline)
+{
+    pipeline.inFlight++;
+}
+
+AssetPipeline::Ticket::~Ticket()
+{
+    pipeline->inFlight--;
+}
+
+void AssetPipeline::WorkerAwaiter::await_suspend(std::coroutine_handle<> handle)
+{
+    pool.Enqueue([handle]() { handle.resume(); });
+}
+
+void AssetPipeline::RenderThreadAwaiter::await_suspend(std::coroutine_handle<> handle)
+{
+    std::lock_guard<std::mutex> lock(pipeline.mutex);
+    pipeline.renderQueue.push_back(handle);
+}
+
+bool AssetPipeline::RenderThreadAwaiter::await_resume()
+{
+    return !pipeline.cancelled;
+}
+
+AssetPipeline::AssetPipeline(ThreadPool &pool) : pool(pool)
+{
+}
+
+AssetPipeline::WorkerAwaiter AssetPipeline::ResumeOnWorker()
+{
+    return WorkerAwaiter{pool};
+}
+
+AssetPipeline::RenderThreadAwaiter AssetPipeline::ResumeOnRenderThread()
+{
+    return RenderThreadAwaiter{*this};
+}
+
+void AssetPipeline::Record(LoadStage stage, std::chrono::steady_clock::duration duration)
+{
+    histograms[static_cast<std::size_t>(stage)].Record(duration);
+}
+
+std::size_t AssetPipeline::Pump(std::chrono::steady_clock::duration budget)
+{
+    auto deadline = std::chrono::steady_clock::now() + budget;
+    std::size_t resumed = 0;
+    // always make progress on at least one item so a single slow upload can't stall loading forever
+    do
+    {
+        std::coroutine_handle<> handle;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (renderQueue.empty())
+            {
+                break;
+            }
+            handle = renderQueue.front();
+            renderQueue.pop_front();
+        }
+        handle.resume();
+        resumed++;
+    }
+    while (std::chrono::steady_clock::now() < deadline);
+    return resumed;
+}
+
+void AssetPipeline::Shutdown()
+{
+    cancelled = true;
+    while (inFlight > 0)
+    {
+        std::vector<std::coroutine_handle<>> handles;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            handles.assign(renderQueue.begin(), renderQueue.end());
+            renderQueue.clear();
+        }
+        for (std::coroutine_handle<> handle : handles)
+        {
+            handle.resume();
+        }
+        std::this_thread::yield();
+    }
+}
+
+int AssetPipeline::getInFlight()
+{
+    return inFlight;
+}
+
+LatencyHistogram &AssetPipeline::getHistogram(LoadStage stage)
+{
+    return histograms[static_cast<std::size_t>(stage)];
+}
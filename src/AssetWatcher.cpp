@@ -0,0 +1,118 @@
+#include "../include/AssetWatcher.h"
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+AssetWatcher::AssetWatcher(const std::vector<std::string> &directories)
+{
+    // hot reload is a development convenience, so failing to watch only prints a message
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    stopFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (inotifyFd < 0 || stopFd < 0)
+    {
+        std::cout << "ERROR::ASSET_WATCHER::INIT_FAILED\n" << std::strerror(errno) << std::endl;
+        return;
+    }
+    for (const std::string &directory : directories)
+    {
+        int watch = inotify_add_watch(inotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+        if (watch < 0)
+        {
+            std::cout << "ERROR::ASSET_WATCHER::WATCH_FAILED\n" << directory << ": " << std::strerror(errno) << std::endl;
+            continue;
+        }
+        watches[watch] = directory;
+    }
+    thread = std::thread(&AssetWatcher::run, this);
+}
+
+AssetWatcher::~AssetWatcher()
+{
+    if (thread.joinable())
+    {
+        std::uint64_t one = 1;
+        if (write(stopFd, &one, sizeof(one)) != sizeof(one))
+        {
+            std::cout << "ERROR::ASSET_WATCHER::STOP_FAILED" << std::endl;
+        }
+        thread.join();
+    }
+    if (inotifyFd >= 0)
+    {
+        close(inotifyFd);
+    }
+    if (stopFd >= 0)
+    {
+        close(stopFd);
+    }
+}
+
+void AssetWatcher::run()
+{
+    alignas(inotify_event) char buffer[4096];
+    pollfd fds[2] = {{inotifyFd, POLLIN, 0}, {stopFd, POLLIN, 0}};
+    while (true)
+    {
+        if (poll(fds, 2, -1) < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return;
+        }
+        if (fds[1].revents != 0)
+        {
+            return;
+        }
+        ssize_t length;
+        while ((length = read(inotifyFd, buffer, sizeof(buffer))) > 0)
+        {
+            std::chrono::steady_clock::time_point detected = std::chrono::steady_clock::now();
+            std::lock_guard<std::mutex> lock(mutex);
+            for (char *p = buffer; p < buffer + length; p += sizeof(inotify_event) + reinterpret_cast<inotify_event *>(p)->len)
+            {
+                inotify_event *event = reinterpret_cast<inotify_event *>(p);
+                auto watch = watches.find(event->wd);
+                if (event->len == 0 || watch == watches.end())
+                {
+                    continue;
+                }
+                changes.push_back({watch->second + "/" + event->name, detected});
+            }
+        }
+    }
+}
+
+std::vector<AssetChange> AssetWatcher::Poll()
+{
+    std::vector<AssetChange> polled;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        polled.swap(changes);
+    }
+    // an editor can write the same file several times in one save, keep the first time it was seen
+    std::vector<AssetChange> unique;
+    for (AssetChange &change : polled)
+    {
+        bool seen = false;
+        for (const AssetChange &existing : unique)
+        {
+            seen = seen || existing.path == change.path;
+        }
+        if (!seen)
+        {
+            unique.push_back(std::move(change));
+        }
+    }
+    return unique;
+}
+
+bool AssetWatcher::isWatching()
+{
+    return thread.joinable() && !watches.empty();
+}
@@ -0,0 +1,23 @@
+#include "../include/FrameUniforms.h"
+#include <cstring>
+
+FrameUniformBuffer::FrameUniformBuffer(StreamRing &stream)
+    : stream(stream)
+{
+    GLint offsetAlignment = 1;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &offsetAlignment);
+    alignment = offsetAlignment < 1 ? 1 : offsetAlignment;
+}
+
+void FrameUniformBuffer::Update(const FrameUniforms &uniforms)
+{
+    StreamAllocation allocation = stream.Allocate(sizeof(FrameUniforms), alignment);
+    if (allocation.data == nullptr)
+    {
+        // the last frame's uniforms stay bound, the ring counts the overflow
+        return;
+    }
+    std::memcpy(allocation.data, &uniforms, sizeof(FrameUniforms));
+    stream.Flush();
+    glBindBufferRange(GL_UNIFORM_BUFFER, FRAME_UNIFORM_BINDING, stream.getBuffer(), allocation.offset, sizeof(FrameUniforms));
+}
@@ -0,0 +1,336 @@
+#include "../include/FrustumCulling.h"
+#include "../include/ThreadPool.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <limits>
+#if defined(__x86_64__) || defined(__i386__)
+#define CULLING_X86 1
+#include <immintrin.h>
+#endif
+
+// Spheres per job when the culling is split across threads, a whole number of blocks.
+constexpr std::size_t CULLING_CHUNK = 16384;
+static_assert(CULLING_CHUNK % CULLING_BLOCK == 0, "chunks have to hold whole blocks");
+
+using CullKernel = std::size_t (*)(const BoundingSpheres &spheres, std::size_t begin, std::size_t end,
+                                   const float (&planes)[6][4], std::uint32_t *out);
+
+const char *getCullingIsaName(CullingIsa isa)
+{
+    switch (isa)
+    {
+        case CullingIsa::Scalar: return "Scalar";
+        case CullingIsa::SSE4: return "SSE4.1";
+        case CullingIsa::AVX2: return "AVX2";
+        default: return "Unknown";
+    }
+}
+
+bool isCullingIsaSupported(CullingIsa isa)
+{
+    switch (isa)
+    {
+        case CullingIsa::Scalar: return true;
+#if defined(CULLING_X86)
+        case CullingIsa::SSE4: return __builtin_cpu_supports("sse4.1");
+        case CullingIsa::AVX2: return __builtin_cpu_supports("avx2");
+#endif
+        default: return false;
+    }
+}
+
+CullingIsa getBestCullingIsa()
+{
+    int isa = static_cast<int>(CullingIsa::Count) - 1;
+    while (isa > 0 && !isCullingIsaSupported(static_cast<CullingIsa>(isa)))
+    {
+        isa--;
+    }
+    return static_cast<CullingIsa>(isa);
+}
+
+void BoundingSpheres::Resize(std::size_t count)
+{
+    this->count = count;
+    std::size_t padded = (count + CULLING_BLOCK - 1) / CULLING_BLOCK * CULLING_BLOCK;
+    centerX.resize(padded);
+    centerY.resize(padded);
+    centerZ.resize(padded);
+    radius.resize(padded);
+    // a negative infinite radius is outside every plane
+    for (std::size_t i = count; i < padded; i++)
+    {
+        centerX[i] = centerY[i] = centerZ[i] = 0.0f;
+        radius[i] = -std::numeric_limits<float>::infinity();
+    }
+}
+
+void BoundingSpheres::Set(std::size_t index, const float *center, float radius)
+{
+    centerX[index] = center[0];
+    centerY[index] = center[1];
+    centerZ[index] = center[2];
+    this->radius[index] = radius;
+}
+
+std::size_t BoundingSpheres::getCount() const
+{
+    return count;
+}
+
+const float *BoundingSpheres::getCenterX() const
+{
+    return centerX.data();
+}
+
+const float *BoundingSpheres::getCenterY() const
+{
+    return centerY.data();
+}
+
+const float *BoundingSpheres::getCenterZ() const
+{
+    return centerZ.data();
+}
+
+const float *BoundingSpheres::getRadius() const
+{
+    return radius.data();
+}
+
+/*
+ * The kernels test the blocks in [begin, end) and write the indices of the visible spheres to out, which has
+ * room for end - begin indices. Every lane is stored and only the visible ones move the write position on,
+ * so there are no branches on the results. A sphere is visible unless it is entirely behind one plane.
+ */
+static std::size_t cullScalar(const BoundingSpheres &spheres, std::size_t begin, std::size_t end, const float (&planes)[6][4],
+                              std::uint32_t *out)
+{
+    const float *x = spheres.getCenterX();
+    const float *y = spheres.getCenterY();
+    const float *z = spheres.getCenterZ();
+    const float *radius = spheres.getRadius();
+    std::size_t visible = 0;
+    for (std::size_t i = begin; i < end; i++)
+    {
+        bool inside = true;
+        for (const float *plane : planes)
+        {
+            // summed in the same order as the wide kernels so every kernel gives the same answer
+            float distance = (plane[0] * x[i] + plane[1] * y[i]) + (plane[2] * z[i] + plane[3]);
+            inside &= distance >= -radius[i];
+        }
+        out[visible] = static_cast<std::uint32_t>(i);
+        visible += inside;
+    }
+    return visible;
+}
+
+#if defined(CULLING_X86)
+// For each mask of visible lanes, the lanes in order packed to the front, one lane per byte.
+static constexpr std::array<std::uint64_t, 256> makeCompactTable()
+{
+    std::array<std::uint64_t, 256> table = {};
+    for (unsigned mask = 0; mask < 256; mask++)
+    {
+        int packed = 0;
+        for (unsigned lane = 0; lane < 8; lane++)
+        {
+            if (mask & (1u << lane))
+            {
+                table[mask] |= static_cast<std::uint64_t>(lane) << (8 * packed++);
+            }
+        }
+    }
+    return table;
+}
+static constexpr std::array<std::uint64_t, 256> COMPACT_TABLE = makeCompactTable();
+
+// The same for four 32-bit lanes, as the byte shuffle that packs them.
+static constexpr std::array<std::array<std::uint8_t, 16>, 16> makeShuffleTable()
+{
+    std::array<std::array<std::uint8_t, 16>, 16> table = {};
+    for (unsigned mask = 0; mask < 16; mask++)
+    {
+        int packed = 0;
+        for (unsigned lane = 0; lane < 4; lane++)
+        {
+            if (mask & (1u << lane))
+            {
+                for (unsigned byte = 0; byte < 4; byte++)
+                {
+                    table[mask][4 * packed + byte] = static_cast<std::uint8_t>(4 * lane + byte);
+                }
+                packed++;
+            }
+        }
+    }
+    return table;
+}
+static constexpr std::array<std::array<std::uint8_t, 16>, 16> SHUFFLE_TABLE = makeShuffleTable();
+
+__attribute__((target("sse4.1")))
+static std::size_t cullSSE4(const BoundingSpheres &spheres, std::size_t begin, std::size_t end, const float (&planes)[6][4],
+                            std::uint32_t *out)
+{
+    const float *x = spheres.getCenterX();
+    const float *y = spheres.getCenterY();
+    const float *z = spheres.getCenterZ();
+    const float *radius = spheres.getRadius();
+    __m128 plane[6][4];
+    for (int p = 0; p < 6; p++)
+    {
+        for (int c = 0; c < 4; c++)
+        {
+            plane[p][c] = _mm_set1_ps(planes[p][c]);
+        }
+    }
+    const __m128i lanes = _mm_setr_epi32(0, 1, 2, 3);
+    std::size_t visible = 0;
+    // two halves of a block per iteration
+    for (std::size_t i = begin; i < end; i += CULLING_BLOCK)
+    {
+        for (std::size_t half = i; half < i + CULLING_BLOCK; half += 4)
+        {
+            __m128 cx = _mm_loadu_ps(x + half);
+            __m128 cy = _mm_loadu_ps(y + half);
+            __m128 cz = _mm_loadu_ps(z + half);
+            __m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(radius + half));
+            __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+            for (int p = 0; p < 6; p++)
+            {
+                __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(plane[p][0], cx), _mm_mul_ps(plane[p][1], cy)),
+                                             _mm_add_ps(_mm_mul_ps(plane[p][2], cz), plane[p][3]));
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeRadius));
+            }
+            int mask = _mm_movemask_ps(inside);
+            __m128i indices = _mm_add_epi32(_mm_set1_epi32(static_cast<int>(half)), lanes);
+            __m128i shuffle = _mm_loadu_si128(reinterpret_cast<const __m128i *>(SHUFFLE_TABLE[mask].data()));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + visible), _mm_shuffle_epi8(indices, shuffle));
+            visible += __builtin_popcount(mask);
+        }
+    }
+    return visible;
+}
+
+__attribute__((target("avx2")))
+static std::size_t cullAVX2(const BoundingSpheres &spheres, std::size_t begin, std::size_t end, const float (&planes)[6][4],
+                            std::uint32_t *out)
+{
+    const float *x = spheres.getCenterX();
+    const float *y = spheres.getCenterY();
+    const float *z = spheres.getCenterZ();
+    const float *radius = spheres.getRadius();
+    __m256 plane[6][4];
+    for (int p = 0; p < 6; p++)
+    {
+        for (int c = 0; c < 4; c++)
+        {
+            plane[p][c] = _mm256_set1_ps(planes[p][c]);
+        }
+    }
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    std::size_t visible = 0;
+    for (std::size_t i = begin; i < end; i += CULLING_BLOCK)
+    {
+        __m256 cx = _mm256_loadu_ps(x + i);
+        __m256 cy = _mm256_loadu_ps(y + i);
+        __m256 cz = _mm256_loadu_ps(z + i);
+        __m256 negativeRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(radius + i));
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (int p = 0; p < 6; p++)
+        {
+            __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(plane[p][0], cx), _mm256_mul_ps(plane[p][1], cy)),
+                                            _mm256_add_ps(_mm256_mul_ps(plane[p][2], cz), plane[p][3]));
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negativeRadius, _CMP_GE_OQ));
+        }
+        int mask = _mm256_movemask_ps(inside);
+        __m256i indices = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(i)), lanes);
+        __m256i permutation = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(&COMPACT_TABLE[mask])));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + visible), _mm256_permutevar8x32_epi32(indices, permutation));
+        visible += __builtin_popcount(mask);
+    }
+    return visible;
+}
+#endif
+
+static CullKernel getKernel(CullingIsa isa)
+{
+    switch (isa)
+    {
+#if defined(CULLING_X86)
+        case CullingIsa::SSE4: return cullSSE4;
+        case CullingIsa::AVX2: return cullAVX2;
+#endif
+        default: return cullScalar;
+    }
+}
+
+const std::vector<std::uint32_t> &FrustumCuller::Cull(const BoundingSpheres &spheres, const float (&planes)[6][4])
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::size_t padded = (spheres.getCount() + CULLING_BLOCK - 1) / CULLING_BLOCK * CULLING_BLOCK;
+    CullKernel kernel = getKernel(isa);
+    visible.resize(padded);
+    std::size_t count = 0;
+    stats.threads = 1;
+    if (threaded && spheres.getCount() >= CULLING_PARALLEL_THRESHOLD)
+    {
+        std::size_t chunkCount = (padded + CULLING_CHUNK - 1) / CULLING_CHUNK;
+        chunkVisible.assign(chunkCount, 0);
+        ThreadPool &pool = ThreadPool::getShared();
+        pool.ParallelFor(chunkCount, [&](std::size_t chunk)
+        {
+            std::size_t begin = chunk * CULLING_CHUNK;
+            std::size_t end = std::min(begin + CULLING_CHUNK, padded);
+            chunkVisible[chunk] = kernel(spheres, begin, end, planes, visible.data() + begin);
+        });
+        // each chunk compacted into its own part, the parts are moved down so they follow each other
+        for (std::size_t chunk = 0; chunk < chunkCount; chunk++)
+        {
+            std::memmove(visible.data() + count, visible.data() + chunk * CULLING_CHUNK, chunkVisible[chunk] * sizeof(std::uint32_t));
+            count += chunkVisible[chunk];
+        }
+        stats.threads = std::min(chunkCount, pool.getThreadCount() + 1);
+    }
+    else
+    {
+        count = kernel(spheres, 0, padded, planes, visible.data());
+    }
+    visible.resize(count);
+
+    stats.tested = spheres.getCount();
+    stats.visible = count;
+    stats.culled = stats.tested - count;
+    stats.microseconds = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    stats.microsecondsPerMillion = stats.tested > 0 ? stats.microseconds * 1e6 / stats.tested : 0.0;
+    stats.isa = isa;
+    return visible;
+}
+
+void FrustumCuller::setIsa(CullingIsa isa)
+{
+    int wanted = static_cast<int>(isa);
+    while (wanted > 0 && !isCullingIsaSupported(static_cast<CullingIsa>(wanted)))
+    {
+        wanted--;
+    }
+    this->isa = static_cast<CullingIsa>(wanted);
+}
+
+CullingIsa FrustumCuller::getIsa()
+{
+    return isa;
+}
+
+void FrustumCuller::setThreaded(bool threaded)
+{
+    this->threaded = threaded;
+}
+
+const CullingStats &FrustumCuller::getStats()
+{
+    return stats;
+}
@@ -0,0 +1,138 @@
+#include "../include/GLStateCache.h"
+
+RenderState::RenderState(GLenum polygonMode, bool cullFace, bool multisample, bool depthTest)
+    : polygonMode(polygonMode), cullFace(cullFace), multisample(multisample), depthTest(depthTest)
+{
+}
+
+GLenum RenderState::getPolygonMode() const
+{
+    return polygonMode;
+}
+
+bool RenderState::isCullFace() const
+{
+    return cullFace;
+}
+
+bool RenderState::isMultisample() const
+{
+    return multisample;
+}
+
+bool RenderState::isDepthTest() const
+{
+    return depthTest;
+}
+
+GLStateCache &GLStateCache::getShared()
+{
+    static GLStateCache cache;
+    return cache;
+}
+
+bool GLStateCache::submit(bool changed)
+{
+    stats.submitted++;
+    if (!changed)
+    {
+        stats.filtered++;
+    }
+    return changed;
+}
+
+void GLStateCache::setEnabled(GLenum capability, bool enabled)
+{
+    std::pair<GLenum, bool> *known = nullptr;
+    for (std::pair<GLenum, bool> &entry : capabilities)
+    {
+        if (entry.first == capability)
+        {
+            known = &entry;
+            break;
+        }
+    }
+    if (!submit(known == nullptr || known->second != enabled))
+    {
+        return;
+    }
+    if (known == nullptr)
+    {
+        capabilities.emplace_back(capability, enabled);
+    }
+    else
+    {
+        known->second = enabled;
+    }
+    if (enabled)
+    {
+        glEnable(capability);
+    }
+    else
+    {
+        glDisable(capability);
+    }
+}
+
+void GLStateCache::Enable(GLenum capability)
+{
+    setEnabled(capability, true);
+}
+
+void GLStateCache::Disable(GLenum capability)
+{
+    setEnabled(capability, false);
+}
+
+void GLStateCache::PolygonMode(GLenum mode)
+{
+    if (submit(!polygonModeKnown || polygonMode != mode))
+    {
+        glPolygonMode(GL_FRONT_AND_BACK, mode);
+        polygonMode = mode;
+        polygonModeKnown = true;
+    }
+}
+
+void GLStateCache::UseProgram(GLuint program)
+{
+    if (submit(!programKnown || this->program != program))
+    {
+        glUseProgram(program);
+        this->program = program;
+        programKnown = true;
+    }
+}
+
+void GLStateCache::Apply(const RenderState &state)
+{
+    PolygonMode(state.getPolygonMode());
+    setEnabled(GL_CULL_FACE, state.isCullFace());
+    setEnabled(GL_MULTISAMPLE, state.isMultisample());
+    setEnabled(GL_DEPTH_TEST, state.isDepthTest());
+}
+
+void GLStateCache::ForgetProgram(GLuint program)
+{
+    if (programKnown && this->program == program)
+    {
+        programKnown = false;
+    }
+}
+
+void GLStateCache::Invalidate()
+{
+    capabilities.clear();
+    polygonModeKnown = false;
+    programKnown = false;
+}
+
+const GLStateStats &GLStateCache::getStats()
+{
+    return stats;
+}
+
+void GLStateCache::resetStats()
+{
+    stats = GLStateStats();
+}
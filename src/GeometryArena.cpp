@@ -0,0 +1,371 @@
+#include "../include/GeometryArena.h"
+#include "../include/InstanceBuffer.h"
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+
+// Float32 vertices, a position and a color
+constexpr std::size_t ARENA_VERTEX_FLOATS = 6;
+constexpr GLsizei ARENA_VERTEX_STRIDE = ARENA_VERTEX_FLOATS * sizeof(GLfloat);
+
+void FreeList::Reset(std::size_t capacity, std::size_t used)
+{
+    blocks.clear();
+    this->capacity = capacity;
+    freeSize = capacity - used;
+    if (freeSize > 0)
+    {
+        blocks.emplace(used, freeSize);
+    }
+}
+
+std::size_t FreeList::Allocate(std::size_t size)
+{
+    if (size == 0)
+    {
+        return 0;
+    }
+    for (std::map<std::size_t, std::size_t>::iterator block = blocks.begin(); block != blocks.end(); ++block)
+    {
+        if (block->second < size)
+        {
+            continue;
+        }
+        std::size_t offset = block->first;
+        std::size_t remaining = block->second - size;
+        blocks.erase(block);
+        if (remaining > 0)
+        {
+            blocks.emplace(offset + size, remaining);
+        }
+        freeSize -= size;
+        return offset;
+    }
+    return SIZE_MAX;
+}
+
+void FreeList::Free(std::size_t offset, std::size_t size)
+{
+    if (size == 0)
+    {
+        return;
+    }
+    freeSize += size;
+    std::map<std::size_t, std::size_t>::iterator next = blocks.lower_bound(offset);
+    if (next != blocks.end() && offset + size == next->first)
+    {
+        size += next->second;
+        next = blocks.erase(next);
+    }
+    if (next != blocks.begin())
+    {
+        std::map<std::size_t, std::size_t>::iterator previous = std::prev(next);
+        if (previous->first + previous->second == offset)
+        {
+            previous->second += size;
+            return;
+        }
+    }
+    blocks.emplace(offset, size);
+}
+
+std::size_t FreeList::getCapacity()
+{
+    return capacity;
+}
+
+std::size_t FreeList::getFreeSize()
+{
+    return freeSize;
+}
+
+std::size_t FreeList::getLargestBlock()
+{
+    std::size_t largest = 0;
+    for (const std::pair<const std::size_t, std::size_t> &block : blocks)
+    {
+        largest = std::max(largest, block.second);
+    }
+    return largest;
+}
+
+std::size_t FreeList::getBlockCount()
+{
+    return blocks.size();
+}
+
+// Private Methods
+void GeometryArena::relocate(std::size_t vertexCapacity, std::size_t indexCapacity)
+{
+    GLuint newVBO, newEBO;
+    glGenBuffers(1, &newVBO);
+    glGenBuffers(1, &newEBO);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, newVBO);
+    glBufferData(GL_COPY_WRITE_BUFFER, vertexCapacity * ARENA_VERTEX_STRIDE, nullptr, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, newEBO);
+    glBufferData(GL_COPY_WRITE_BUFFER, indexCapacity * sizeof(GLuint), nullptr, GL_STATIC_DRAW);
+
+    // the allocations keep their order so the copies read the old buffers front to back
+    std::vector<ArenaHandle> order;
+    for (ArenaHandle handle = 0; handle < allocations.size(); handle++)
+    {
+        if (allocations[handle].live)
+        {
+            order.push_back(handle);
+        }
+    }
+    std::sort(order.begin(), order.end(), [this](ArenaHandle a, ArenaHandle b)
+    {
+        return allocations[a].vertexOffset < allocations[b].vertexOffset;
+    });
+    std::size_t vertexEnd = 0;
+    std::size_t indexEnd = 0;
+    for (ArenaHandle handle : order)
+    {
+        Allocation &allocation = allocations[handle];
+        glBindBuffer(GL_COPY_READ_BUFFER, VBO);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, newVBO);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, allocation.vertexOffset * ARENA_VERTEX_STRIDE,
+                            vertexEnd * ARENA_VERTEX_STRIDE, allocation.vertexCount * ARENA_VERTEX_STRIDE);
+        glBindBuffer(GL_COPY_READ_BUFFER, EBO);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, newEBO);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, allocation.indexOffset * sizeof(GLuint),
+                            indexEnd * sizeof(GLuint), allocation.indexCount * sizeof(GLuint));
+        allocation.vertexOffset = vertexEnd;
+        allocation.indexOffset = indexEnd;
+        vertexEnd += allocation.vertexCount;
+        indexEnd += allocation.indexCount;
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    glDeleteBuffers(1, &VBO);
+    glDeleteBuffers(1, &EBO);
+    VBO = newVBO;
+    EBO = newEBO;
+    vertexBlocks.Reset(vertexCapacity, vertexEnd);
+    indexBlocks.Reset(indexCapacity, indexEnd);
+
+    // queued draws would point at the old offsets
+    commands.clear();
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, ARENA_VERTEX_STRIDE, (void*)0);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, ARENA_VERTEX_STRIDE, (void*)(3 * sizeof(GLfloat)));
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void GeometryArena::reserve(std::size_t vertexCount, std::size_t indexCount)
+{
+    if (VAO == 0)
+    {
+        glGenVertexArrays(1, &VAO);
+        relocate(std::max(INITIAL_VERTEX_CAPACITY, vertexCount), std::max(INITIAL_INDEX_CAPACITY, indexCount));
+        return;
+    }
+    bool vertexFits = vertexBlocks.getLargestBlock() >= vertexCount;
+    bool indexFits = indexBlocks.getLargestBlock() >= indexCount;
+    if (vertexFits && indexFits)
+    {
+        return;
+    }
+    std::size_t vertexCapacity = vertexBlocks.getCapacity();
+    std::size_t indexCapacity = indexBlocks.getCapacity();
+    std::size_t verticesUsed = vertexCapacity - vertexBlocks.getFreeSize();
+    std::size_t indicesUsed = indexCapacity - indexBlocks.getFreeSize();
+    while (verticesUsed + vertexCount > vertexCapacity)
+    {
+        vertexCapacity *= 2;
+    }
+    while (indicesUsed + indexCount > indexCapacity)
+    {
+        indexCapacity *= 2;
+    }
+    // with the same capacities this only compacts
+    relocate(vertexCapacity, indexCapacity);
+    stats.defragmentations++;
+}
+
+// Public Methods
+ArenaHandle GeometryArena::Add(const GLfloat *vertices, std::size_t vertexFloatCount, const GLuint *indices, std::size_t indexCount)
+{
+    std::size_t vertexCount = vertexFloatCount / ARENA_VERTEX_FLOATS;
+    if (vertexFloatCount % ARENA_VERTEX_FLOATS != 0)
+    {
+        throw std::runtime_error("Vertex data is not a multiple of 6 floats");
+    }
+    reserve(vertexCount, indexCount);
+    Allocation allocation;
+    allocation.vertexOffset = vertexBlocks.Allocate(vertexCount);
+    allocation.vertexCount = vertexCount;
+    allocation.indexOffset = indexBlocks.Allocate(indexCount);
+    allocation.indexCount = indexCount;
+    allocation.live = true;
+
+    // the copy target leaves the element buffer binding of whatever VAO is bound alone
+    glBindBuffer(GL_COPY_WRITE_BUFFER, VBO);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, allocation.vertexOffset * ARENA_VERTEX_STRIDE, vertexCount * ARENA_VERTEX_STRIDE, vertices);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, EBO);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, allocation.indexOffset * sizeof(GLuint), indexCount * sizeof(GLuint), indices);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    if (!freeHandles.empty())
+    {
+        ArenaHandle handle = freeHandles.back();
+        freeHandles.pop_back();
+        allocations[handle] = allocation;
+        return handle;
+    }
+    allocations.push_back(allocation);
+    return static_cast<ArenaHandle>(allocations.size() - 1);
+}
+
+void GeometryArena::Remove(ArenaHandle handle)
+{
+    if (handle >= allocations.size() || !allocations[handle].live)
+    {
+        return;
+    }
+    Allocation &allocation = allocations[handle];
+    vertexBlocks.Free(allocation.vertexOffset, allocation.vertexCount);
+    indexBlocks.Free(allocation.indexOffset, allocation.indexCount);
+    allocation = Allocation();
+    freeHandles.push_back(handle);
+}
+
+void GeometryArena::Defragment()
+{
+    if (VAO == 0)
+    {
+        return;
+    }
+    relocate(vertexBlocks.getCapacity(), indexBlocks.getCapacity());
+    stats.defragmentations++;
+}
+
+void GeometryArena::AddDraw(ArenaHandle handle, GLuint firstIndex, GLuint indexCount, GLuint instanceCount, GLuint baseInstance)
+{
+    if (handle >= allocations.size() || !allocations[handle].live)
+    {
+        throw std::out_of_range("Invalid arena handle " + std::to_string(handle));
+    }
+    const Allocation &allocation = allocations[handle];
+    if (firstIndex + indexCount > allocation.indexCount)
+    {
+        throw std::out_of_range("Draw of " + std::to_string(indexCount) + " indices from " + std::to_string(firstIndex) +
+                                " is past the end of the mesh");
+    }
+    commands.push_back({indexCount, instanceCount, static_cast<GLuint>(allocation.indexOffset + firstIndex),
+                        static_cast<GLint>(allocation.vertexOffset), baseInstance});
+}
+
+void GeometryArena::DrawQueued(InstanceBuffer &instances, StreamRing &stream)
+{
+    stats.draws = commands.size();
+    stats.drawCalls = 0;
+    if (commands.empty() || VAO == 0)
+    {
+        commands.clear();
+        return;
+    }
+    glBindVertexArray(VAO);
+    if (isIndirectSupported())
+    {
+        // the base instance of each command picks its instances, so the attributes always start at the first
+        if (instanceBufferId != instances.getId() || boundFirstInstance != 0)
+        {
+            instances.BindAttributes();
+            instanceBufferId = instances.getId();
+            boundFirstInstance = 0;
+        }
+        GLsizeiptr bytes = commands.size() * sizeof(DrawElementsIndirectCommand);
+        StreamAllocation allocation = stream.Allocate(bytes);
+        GLintptr offset = allocation.offset;
+        if (allocation.data != nullptr)
+        {
+            std::memcpy(allocation.data, commands.data(), bytes);
+            stream.Flush();
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, stream.getBuffer());
+        }
+        else
+        {
+            // more commands than the frame's region has room for, they get a buffer of their own
+            if (indirectBuffer == 0)
+            {
+                glGenBuffers(1, &indirectBuffer);
+            }
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+            if (bytes > indirectCapacity)
+            {
+                glBufferData(GL_DRAW_INDIRECT_BUFFER, bytes, commands.data(), GL_STREAM_DRAW);
+                indirectCapacity = bytes;
+            }
+            else
+            {
+                glBufferData(GL_DRAW_INDIRECT_BUFFER, indirectCapacity, nullptr, GL_STREAM_DRAW);
+                glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, bytes, commands.data());
+            }
+            offset = 0;
+        }
+        glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)offset, static_cast<GLsizei>(commands.size()), 0);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        stats.drawCalls = 1;
+    }
+    else
+    {
+        // no base instance before 4.2, so the instance attributes are moved to each draw's first instance
+        for (const DrawElementsIndirectCommand &command : commands)
+        {
+            if (instanceBufferId != instances.getId() || boundFirstInstance != static_cast<GLsizei>(command.baseInstance))
+            {
+                instances.BindAttributes(command.baseInstance);
+                instanceBufferId = instances.getId();
+                boundFirstInstance = command.baseInstance;
+            }
+            glDrawElementsInstancedBaseVertex(GL_TRIANGLES, command.count, GL_UNSIGNED_INT,
+                                              (void*)(GLintptr)(command.firstIndex * sizeof(GLuint)),
+                                              command.instanceCount, command.baseVertex);
+            stats.drawCalls++;
+        }
+    }
+    glBindVertexArray(0);
+    commands.clear();
+}
+
+void GeometryArena::Delete()
+{
+    glDeleteVertexArrays(1, &VAO);
+    glDeleteBuffers(1, &VBO);
+    glDeleteBuffers(1, &EBO);
+    glDeleteBuffers(1, &indirectBuffer);
+    VAO = VBO = EBO = indirectBuffer = 0;
+    indirectCapacity = 0;
+    vertexBlocks.Reset(0);
+    indexBlocks.Reset(0);
+    allocations.clear();
+    freeHandles.clear();
+    commands.clear();
+    instanceBufferId = 0;
+    boundFirstInstance = 0;
+}
+
+bool GeometryArena::isIndirectSupported()
+{
+    return GLAD_GL_VERSION_4_3 && glMultiDrawElementsIndirect != nullptr;
+}
+
+GeometryArenaStats GeometryArena::getStats()
+{
+    stats.vertexCapacity = vertexBlocks.getCapacity();
+    stats.verticesUsed = vertexBlocks.getCapacity() - vertexBlocks.getFreeSize();
+    stats.indexCapacity = indexBlocks.getCapacity();
+    stats.indicesUsed = indexBlocks.getCapacity() - indexBlocks.getFreeSize();
+    stats.allocations = allocations.size() - freeHandles.size();
+    stats.freeBlocks = vertexBlocks.getBlockCount() + indexBlocks.getBlockCount();
+    return stats;
+}
@@ -0,0 +1,49 @@
+#include "../include/GpuTimer.h"
+
+GpuTimer::GpuTimer()
+{
+    glGenQueries(QUERY_COUNT, queries);
+}
+
+void GpuTimer::Begin()
+{
+    // collect the oldest query first so its slot can be used again
+    if (pending[current])
+    {
+        GLint available = 0;
+        glGetQueryObjectiv(queries[current], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+        {
+            // the GPU is more than QUERY_COUNT frames behind, skip this measurement instead of waiting
+            skipped = true;
+            return;
+        }
+        GLuint64 nanoseconds = 0;
+        glGetQueryObjectui64v(queries[current], GL_QUERY_RESULT, &nanoseconds);
+        lastMicroseconds = nanoseconds / 1000.0;
+        pending[current] = false;
+    }
+    glBeginQuery(GL_TIME_ELAPSED, queries[current]);
+}
+
+void GpuTimer::End()
+{
+    if (skipped)
+    {
+        skipped = false;
+        return;
+    }
+    glEndQuery(GL_TIME_ELAPSED);
+    pending[current] = true;
+    current = (current + 1) % QUERY_COUNT;
+}
+
+void GpuTimer::Delete()
+{
+    glDeleteQueries(QUERY_COUNT, queries);
+}
+
+double GpuTimer::getMicroseconds()
+{
+    return lastMicroseconds;
+}
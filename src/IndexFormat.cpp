@@ -0,0 +1,107 @@
+#include "../include/IndexFormat.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+GLenum chooseIndexType(std::size_t vertexCount)
+{
+    if (vertexCount <= 0x100)
+    {
+        return GL_UNSIGNED_BYTE;
+    }
+    if (vertexCount <= 0x10000)
+    {
+        return GL_UNSIGNED_SHORT;
+    }
+    return GL_UNSIGNED_INT;
+}
+
+std::size_t getIndexSize(GLenum type)
+{
+    switch (type)
+    {
+        case GL_UNSIGNED_BYTE: return sizeof(GLubyte);
+        case GL_UNSIGNED_SHORT: return sizeof(GLushort);
+        default: return sizeof(GLuint);
+    }
+}
+
+const char *getIndexTypeName(GLenum type)
+{
+    switch (type)
+    {
+        case GL_UNSIGNED_BYTE: return "8-bit";
+        case GL_UNSIGNED_SHORT: return "16-bit";
+        default: return "32-bit";
+    }
+}
+
+// Returns the largest index, so the caller can check them all at once without a branch in the loop.
+template <typename T>
+static GLuint narrow(const GLuint *indices, std::size_t indexCount, std::uint8_t *destination)
+{
+    T *narrowed = reinterpret_cast<T *>(destination);
+    GLuint largest = 0;
+    for (std::size_t i = 0; i < indexCount; i++)
+    {
+        narrowed[i] = static_cast<T>(indices[i]);
+        largest = std::max(largest, indices[i]);
+    }
+    return largest;
+}
+
+template <typename T>
+static void widen(const std::uint8_t *source, std::size_t indexCount, GLuint *indices)
+{
+    const T *narrowed = reinterpret_cast<const T *>(source);
+    for (std::size_t i = 0; i < indexCount; i++)
+    {
+        indices[i] = narrowed[i];
+    }
+}
+
+PackedIndices packIndices(const GLuint *indices, std::size_t indexCount, std::size_t vertexCount)
+{
+    PackedIndices packed;
+    packed.type = chooseIndexType(vertexCount);
+    packed.data.resize(indexCount * getIndexSize(packed.type));
+    GLuint largest = 0;
+    switch (packed.type)
+    {
+        case GL_UNSIGNED_BYTE:
+            largest = narrow<GLubyte>(indices, indexCount, packed.data.data());
+            break;
+        case GL_UNSIGNED_SHORT:
+            largest = narrow<GLushort>(indices, indexCount, packed.data.data());
+            break;
+        default:
+            largest = narrow<GLuint>(indices, indexCount, packed.data.data());
+            break;
+    }
+    // a narrowed index that was out of range would wrap around to a vertex that does exist
+    if (indexCount > 0 && largest >= vertexCount)
+    {
+        throw std::out_of_range("Index " + std::to_string(largest) + " is past the last of " +
+                                std::to_string(vertexCount) + " vertices");
+    }
+    return packed;
+}
+
+std::vector<GLuint> unpackIndices(const PackedIndices &packed)
+{
+    std::vector<GLuint> indices(packed.data.size() / getIndexSize(packed.type));
+    switch (packed.type)
+    {
+        case GL_UNSIGNED_BYTE:
+            widen<GLubyte>(packed.data.data(), indices.size(), indices.data());
+            break;
+        case GL_UNSIGNED_SHORT:
+            widen<GLushort>(packed.data.data(), indices.size(), indices.data());
+            break;
+        default:
+            std::memcpy(indices.data(), packed.data.data(), packed.data.size());
+            break;
+    }
+    return indices;
+}
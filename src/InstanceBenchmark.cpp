@@ -0,0 +1,69 @@
+#include "../include/InstanceBenchmark.h"
+
+void InstanceBenchmark::Start(std::size_t maxInstances)
+{
+    counts.clear();
+    for (std::size_t decade = 1; decade <= maxInstances; decade *= 10)
+    {
+        counts.push_back(decade);
+        if (decade * 3 <= maxInstances)
+        {
+            counts.push_back(decade * 3);
+        }
+    }
+    if (counts.empty() || counts.back() != maxInstances)
+    {
+        counts.push_back(maxInstances);
+    }
+    results.clear();
+    step = 0;
+    frame = 0;
+    sum = {};
+    running = true;
+}
+
+void InstanceBenchmark::Stop()
+{
+    running = false;
+}
+
+void InstanceBenchmark::Record(double frameMilliseconds, double submitMicroseconds, double gpuMicroseconds)
+{
+    if (!running)
+    {
+        return;
+    }
+    frame++;
+    if (frame <= WARMUP_FRAMES)
+    {
+        return;
+    }
+    sum.frameMilliseconds += frameMilliseconds;
+    sum.submitMicroseconds += submitMicroseconds;
+    sum.gpuMicroseconds += gpuMicroseconds;
+    if (frame < WARMUP_FRAMES + MEASURED_FRAMES)
+    {
+        return;
+    }
+    results.push_back({counts[step], sum.frameMilliseconds / MEASURED_FRAMES, sum.submitMicroseconds / MEASURED_FRAMES,
+                       sum.gpuMicroseconds / MEASURED_FRAMES});
+    sum = {};
+    frame = 0;
+    step++;
+    running = step < counts.size();
+}
+
+bool InstanceBenchmark::isRunning()
+{
+    return running;
+}
+
+std::size_t InstanceBenchmark::getInstanceCount()
+{
+    return running ? counts[step] : 0;
+}
+
+const std::vector<InstanceBenchmarkResult> &InstanceBenchmark::getResults()
+{
+    return results;
+}
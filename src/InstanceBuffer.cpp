@@ -0,0 +1,159 @@
+#include "../include/InstanceBuffer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <random>
+
+static std::uint64_t nextInstanceBufferId = 1;
+
+// How many instances along each edge of the cube.
+static std::size_t getFieldSide(std::size_t count)
+{
+    std::size_t side = std::max<std::size_t>(static_cast<std::size_t>(std::cbrt(static_cast<double>(count))), 1);
+    // cbrt can land just under a whole number
+    while (side * side * side < count)
+    {
+        side++;
+    }
+    return side;
+}
+
+std::vector<InstanceData> makeInstanceField(std::size_t count, std::uint32_t seed)
+{
+    std::vector<InstanceData> instances(count);
+    std::size_t side = getFieldSide(count);
+    float spacing = 2.0f / side;
+    float scale = getInstanceFieldScale(count);
+    std::mt19937 random(seed);
+    std::normal_distribution<float> gaussian(0.0f, 1.0f);
+    std::uniform_int_distribution<int> channel(96, 255);
+    for (std::size_t i = 0; i < count; i++)
+    {
+        InstanceData &instance = instances[i];
+        std::size_t cell[3] = {i % side, (i / side) % side, i / (side * side)};
+        for (int axis = 0; axis < 3; axis++)
+        {
+            instance.position[axis] = -1.0f + spacing * (cell[axis] + 0.5f);
+        }
+        instance.scale = scale;
+        // four gaussians normalized are a uniformly random rotation
+        float length = 0.0f;
+        for (float &component : instance.rotation)
+        {
+            component = gaussian(random);
+            length += component * component;
+        }
+        length = length > 0.0f ? 1.0f / std::sqrt(length) : 0.0f;
+        for (float &component : instance.rotation)
+        {
+            component *= length;
+        }
+        if (length == 0.0f)
+        {
+            instance.rotation[3] = 1.0f;
+        }
+        for (int c = 0; c < 3; c++)
+        {
+            instance.color[c] = static_cast<std::uint8_t>(channel(random));
+        }
+        instance.color[3] = 255;
+    }
+    return instances;
+}
+
+float getInstanceFieldScale(std::size_t count)
+{
+    // the shapes are about a unit in radius, this leaves a gap between neighbors
+    return 0.4f * 2.0f / getFieldSide(count);
+}
+
+InstanceBuffer::InstanceBuffer()
+{
+    id = nextInstanceBufferId++;
+    glGenBuffers(1, &buffer);
+    source = buffer;
+}
+
+void InstanceBuffer::Update(const std::vector<InstanceData> &instances)
+{
+    GLsizeiptr bytes = instances.size() * sizeof(InstanceData);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    if (bytes > capacity)
+    {
+        glBufferData(GL_ARRAY_BUFFER, bytes, instances.data(), GL_STATIC_DRAW);
+        capacity = bytes;
+    }
+    else
+    {
+        glBufferData(GL_ARRAY_BUFFER, capacity, nullptr, GL_STATIC_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, instances.data());
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    count = static_cast<GLsizei>(instances.size());
+    if (source != buffer || sourceOffset != 0)
+    {
+        source = buffer;
+        sourceOffset = 0;
+        id = nextInstanceBufferId++;
+    }
+}
+
+void InstanceBuffer::Stream(StreamRing &stream, const std::vector<InstanceData> &instances)
+{
+    GLsizeiptr bytes = instances.size() * sizeof(InstanceData);
+    StreamAllocation allocation = stream.Allocate(bytes);
+    if (allocation.data == nullptr)
+    {
+        Update(instances);
+        return;
+    }
+    std::memcpy(allocation.data, instances.data(), bytes);
+    stream.Flush();
+    count = static_cast<GLsizei>(instances.size());
+    source = stream.getBuffer();
+    sourceOffset = allocation.offset;
+    // the region is different every frame, so the VAOs have to point at it again
+    id = nextInstanceBufferId++;
+}
+
+void InstanceBuffer::BindAttributes(GLsizei firstInstance)
+{
+    GLsizei stride = sizeof(InstanceData);
+    GLintptr first = sourceOffset + firstInstance * static_cast<GLintptr>(stride);
+    glBindBuffer(GL_ARRAY_BUFFER, source);
+    glVertexAttribPointer(INSTANCE_ATTRIBUTE_LOCATION, 4, GL_FLOAT, GL_FALSE, stride, (void*)(first + offsetof(InstanceData, position)));
+    glVertexAttribPointer(INSTANCE_ATTRIBUTE_LOCATION + 1, 4, GL_FLOAT, GL_FALSE, stride, (void*)(first + offsetof(InstanceData, rotation)));
+    glVertexAttribPointer(INSTANCE_ATTRIBUTE_LOCATION + 2, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, (void*)(first + offsetof(InstanceData, color)));
+    for (GLuint location = INSTANCE_ATTRIBUTE_LOCATION; location < INSTANCE_ATTRIBUTE_LOCATION + 3; location++)
+    {
+        glEnableVertexAttribArray(location);
+        glVertexAttribDivisor(location, 1);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void InstanceBuffer::Delete()
+{
+    glDeleteBuffers(1, &buffer);
+    buffer = 0;
+    source = 0;
+    sourceOffset = 0;
+    capacity = 0;
+    count = 0;
+}
+
+GLsizei InstanceBuffer::getCount()
+{
+    return count;
+}
+
+std::uint64_t InstanceBuffer::getId()
+{
+    return id;
+}
+
+GLsizeiptr InstanceBuffer::getSizeInBytes()
+{
+    return count * static_cast<GLsizeiptr>(sizeof(InstanceData));
+}
@@ -0,0 +1,208 @@
+#include "../include/MeshCache.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+std::string getCacheDirectory(const char *subdirectory)
+{
+    const char *cacheHome = std::getenv("XDG_CACHE_HOME");
+    if (cacheHome != nullptr && cacheHome[0] == '/')
+    {
+        return std::string(cacheHome) + "/GraphicsDemo/" + subdirectory;
+    }
+    const char *home = std::getenv("HOME");
+    if (home != nullptr && home[0] != '\0')
+    {
+        return std::string(home) + "/.cache/GraphicsDemo/" + subdirectory;
+    }
+    return (fs::temp_directory_path() / "GraphicsDemo" / subdirectory).string();
+}
+
+// Private Methods
+std::string MeshCache::getPath(std::uint64_t key) const
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.mesh", static_cast<unsigned long long>(key));
+    return directory + "/" + name;
+}
+
+// Deletes the entries used longest ago until the cache fits in its limit.
+void MeshCache::Evict()
+{
+    std::lock_guard<std::mutex> lock(evictionMutex);
+    struct Entry
+    {
+        fs::path path;
+        fs::file_time_type lastUse;
+        std::uintmax_t size;
+    };
+    std::vector<Entry> entries;
+    std::uint64_t total = 0;
+    std::error_code error;
+    for (const fs::directory_entry &file : fs::directory_iterator(directory, error))
+    {
+        if (file.path().extension() != ".mesh")
+        {
+            continue;
+        }
+        std::error_code fileError;
+        Entry entry = {file.path(), file.last_write_time(fileError), file.file_size(fileError)};
+        if (!fileError)
+        {
+            total += entry.size;
+            entries.push_back(entry);
+        }
+    }
+    if (total <= limit)
+    {
+        return;
+    }
+    std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) { return a.lastUse < b.lastUse; });
+    for (const Entry &entry : entries)
+    {
+        if (total <= limit)
+        {
+            break;
+        }
+        if (fs::remove(entry.path, error))
+        {
+            total -= entry.size;
+            evictions++;
+        }
+    }
+}
+
+// Public Methods
+MeshCache::MeshCache(std::string directory, std::uint64_t limit)
+    : directory(directory.empty() ? getCacheDirectory("meshes") : std::move(directory)), limit(limit)
+{
+}
+
+std::uint64_t MeshCache::makeKey(std::string_view verticesText, std::string_view indicesText, float weldEpsilon)
+{
+    // the lengths go in too so moving bytes from one file to the other changes the key
+    std::uint64_t header[3] = {MESH_CACHE_VERSION | (static_cast<std::uint64_t>(MESH_FILE_VERSION) << 32),
+                               verticesText.size(), indicesText.size()};
+    std::uint64_t key = meshChecksum(header, sizeof(header));
+    key = meshChecksum(&weldEpsilon, sizeof(weldEpsilon), key);
+    key = meshChecksum(verticesText.data(), verticesText.size(), key);
+    return meshChecksum(indicesText.data(), indicesText.size(), key);
+}
+
+std::unique_ptr<MappedMesh> MeshCache::Open(std::uint64_t key)
+{
+    std::string path = getPath(key);
+    std::error_code error;
+    if (!fs::exists(path, error))
+    {
+        misses++;
+        return nullptr;
+    }
+    try
+    {
+        std::unique_ptr<MappedMesh> mesh = std::make_unique<MappedMesh>(path.c_str());
+        // entries outlive the process, so a bad disk or a crash halfway through a write shows up here
+        if (!mesh->verifyChecksum())
+        {
+            throw std::runtime_error("Mesh file " + path + " has a checksum mismatch");
+        }
+        // touching the entry marks it as recently used for eviction
+        fs::last_write_time(path, fs::file_time_type::clock::now(), error);
+        hits++;
+        return mesh;
+    }
+    catch (const std::exception &exception)
+    {
+        std::cout << "ERROR::MESH_CACHE::CORRUPT_ENTRY\n" << exception.what() << std::endl;
+        fs::remove(path, error);
+        misses++;
+        return nullptr;
+    }
+}
+
+void MeshCache::Store(std::uint64_t key, const std::vector<float> &vertices, const std::vector<std::uint32_t> &indices,
+                      const std::vector<LodLevel> &lods)
+{
+    std::string path = getPath(key);
+    // each thread writes its own temporary file in case two load the same mesh at once
+    std::string temporaryPath = path + ".tmp" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+    std::error_code error;
+    try
+    {
+        fs::create_directories(directory, error);
+        std::vector<MeshFileLod> fileLods;
+        for (const LodLevel &level : lods)
+        {
+            fileLods.push_back({level.indexOffset, level.indexCount, level.error, 0});
+        }
+        writeMeshFile(temporaryPath.c_str(), vertices.data(), vertices.size(), indices.data(), indices.size(),
+                      fileLods.data(), fileLods.size());
+        fs::rename(temporaryPath, path);
+    }
+    catch (const std::exception &exception)
+    {
+        std::cout << "ERROR::MESH_CACHE::STORE_FAILED\n" << exception.what() << std::endl;
+        fs::remove(temporaryPath, error);
+        return;
+    }
+    stores++;
+    Evict();
+}
+
+void MeshCache::Clear()
+{
+    std::lock_guard<std::mutex> lock(evictionMutex);
+    std::error_code error;
+    for (const fs::directory_entry &file : fs::directory_iterator(directory, error))
+    {
+        if (file.path().extension() == ".mesh")
+        {
+            fs::remove(file.path(), error);
+        }
+    }
+}
+
+void MeshCache::setLimit(std::uint64_t bytes)
+{
+    limit = bytes;
+    Evict();
+}
+
+const std::string &MeshCache::getDirectory() const
+{
+    return directory;
+}
+
+MeshCacheStats MeshCache::getStats() const
+{
+    MeshCacheStats stats;
+    stats.hits = hits;
+    stats.misses = misses;
+    stats.stores = stores;
+    stats.evictions = evictions;
+    return stats;
+}
+
+MeshCacheUsage MeshCache::getUsage() const
+{
+    MeshCacheUsage usage;
+    std::error_code error;
+    for (const fs::directory_entry &file : fs::directory_iterator(directory, error))
+    {
+        std::error_code fileError;
+        std::uintmax_t size = file.file_size(fileError);
+        if (file.path().extension() == ".mesh" && !fileError)
+        {
+            usage.entries++;
+            usage.bytes += size;
+        }
+    }
+    return usage;
+}
@@ -0,0 +1,378 @@
+#include "../include/MeshCodec.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+// a block is stored filtered and LZ compressed, or just filtered when LZ makes it bigger
+enum class BlockMode : std::uint32_t
+{
+    Compressed = 0,
+    Stored = 1
+};
+
+struct BlockEntry
+{
+    std::uint32_t storedBytes;
+    std::uint32_t mode;
+};
+
+// the stream starts with the block count and the items per block, then a BlockEntry for every block
+constexpr std::size_t STREAM_HEADER_BYTES = 2 * sizeof(std::uint32_t);
+constexpr int LZ_HASH_BITS = 14;
+constexpr std::size_t LZ_MIN_MATCH = 4;
+constexpr std::size_t LZ_MAX_OFFSET = 65535;
+
+static std::uint32_t load32(const std::uint8_t *bytes)
+{
+    std::uint32_t value;
+    std::memcpy(&value, bytes, sizeof(value));
+    return value;
+}
+
+static std::uint32_t zigzag(std::uint32_t delta)
+{
+    return (delta << 1) ^ static_cast<std::uint32_t>(static_cast<std::int32_t>(delta) >> 31);
+}
+
+static std::uint32_t unzigzag(std::uint32_t value)
+{
+    return (value >> 1) ^ (0u - (value & 1));
+}
+
+// Literal and match lengths that don't fit in their 4 bits of the token carry on in bytes of 255.
+static void writeLength(std::vector<std::uint8_t> &output, std::size_t length)
+{
+    for (; length >= 255; length -= 255)
+    {
+        output.push_back(255);
+    }
+    output.push_back(static_cast<std::uint8_t>(length));
+}
+
+static void writeSequence(std::vector<std::uint8_t> &output, const std::uint8_t *literals, std::size_t literalCount,
+                          std::size_t offset, std::size_t matchLength)
+{
+    std::size_t matchCode = matchLength == 0 ? 0 : matchLength - LZ_MIN_MATCH;
+    output.push_back(static_cast<std::uint8_t>((std::min<std::size_t>(literalCount, 15) << 4) | std::min<std::size_t>(matchCode, 15)));
+    if (literalCount >= 15)
+    {
+        writeLength(output, literalCount - 15);
+    }
+    output.insert(output.end(), literals, literals + literalCount);
+    if (matchLength == 0)
+    {
+        return;
+    }
+    output.push_back(static_cast<std::uint8_t>(offset));
+    output.push_back(static_cast<std::uint8_t>(offset >> 8));
+    if (matchCode >= 15)
+    {
+        writeLength(output, matchCode - 15);
+    }
+}
+
+/*
+ * Greedy LZ77 in the style of LZ4: a token with the literal and match lengths, the literals, then a 16-bit
+ * offset back into what has already been decoded. The last sequence has only literals.
+ */
+std::vector<std::uint8_t> lzCompress(const std::uint8_t *input, std::size_t size)
+{
+    std::vector<std::uint8_t> output;
+    output.reserve(size / 2 + 16);
+    std::vector<std::int32_t> table(std::size_t(1) << LZ_HASH_BITS, -1);
+    std::size_t anchor = 0;
+    std::size_t position = 0;
+    while (position + LZ_MIN_MATCH <= size)
+    {
+        std::uint32_t sequence = load32(input + position);
+        std::uint32_t hash = (sequence * 2654435761u) >> (32 - LZ_HASH_BITS);
+        std::int32_t candidate = table[hash];
+        table[hash] = static_cast<std::int32_t>(position);
+        if (candidate < 0 || position - candidate > LZ_MAX_OFFSET || load32(input + candidate) != sequence)
+        {
+            // skip faster through data that doesn't compress
+            position += 1 + ((position - anchor) >> 6);
+            continue;
+        }
+        std::size_t length = LZ_MIN_MATCH;
+        while (position + length < size && input[candidate + length] == input[position + length])
+        {
+            length++;
+        }
+        writeSequence(output, input + anchor, position - anchor, position - candidate, length);
+        position += length;
+        anchor = position;
+    }
+    writeSequence(output, input + anchor, size - anchor, 0, 0);
+    return output;
+}
+
+static std::size_t readLength(const std::uint8_t *&input, const std::uint8_t *end)
+{
+    std::size_t length = 0;
+    std::uint8_t byte;
+    do
+    {
+        if (input == end)
+        {
+            throw std::runtime_error("LZ stream is truncated");
+        }
+        byte = *input++;
+        length += byte;
+    }
+    while (byte == 255);
+    return length;
+}
+
+void lzDecompress(const std::uint8_t *input, std::size_t size, std::uint8_t *output, std::size_t outputSize)
+{
+    const std::uint8_t *end = input + size;
+    std::uint8_t *out = output;
+    std::uint8_t *outEnd = output + outputSize;
+    while (input < end)
+    {
+        std::uint8_t token = *input++;
+        std::size_t literalCount = token >> 4;
+        if (literalCount == 15)
+        {
+            literalCount += readLength(input, end);
+        }
+        if (literalCount > static_cast<std::size_t>(end - input) || literalCount > static_cast<std::size_t>(outEnd - out))
+        {
+            throw std::runtime_error("LZ literals run past the end of the block");
+        }
+        std::memcpy(out, input, literalCount);
+        input += literalCount;
+        out += literalCount;
+        if (input == end)
+        {
+            break;
+        }
+
+        if (end - input < 2)
+        {
+            throw std::runtime_error("LZ stream is truncated");
+        }
+        std::size_t offset = input[0] | (input[1] << 8);
+        input += 2;
+        std::size_t length = (token & 15) + LZ_MIN_MATCH;
+        if ((token & 15) == 15)
+        {
+            length += readLength(input, end);
+        }
+        if (offset == 0 || offset > static_cast<std::size_t>(out - output) || length > static_cast<std::size_t>(outEnd - out))
+        {
+            throw std::runtime_error("LZ match runs outside the block");
+        }
+        const std::uint8_t *match = out - offset;
+        if (offset == 1)
+        {
+            std::memset(out, *match, length);
+            out += length;
+            continue;
+        }
+        // a match can overlap what it writes, copying at most offset bytes at a time keeps each copy apart
+        for (std::size_t copied = 0; copied < length;)
+        {
+            std::size_t count = std::min(offset, length - copied);
+            std::memcpy(out + copied, match + copied, count);
+            copied += count;
+        }
+        out += length;
+    }
+    if (out != outEnd)
+    {
+        throw std::runtime_error("LZ stream decodes to " + std::to_string(out - output) + " bytes instead of " + std::to_string(outputSize));
+    }
+}
+
+// Turns count words into planes of bytes, each word being the zigzagged difference from the word stride
+// words before it.
+static void filterWords(const std::uint8_t *input, std::size_t count, std::size_t stride, std::uint8_t *output)
+{
+    std::size_t items = count / stride;
+    for (std::size_t word = 0; word < stride; word++)
+    {
+        std::uint8_t *planes[4] = {output + (word * 4) * items, output + (word * 4 + 1) * items,
+                                   output + (word * 4 + 2) * items, output + (word * 4 + 3) * items};
+        std::uint32_t previous = 0;
+        for (std::size_t item = 0; item < items; item++)
+        {
+            std::uint32_t value = load32(input + (item * stride + word) * 4);
+            std::uint32_t encoded = zigzag(value - previous);
+            previous = value;
+            planes[0][item] = static_cast<std::uint8_t>(encoded);
+            planes[1][item] = static_cast<std::uint8_t>(encoded >> 8);
+            planes[2][item] = static_cast<std::uint8_t>(encoded >> 16);
+            planes[3][item] = static_cast<std::uint8_t>(encoded >> 24);
+        }
+    }
+}
+
+static void unfilterWords(const std::uint8_t *input, std::size_t count, std::size_t stride, std::uint8_t *output)
+{
+    std::size_t items = count / stride;
+    for (std::size_t word = 0; word < stride; word++)
+    {
+        const std::uint8_t *planes[4] = {input + (word * 4) * items, input + (word * 4 + 1) * items,
+                                         input + (word * 4 + 2) * items, input + (word * 4 + 3) * items};
+        std::uint32_t previous = 0;
+        for (std::size_t item = 0; item < items; item++)
+        {
+            std::uint32_t encoded = planes[0][item] | (planes[1][item] << 8) | (planes[2][item] << 16) |
+                                    (static_cast<std::uint32_t>(planes[3][item]) << 24);
+            previous += unzigzag(encoded);
+            std::memcpy(output + (item * stride + word) * 4, &previous, sizeof(previous));
+        }
+    }
+}
+
+/*
+ * Both kinds of stream are words with a stride, 1 for indices and vertexSize / 4 for vertices, so they share
+ * the block handling.
+ */
+static std::vector<std::uint8_t> encodeStream(const std::uint8_t *data, std::size_t itemCount, std::size_t stride,
+                                              std::size_t itemsPerBlock, ThreadPool *pool)
+{
+    std::size_t blockCount = (itemCount + itemsPerBlock - 1) / itemsPerBlock;
+    if (blockCount > UINT32_MAX)
+    {
+        throw std::runtime_error("Mesh stream has too many blocks");
+    }
+    std::vector<std::vector<std::uint8_t>> blocks(blockCount);
+    std::vector<BlockMode> modes(blockCount);
+    auto encodeBlock = [&](std::size_t block)
+    {
+        std::size_t first = block * itemsPerBlock;
+        std::size_t items = std::min(itemsPerBlock, itemCount - first);
+        std::size_t bytes = items * stride * 4;
+        std::vector<std::uint8_t> filtered(bytes);
+        filterWords(data + first * stride * 4, items * stride, stride, filtered.data());
+        blocks[block] = lzCompress(filtered.data(), bytes);
+        modes[block] = BlockMode::Compressed;
+        if (blocks[block].size() >= bytes)
+        {
+            blocks[block] = std::move(filtered);
+            modes[block] = BlockMode::Stored;
+        }
+    };
+    if (pool != nullptr)
+    {
+        pool->ParallelFor(blockCount, encodeBlock);
+    }
+    else
+    {
+        for (std::size_t block = 0; block < blockCount; block++)
+        {
+            encodeBlock(block);
+        }
+    }
+
+    std::vector<std::uint8_t> stream(STREAM_HEADER_BYTES + blockCount * sizeof(BlockEntry));
+    std::uint32_t header[2] = {static_cast<std::uint32_t>(blockCount), static_cast<std::uint32_t>(itemsPerBlock)};
+    std::memcpy(stream.data(), header, sizeof(header));
+    for (std::size_t block = 0; block < blockCount; block++)
+    {
+        BlockEntry entry = {static_cast<std::uint32_t>(blocks[block].size()), static_cast<std::uint32_t>(modes[block])};
+        std::memcpy(stream.data() + STREAM_HEADER_BYTES + block * sizeof(BlockEntry), &entry, sizeof(entry));
+        stream.insert(stream.end(), blocks[block].begin(), blocks[block].end());
+    }
+    return stream;
+}
+
+static void decodeStream(const std::uint8_t *stream, std::size_t streamSize, std::uint8_t *destination,
+                         std::size_t itemCount, std::size_t stride, ThreadPool *pool)
+{
+    if (streamSize < STREAM_HEADER_BYTES)
+    {
+        throw std::runtime_error("Mesh stream is truncated");
+    }
+    std::uint32_t header[2];
+    std::memcpy(header, stream, sizeof(header));
+    std::size_t blockCount = header[0];
+    std::size_t itemsPerBlock = header[1];
+    if (itemsPerBlock == 0 || blockCount != (itemCount + itemsPerBlock - 1) / itemsPerBlock ||
+        blockCount > (streamSize - STREAM_HEADER_BYTES) / sizeof(BlockEntry))
+    {
+        throw std::runtime_error("Mesh stream doesn't match the mesh it belongs to");
+    }
+    // where each block starts, found before any decoding so the blocks can go in any order
+    std::vector<std::size_t> offsets(blockCount + 1);
+    std::vector<BlockEntry> entries(blockCount);
+    if (blockCount > 0)
+    {
+        std::memcpy(entries.data(), stream + STREAM_HEADER_BYTES, blockCount * sizeof(BlockEntry));
+    }
+    offsets[0] = STREAM_HEADER_BYTES + blockCount * sizeof(BlockEntry);
+    for (std::size_t block = 0; block < blockCount; block++)
+    {
+        if (entries[block].storedBytes > streamSize - offsets[block])
+        {
+            throw std::runtime_error("Mesh stream block " + std::to_string(block) + " is truncated");
+        }
+        offsets[block + 1] = offsets[block] + entries[block].storedBytes;
+    }
+
+    auto decodeBlock = [&](std::size_t block)
+    {
+        std::size_t first = block * itemsPerBlock;
+        std::size_t items = std::min(itemsPerBlock, itemCount - first);
+        std::size_t bytes = items * stride * 4;
+        const std::uint8_t *stored = stream + offsets[block];
+        std::vector<std::uint8_t> filtered;
+        if (entries[block].mode == static_cast<std::uint32_t>(BlockMode::Compressed))
+        {
+            filtered.resize(bytes);
+            lzDecompress(stored, entries[block].storedBytes, filtered.data(), bytes);
+            stored = filtered.data();
+        }
+        else if (entries[block].mode != static_cast<std::uint32_t>(BlockMode::Stored) || entries[block].storedBytes != bytes)
+        {
+            throw std::runtime_error("Mesh stream block " + std::to_string(block) + " is corrupt");
+        }
+        unfilterWords(stored, items * stride, stride, destination + first * stride * 4);
+    };
+    if (pool != nullptr)
+    {
+        pool->ParallelFor(blockCount, decodeBlock);
+    }
+    else
+    {
+        for (std::size_t block = 0; block < blockCount; block++)
+        {
+            decodeBlock(block);
+        }
+    }
+}
+
+std::vector<std::uint8_t> encodeVertexStream(const void *vertices, std::size_t vertexCount, std::size_t vertexSize, ThreadPool *pool)
+{
+    if (vertexSize == 0 || vertexSize % 4 != 0)
+    {
+        throw std::invalid_argument("Vertex size has to be a multiple of 4 bytes");
+    }
+    return encodeStream(static_cast<const std::uint8_t *>(vertices), vertexCount, vertexSize / 4, MESH_CODEC_BLOCK_VERTICES, pool);
+}
+
+std::vector<std::uint8_t> encodeIndexStream(const std::uint32_t *indices, std::size_t indexCount, ThreadPool *pool)
+{
+    return encodeStream(reinterpret_cast<const std::uint8_t *>(indices), indexCount, 1, MESH_CODEC_BLOCK_INDICES, pool);
+}
+
+void decodeVertexStream(const void *stream, std::size_t streamSize, void *destination, std::size_t vertexCount,
+                        std::size_t vertexSize, ThreadPool *pool)
+{
+    if (vertexSize == 0 || vertexSize % 4 != 0)
+    {
+        throw std::invalid_argument("Vertex size has to be a multiple of 4 bytes");
+    }
+    decodeStream(static_cast<const std::uint8_t *>(stream), streamSize, static_cast<std::uint8_t *>(destination),
+                 vertexCount, vertexSize / 4, pool);
+}
+
+void decodeIndexStream(const void *stream, std::size_t streamSize, std::uint32_t *destination, std::size_t indexCount, ThreadPool *pool)
+{
+    decodeStream(static_cast<const std::uint8_t *>(stream), streamSize, reinterpret_cast<std::uint8_t *>(destination),
+                 indexCount, 1, pool);
+}
@@ -0,0 +1,344 @@
+#include "../include/MeshFile.h"
+#include "../include/AssetPack.h"
+#include "../include/MeshCodec.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static std::uint64_t alignUp(std::uint64_t value, std::uint64_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+std::uint64_t meshChecksum(const void *data, std::size_t size, std::uint64_t seed)
+{
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    std::uint64_t hash = seed;
+    for (std::size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+void writeMeshFile(const char *path, const float *vertices, std::size_t vertexFloatCount,
+                   const std::uint32_t *indices, std::size_t indexCount,
+                   const MeshFileLod *lods, std::size_t lodCount, bool compress)
+{
+    if (vertexFloatCount % 6 != 0)
+    {
+        throw std::runtime_error("Vertex data for " + std::string(path) + " is not a multiple of 6 floats");
+    }
+    std::size_t vertexCount = vertexFloatCount / 6;
+    for (std::size_t i = 0; i < indexCount; i++)
+    {
+        if (indices[i] >= vertexCount)
+        {
+            throw std::runtime_error("Index " + std::to_string(indices[i]) + " is out of range in " + std::string(path));
+        }
+    }
+    for (std::size_t i = 0; i < lodCount; i++)
+    {
+        if (lods[i].indexOffset > indexCount || lods[i].indexCount > indexCount - lods[i].indexOffset)
+        {
+            throw std::runtime_error("LOD " + std::to_string(i) + " is out of range in " + std::string(path));
+        }
+    }
+
+    MeshFileHeader header{};
+    header.magic = MESH_FILE_MAGIC;
+    header.version = MESH_FILE_VERSION;
+    header.vertexLayout = static_cast<std::uint32_t>(MeshVertexLayout::PositionColorF32);
+    header.vertexStride = 6 * sizeof(float);
+    header.indexSize = sizeof(std::uint32_t);
+    header.vertexCount = vertexCount;
+    header.indexCount = indexCount;
+    header.vertexBytes = vertexFloatCount * sizeof(float);
+    header.indexBytes = indexCount * sizeof(std::uint32_t);
+    // the blobs as they go in the file
+    const void *vertexBlob = vertices;
+    const void *indexBlob = indices;
+    std::vector<std::uint8_t> vertexStream;
+    std::vector<std::uint8_t> indexStream;
+    if (compress)
+    {
+        vertexStream = encodeVertexStream(vertices, vertexCount, header.vertexStride);
+        indexStream = encodeIndexStream(indices, indexCount);
+        header.flags |= MESH_FILE_COMPRESSED;
+        header.vertexBytes = vertexStream.size();
+        header.indexBytes = indexStream.size();
+        vertexBlob = vertexStream.data();
+        indexBlob = indexStream.data();
+    }
+    header.vertexOffset = alignUp(sizeof(MeshFileHeader), MESH_FILE_ALIGNMENT);
+    header.indexOffset = alignUp(header.vertexOffset + header.vertexBytes, MESH_FILE_ALIGNMENT);
+    header.lodCount = lodCount;
+    header.lodOffset = alignUp(header.indexOffset + header.indexBytes, MESH_FILE_ALIGNMENT);
+
+    // bounds of the positions, an empty mesh gets zero bounds
+    float boundsMin[3] = {0.0f, 0.0f, 0.0f};
+    float boundsMax[3] = {0.0f, 0.0f, 0.0f};
+    if (vertexCount > 0)
+    {
+        for (int axis = 0; axis < 3; axis++)
+        {
+            boundsMin[axis] = std::numeric_limits<float>::max();
+            boundsMax[axis] = std::numeric_limits<float>::lowest();
+        }
+        for (std::size_t v = 0; v < vertexCount; v++)
+        {
+            for (int axis = 0; axis < 3; axis++)
+            {
+                boundsMin[axis] = std::min(boundsMin[axis], vertices[v * 6 + axis]);
+                boundsMax[axis] = std::max(boundsMax[axis], vertices[v * 6 + axis]);
+            }
+        }
+    }
+    std::memcpy(header.boundsMin, boundsMin, sizeof(boundsMin));
+    std::memcpy(header.boundsMax, boundsMax, sizeof(boundsMax));
+
+    header.checksum = meshChecksum(vertexBlob, header.vertexBytes);
+    header.checksum = meshChecksum(indexBlob, header.indexBytes, header.checksum);
+    header.checksum = meshChecksum(lods, lodCount * sizeof(MeshFileLod), header.checksum);
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+    {
+        throw std::runtime_error("Could not open file " + std::string(path));
+    }
+    static const char padding[MESH_FILE_ALIGNMENT] = {};
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(padding, header.vertexOffset - sizeof(header));
+    file.write(static_cast<const char *>(vertexBlob), header.vertexBytes);
+    file.write(padding, header.indexOffset - (header.vertexOffset + header.vertexBytes));
+    file.write(static_cast<const char *>(indexBlob), header.indexBytes);
+    file.write(padding, header.lodOffset - (header.indexOffset + header.indexBytes));
+    file.write(reinterpret_cast<const char *>(lods), lodCount * sizeof(MeshFileLod));
+    if (!file)
+    {
+        throw std::runtime_error("Could not write file " + std::string(path));
+    }
+}
+
+MappedMesh::MappedMesh(const char *path)
+{
+    // a mesh in the asset pack is used straight out of the pack's mapping
+    std::optional<std::string_view> packed = AssetPackMount::getShared().find(path);
+    if (packed)
+    {
+        if (packed->size() < sizeof(MeshFileHeader))
+        {
+            throw std::runtime_error("Mesh file " + std::string(path) + " is too small");
+        }
+        mapping = const_cast<char *>(packed->data());
+        mappingSize = packed->size();
+        ownsMapping = false;
+        validate(path);
+        decode(path);
+        checkIndices(path);
+        return;
+    }
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        throw std::runtime_error("Could not open file " + std::string(path));
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<std::size_t>(info.st_size) < sizeof(MeshFileHeader))
+    {
+        close(fd);
+        throw std::runtime_error("Mesh file " + std::string(path) + " is too small");
+    }
+    mappingSize = info.st_size;
+    mapping = mmap(nullptr, mappingSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping keeps its own reference to the file
+    close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        mapping = nullptr;
+        throw std::runtime_error("Could not map file " + std::string(path));
+    }
+    // the blobs are read front to back exactly once when they are uploaded
+    madvise(mapping, mappingSize, MADV_SEQUENTIAL);
+    madvise(mapping, mappingSize, MADV_WILLNEED);
+    validate(path);
+    decode(path);
+    checkIndices(path);
+}
+
+void MappedMesh::validate(const char *path)
+{
+    header = static_cast<const MeshFileHeader *>(mapping);
+    std::string error;
+    if (header->magic != MESH_FILE_MAGIC)
+    {
+        error = "is not a mesh file";
+    }
+    else if (header->version < 1 || header->version > MESH_FILE_VERSION)
+    {
+        error = "has unsupported version " + std::to_string(header->version);
+    }
+    else if (header->vertexLayout != static_cast<std::uint32_t>(MeshVertexLayout::PositionColorF32) ||
+             header->vertexStride != 6 * sizeof(float) || header->indexSize != sizeof(std::uint32_t))
+    {
+        error = "has an unsupported layout";
+    }
+    else if (header->version < 3 && header->flags != 0)
+    {
+        error = "has flags from a newer version";
+    }
+    else if ((header->flags & ~MESH_FILE_COMPRESSED) != 0)
+    {
+        error = "has unsupported flags";
+    }
+    // divided rather than multiplied, a count picked so its product wraps around would pass the comparison
+    else if ((!isCompressed() && (header->vertexBytes % header->vertexStride != 0 ||
+                                  header->vertexCount != header->vertexBytes / header->vertexStride ||
+                                  header->indexBytes % header->indexSize != 0 ||
+                                  header->indexCount != header->indexBytes / header->indexSize)) ||
+             header->vertexOffset % MESH_FILE_ALIGNMENT != 0 || header->indexOffset % MESH_FILE_ALIGNMENT != 0 ||
+             header->vertexOffset > mappingSize || header->vertexBytes > mappingSize - header->vertexOffset ||
+             header->indexOffset > mappingSize || header->indexBytes > mappingSize - header->indexOffset)
+    {
+        error = "is truncated or corrupt";
+    }
+    else if (header->version >= 2 &&
+             (header->lodOffset % MESH_FILE_ALIGNMENT != 0 || header->lodOffset > mappingSize ||
+              header->lodCount > (mappingSize - header->lodOffset) / sizeof(MeshFileLod)))
+    {
+        error = "has a truncated LOD table";
+    }
+    else
+    {
+        for (std::size_t i = 0; i < getLodCount(); i++)
+        {
+            const MeshFileLod &lod = getLods()[i];
+            if (lod.indexOffset > header->indexCount || lod.indexCount > header->indexCount - lod.indexOffset)
+            {
+                error = "has a LOD outside the index blob";
+            }
+        }
+    }
+    if (!error.empty())
+    {
+        if (ownsMapping)
+        {
+            munmap(mapping, mappingSize);
+        }
+        mapping = nullptr;
+        throw std::runtime_error("Mesh file " + std::string(path) + " " + error);
+    }
+}
+
+void MappedMesh::decode(const char *path)
+{
+    if (!isCompressed())
+    {
+        return;
+    }
+    try
+    {
+        // LZ can't expand a byte into more than 255, anything bigger is a corrupt header and not worth allocating
+        if (header->vertexCount > header->vertexBytes * 255 || header->indexCount > header->indexBytes * 255)
+        {
+            throw std::runtime_error("has more data than its streams can hold");
+        }
+        decodedVertices.resize(header->vertexCount * 6);
+        decodedIndices.resize(header->indexCount);
+        decodeVertexStream(getStoredVertexData(), header->vertexBytes, decodedVertices.data(), header->vertexCount, header->vertexStride);
+        decodeIndexStream(getStoredIndexData(), header->indexBytes, decodedIndices.data(), header->indexCount);
+    }
+    catch (const std::exception &exception)
+    {
+        if (ownsMapping)
+        {
+            munmap(mapping, mappingSize);
+        }
+        mapping = nullptr;
+        throw std::runtime_error("Mesh file " + std::string(path) + " " + exception.what());
+    }
+}
+
+// Every index has to name a vertex, or narrowing them for upload would wrap them onto the wrong vertex.
+void MappedMesh::checkIndices(const char *path)
+{
+    const std::uint32_t *indices = static_cast<const std::uint32_t *>(getIndexData());
+    for (std::size_t i = 0; i < header->indexCount; i++)
+    {
+        if (indices[i] >= header->vertexCount)
+        {
+            std::string error = "has index " + std::to_string(indices[i]) + " past the last vertex";
+            if (ownsMapping)
+            {
+                munmap(mapping, mappingSize);
+            }
+            mapping = nullptr;
+            throw std::runtime_error("Mesh file " + std::string(path) + " " + error);
+        }
+    }
+}
+
+MappedMesh::~MappedMesh()
+{
+    if (mapping != nullptr && ownsMapping)
+    {
+        munmap(mapping, mappingSize);
+    }
+}
+
+bool MappedMesh::verifyChecksum() const
+{
+    std::uint64_t checksum = meshChecksum(getStoredVertexData(), header->vertexBytes);
+    checksum = meshChecksum(getStoredIndexData(), header->indexBytes, checksum);
+    checksum = meshChecksum(getLods(), getLodCount() * sizeof(MeshFileLod), checksum);
+    return checksum == header->checksum;
+}
+
+const MeshFileHeader &MappedMesh::getHeader() const
+{
+    return *header;
+}
+
+bool MappedMesh::isCompressed() const
+{
+    return (header->flags & MESH_FILE_COMPRESSED) != 0;
+}
+
+const void *MappedMesh::getStoredVertexData() const
+{
+    return static_cast<const char *>(mapping) + header->vertexOffset;
+}
+
+const void *MappedMesh::getStoredIndexData() const
+{
+    return static_cast<const char *>(mapping) + header->indexOffset;
+}
+
+const void *MappedMesh::getVertexData() const
+{
+    return isCompressed() ? static_cast<const void *>(decodedVertices.data()) : getStoredVertexData();
+}
+
+const void *MappedMesh::getIndexData() const
+{
+    return isCompressed() ? static_cast<const void *>(decodedIndices.data()) : getStoredIndexData();
+}
+
+const MeshFileLod *MappedMesh::getLods() const
+{
+    return reinterpret_cast<const MeshFileLod *>(static_cast<const char *>(mapping) + header->lodOffset);
+}
+
+std::size_t MappedMesh::getLodCount() const
+{
+    // version 1 had zeros where the LOD fields are now
+    return header->version >= 2 ? header->lodCount : 0;
+}
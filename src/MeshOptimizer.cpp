@@ -0,0 +1,459 @@
+#include "../include/MeshOptimizer.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <numeric>
+#include <unordered_map>
+
+using WeldKey = std::array<std::int64_t, 6>;
+
+struct WeldKeyHash
+{
+    std::size_t operator()(const WeldKey &key) const
+    {
+        std::uint64_t hash = 0xcbf29ce484222325ull;
+        for (std::int64_t value : key)
+        {
+            hash = (hash ^ static_cast<std::uint64_t>(value)) * 0x100000001b3ull;
+            hash ^= hash >> 29;
+        }
+        return static_cast<std::size_t>(hash);
+    }
+};
+
+static std::int64_t weldCell(float value, float epsilon)
+{
+    // 0.0 and -0.0 compare equal, so they have to land in the same cell
+    if (value == 0.0f)
+    {
+        return 0;
+    }
+    double cell = epsilon > 0.0f ? std::round(static_cast<double>(value) / epsilon) : 0.0;
+    if (epsilon <= 0.0f || !std::isfinite(cell) || std::abs(cell) > 0x1p62)
+    {
+        // exact matching, or a value too far out for the grid, compares bit patterns instead
+        return static_cast<std::int64_t>(std::bit_cast<std::uint32_t>(value)) | (std::int64_t(1) << 62);
+    }
+    return static_cast<std::int64_t>(cell);
+}
+
+WeldReport weldVertices(std::vector<float> &vertices, std::vector<std::uint32_t> &indices, float epsilon)
+{
+    std::size_t vertexCount = vertices.size() / 6;
+    std::unordered_map<WeldKey, std::uint32_t, WeldKeyHash> cells;
+    cells.reserve(vertexCount);
+    std::vector<std::uint32_t> remap(vertexCount);
+    std::vector<float> welded;
+    welded.reserve(vertices.size());
+    for (std::size_t v = 0; v < vertexCount; v++)
+    {
+        WeldKey key;
+        for (int component = 0; component < 6; component++)
+        {
+            key[component] = weldCell(vertices[v * 6 + component], epsilon);
+        }
+        // the first vertex in a cell is the one that is kept
+        auto [cell, inserted] = cells.try_emplace(key, static_cast<std::uint32_t>(welded.size() / 6));
+        if (inserted)
+        {
+            welded.insert(welded.end(), vertices.begin() + v * 6, vertices.begin() + v * 6 + 6);
+        }
+        remap[v] = cell->second;
+    }
+    for (std::uint32_t &index : indices)
+    {
+        index = remap[index];
+    }
+
+    WeldReport report;
+    report.verticesRemoved = vertexCount - welded.size() / 6;
+    report.bytesRemoved = report.verticesRemoved * 6 * sizeof(float);
+    vertices.swap(welded);
+    return report;
+}
+
+VertexCacheStats analyzeVertexCache(const std::uint32_t *indices, std::size_t indexCount, std::size_t vertexCount,
+                                    std::size_t cacheSize)
+{
+    VertexCacheStats stats;
+    // a vertex is in the FIFO if fewer than cacheSize misses happened since it was last loaded
+    std::vector<std::size_t> loadedAt(vertexCount, 0);
+    std::vector<bool> used(vertexCount, false);
+    std::size_t timestamp = cacheSize + 1;
+    std::size_t usedCount = 0;
+    for (std::size_t i = 0; i < indexCount; i++)
+    {
+        std::uint32_t vertex = indices[i];
+        // the callers check their indices first, this only keeps a bad one from writing past the arrays
+        if (vertex >= vertexCount)
+        {
+            continue;
+        }
+        if (timestamp - loadedAt[vertex] > cacheSize)
+        {
+            loadedAt[vertex] = timestamp++;
+            stats.misses++;
+        }
+        if (!used[vertex])
+        {
+            used[vertex] = true;
+            usedCount++;
+        }
+    }
+    std::size_t triangleCount = indexCount / 3;
+    stats.acmr = triangleCount == 0 ? 0.0f : static_cast<float>(stats.misses) / triangleCount;
+    stats.atvr = usedCount == 0 ? 0.0f : static_cast<float>(stats.misses) / usedCount;
+    return stats;
+}
+
+// Forsyth's scoring constants, see "Linear-Speed Vertex Cache Optimisation"
+constexpr int FORSYTH_CACHE_SIZE = 32;
+constexpr float FORSYTH_LAST_TRIANGLE_SCORE = 0.75f;
+constexpr float FORSYTH_CACHE_DECAY_POWER = 1.5f;
+constexpr float FORSYTH_VALENCE_BOOST_SCALE = 2.0f;
+constexpr float FORSYTH_VALENCE_BOOST_POWER = 0.5f;
+
+static float forsythScore(int cachePosition, std::uint32_t liveTriangles)
+{
+    if (liveTriangles == 0)
+    {
+        return -1.0f;
+    }
+    float score = 0.0f;
+    if (cachePosition >= 0)
+    {
+        if (cachePosition < 3)
+        {
+            score = FORSYTH_LAST_TRIANGLE_SCORE;
+        }
+        else
+        {
+            float scaler = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+            score = std::pow(1.0f - (cachePosition - 3) * scaler, FORSYTH_CACHE_DECAY_POWER);
+        }
+    }
+    // vertices with few triangles left get a boost so they are finished off instead of left as stragglers
+    return score + FORSYTH_VALENCE_BOOST_SCALE * std::pow(static_cast<float>(liveTriangles), -FORSYTH_VALENCE_BOOST_POWER);
+}
+
+void optimizeVertexCache(std::uint32_t *indices, std::size_t indexCount, std::size_t vertexCount)
+{
+    std::size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0)
+    {
+        return;
+    }
+    std::vector<std::uint32_t> source(indices, indices + triangleCount * 3);
+
+    // triangles that use each vertex, stored back to back with an offset per vertex
+    std::vector<std::uint32_t> liveTriangles(vertexCount, 0);
+    for (std::uint32_t vertex : source)
+    {
+        liveTriangles[vertex]++;
+    }
+    std::vector<std::size_t> adjacencyOffset(vertexCount + 1, 0);
+    for (std::size_t v = 0; v < vertexCount; v++)
+    {
+        adjacencyOffset[v + 1] = adjacencyOffset[v] + liveTriangles[v];
+    }
+    std::vector<std::uint32_t> adjacency(source.size());
+    std::vector<std::size_t> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+    for (std::size_t t = 0; t < triangleCount; t++)
+    {
+        for (int corner = 0; corner < 3; corner++)
+        {
+            adjacency[fill[source[t * 3 + corner]]++] = static_cast<std::uint32_t>(t);
+        }
+    }
+
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> vertexScore(vertexCount);
+    for (std::size_t v = 0; v < vertexCount; v++)
+    {
+        vertexScore[v] = forsythScore(-1, liveTriangles[v]);
+    }
+    std::vector<bool> emitted(triangleCount, false);
+
+    std::vector<std::uint32_t> cache;
+    std::vector<std::uint32_t> nextCache;
+    cache.reserve(FORSYTH_CACHE_SIZE + 3);
+    nextCache.reserve(FORSYTH_CACHE_SIZE + 3);
+    std::size_t output = 0;
+    std::size_t scan = 0;
+    std::size_t bestTriangle = SIZE_MAX;
+
+    while (output < triangleCount)
+    {
+        if (bestTriangle == SIZE_MAX)
+        {
+            // nothing in the cache has triangles left, carry on with the next triangle in the original order
+            while (emitted[scan])
+            {
+                scan++;
+            }
+            bestTriangle = scan;
+        }
+        std::size_t t = bestTriangle;
+        emitted[t] = true;
+        const std::uint32_t *triangle = &source[t * 3];
+        for (int corner = 0; corner < 3; corner++)
+        {
+            indices[output * 3 + corner] = triangle[corner];
+        }
+        output++;
+
+        // take the triangle out of its vertices' adjacency lists
+        for (int corner = 0; corner < 3; corner++)
+        {
+            std::uint32_t vertex = triangle[corner];
+            std::uint32_t *begin = &adjacency[adjacencyOffset[vertex]];
+            std::uint32_t *end = begin + liveTriangles[vertex];
+            std::uint32_t *found = std::find(begin, end, static_cast<std::uint32_t>(t));
+            if (found != end)
+            {
+                std::swap(*found, *(end - 1));
+                liveTriangles[vertex]--;
+            }
+        }
+
+        // the triangle's vertices move to the front of the LRU cache
+        nextCache.assign(triangle, triangle + 3);
+        for (std::uint32_t vertex : cache)
+        {
+            if (vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2])
+            {
+                nextCache.push_back(vertex);
+            }
+        }
+        for (std::size_t i = 0; i < nextCache.size(); i++)
+        {
+            std::uint32_t vertex = nextCache[i];
+            cachePosition[vertex] = i < FORSYTH_CACHE_SIZE ? static_cast<int>(i) : -1;
+            vertexScore[vertex] = forsythScore(cachePosition[vertex], liveTriangles[vertex]);
+        }
+
+        // only triangles touching the cache changed score, pick the best of them
+        bestTriangle = SIZE_MAX;
+        float bestScore = -1.0f;
+        for (std::uint32_t vertex : nextCache)
+        {
+            for (std::size_t i = 0; i < liveTriangles[vertex]; i++)
+            {
+                std::uint32_t candidate = adjacency[adjacencyOffset[vertex] + i];
+                const std::uint32_t *corners = &source[candidate * 3];
+                float score = vertexScore[corners[0]] + vertexScore[corners[1]] + vertexScore[corners[2]];
+                if (score > bestScore)
+                {
+                    bestScore = score;
+                    bestTriangle = candidate;
+                }
+            }
+        }
+        if (nextCache.size() > FORSYTH_CACHE_SIZE)
+        {
+            nextCache.resize(FORSYTH_CACHE_SIZE);
+        }
+        cache.swap(nextCache);
+    }
+}
+
+// Cache misses for one triangle against a FIFO simulated with timestamps, like analyzeVertexCache.
+static unsigned simulateTriangle(const std::uint32_t *triangle, std::vector<std::size_t> &loadedAt, std::size_t &timestamp)
+{
+    unsigned misses = 0;
+    for (int corner = 0; corner < 3; corner++)
+    {
+        std::uint32_t vertex = triangle[corner];
+        if (timestamp - loadedAt[vertex] > VERTEX_CACHE_SIZE)
+        {
+            loadedAt[vertex] = timestamp++;
+            misses++;
+        }
+    }
+    return misses;
+}
+
+void optimizeOverdraw(std::uint32_t *indices, std::size_t indexCount, const float *vertices, std::size_t vertexCount,
+                      float threshold)
+{
+    std::size_t triangleCount = indexCount / 3;
+    if (triangleCount < 2)
+    {
+        return;
+    }
+
+    // hard boundaries are where the cache order starts over, a triangle that misses on every corner
+    std::vector<std::size_t> hardBoundaries;
+    {
+        std::vector<std::size_t> loadedAt(vertexCount, 0);
+        std::size_t timestamp = VERTEX_CACHE_SIZE + 1;
+        for (std::size_t t = 0; t < triangleCount; t++)
+        {
+            if (simulateTriangle(&indices[t * 3], loadedAt, timestamp) == 3)
+            {
+                hardBoundaries.push_back(t);
+            }
+        }
+        if (hardBoundaries.empty() || hardBoundaries[0] != 0)
+        {
+            hardBoundaries.insert(hardBoundaries.begin(), 0);
+        }
+        hardBoundaries.push_back(triangleCount);
+    }
+
+    // soft boundaries split a hard cluster wherever the running ACMR is already close to the cluster's
+    std::vector<std::size_t> boundaries;
+    std::vector<std::size_t> loadedAt(vertexCount, 0);
+    std::size_t timestamp = VERTEX_CACHE_SIZE + 1;
+    for (std::size_t c = 0; c + 1 < hardBoundaries.size(); c++)
+    {
+        std::size_t start = hardBoundaries[c];
+        std::size_t end = hardBoundaries[c + 1];
+        // a cache flush is just moving the clock past every loaded vertex
+        timestamp += VERTEX_CACHE_SIZE + 1;
+        std::size_t clusterMisses = 0;
+        for (std::size_t t = start; t < end; t++)
+        {
+            clusterMisses += simulateTriangle(&indices[t * 3], loadedAt, timestamp);
+        }
+        float clusterAcmr = static_cast<float>(clusterMisses) / (end - start);
+
+        timestamp += VERTEX_CACHE_SIZE + 1;
+        boundaries.push_back(start);
+        std::size_t runningMisses = 0;
+        std::size_t runningStart = start;
+        for (std::size_t t = start; t < end; t++)
+        {
+            runningMisses += simulateTriangle(&indices[t * 3], loadedAt, timestamp);
+            float runningAcmr = static_cast<float>(runningMisses) / (t - runningStart + 1);
+            if (t + 1 < end && runningAcmr <= clusterAcmr * threshold)
+            {
+                boundaries.push_back(t + 1);
+                runningStart = t + 1;
+                runningMisses = 0;
+                timestamp += VERTEX_CACHE_SIZE + 1;
+            }
+        }
+    }
+    boundaries.push_back(triangleCount);
+
+    // area weighted centroid of the whole mesh
+    auto position = [vertices](std::uint32_t vertex, int axis) { return vertices[vertex * 6 + axis]; };
+    auto triangleArea = [&](std::size_t t, float centroid[3], float normal[3])
+    {
+        const std::uint32_t *triangle = &indices[t * 3];
+        float edge1[3];
+        float edge2[3];
+        for (int axis = 0; axis < 3; axis++)
+        {
+            edge1[axis] = position(triangle[1], axis) - position(triangle[0], axis);
+            edge2[axis] = position(triangle[2], axis) - position(triangle[0], axis);
+            centroid[axis] = (position(triangle[0], axis) + position(triangle[1], axis) + position(triangle[2], axis)) / 3.0f;
+        }
+        normal[0] = edge1[1] * edge2[2] - edge1[2] * edge2[1];
+        normal[1] = edge1[2] * edge2[0] - edge1[0] * edge2[2];
+        normal[2] = edge1[0] * edge2[1] - edge1[1] * edge2[0];
+        return std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+    };
+    float meshCentroid[3] = {0.0f, 0.0f, 0.0f};
+    float totalArea = 0.0f;
+    for (std::size_t t = 0; t < triangleCount; t++)
+    {
+        float centroid[3];
+        float normal[3];
+        float area = triangleArea(t, centroid, normal);
+        for (int axis = 0; axis < 3; axis++)
+        {
+            meshCentroid[axis] += centroid[axis] * area;
+        }
+        totalArea += area;
+    }
+    for (int axis = 0; axis < 3; axis++)
+    {
+        meshCentroid[axis] = totalArea > 0.0f ? meshCentroid[axis] / totalArea : 0.0f;
+    }
+
+    // clusters that face outward from the center are likely to be in front, so they are drawn first
+    std::size_t clusterCount = boundaries.size() - 1;
+    std::vector<float> sortKey(clusterCount);
+    for (std::size_t c = 0; c < clusterCount; c++)
+    {
+        float clusterCentroid[3] = {0.0f, 0.0f, 0.0f};
+        float clusterNormal[3] = {0.0f, 0.0f, 0.0f};
+        float clusterArea = 0.0f;
+        for (std::size_t t = boundaries[c]; t < boundaries[c + 1]; t++)
+        {
+            float centroid[3];
+            float normal[3];
+            float area = triangleArea(t, centroid, normal);
+            for (int axis = 0; axis < 3; axis++)
+            {
+                clusterCentroid[axis] += centroid[axis] * area;
+                clusterNormal[axis] += normal[axis];
+            }
+            clusterArea += area;
+        }
+        float normalLength = std::sqrt(clusterNormal[0] * clusterNormal[0] + clusterNormal[1] * clusterNormal[1] +
+                                       clusterNormal[2] * clusterNormal[2]);
+        float key = 0.0f;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            float centroid = clusterArea > 0.0f ? clusterCentroid[axis] / clusterArea : 0.0f;
+            float normal = normalLength > 0.0f ? clusterNormal[axis] / normalLength : 0.0f;
+            key += (centroid - meshCentroid[axis]) * normal;
+        }
+        sortKey[c] = key;
+    }
+    std::vector<std::size_t> order(clusterCount);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&sortKey](std::size_t a, std::size_t b) { return sortKey[a] > sortKey[b]; });
+
+    std::vector<std::uint32_t> sorted;
+    sorted.reserve(triangleCount * 3);
+    for (std::size_t c : order)
+    {
+        sorted.insert(sorted.end(), indices + boundaries[c] * 3, indices + boundaries[c + 1] * 3);
+    }
+    std::copy(sorted.begin(), sorted.end(), indices);
+}
+
+void optimizeVertexFetch(std::vector<float> &vertices, std::vector<std::uint32_t> &indices)
+{
+    std::size_t vertexCount = vertices.size() / 6;
+    std::vector<std::uint32_t> remap(vertexCount, UINT32_MAX);
+    std::vector<float> reordered;
+    reordered.reserve(vertices.size());
+    for (std::uint32_t &index : indices)
+    {
+        if (remap[index] == UINT32_MAX)
+        {
+            remap[index] = static_cast<std::uint32_t>(reordered.size() / 6);
+            reordered.insert(reordered.end(), vertices.begin() + index * 6, vertices.begin() + index * 6 + 6);
+        }
+        index = remap[index];
+    }
+    vertices.swap(reordered);
+}
+
+MeshOptimizationReport optimizeMesh(std::vector<float> &vertices, std::vector<std::uint32_t> &indices, float weldEpsilon)
+{
+    MeshOptimizationReport report;
+    // the cache statistics are taken after welding so they only measure the ordering passes
+    report.weld = weldVertices(vertices, indices, weldEpsilon);
+    std::size_t vertexCount = vertices.size() / 6;
+    report.before = analyzeVertexCache(indices.data(), indices.size(), vertexCount);
+    optimizeVertexCache(indices.data(), indices.size(), vertexCount);
+
+    // sorting clusters loses the reuse between them, on small meshes that can cost more than the threshold allows
+    std::vector<std::uint32_t> cacheOrder = indices;
+    float cacheAcmr = analyzeVertexCache(indices.data(), indices.size(), vertexCount).acmr;
+    optimizeOverdraw(indices.data(), indices.size(), vertices.data(), vertexCount);
+    if (analyzeVertexCache(indices.data(), indices.size(), vertexCount).acmr > cacheAcmr * OVERDRAW_THRESHOLD)
+    {
+        indices.swap(cacheOrder);
+    }
+    optimizeVertexFetch(vertices, indices);
+    report.after = analyzeVertexCache(indices.data(), indices.size(), vertices.size() / 6);
+    return report;
+}
@@ -0,0 +1,187 @@
+#include "../include/MeshParser.h"
+#include "../include/AssetPack.h"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+static bool isSpace(char c)
+{
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\v' || c == '\f';
+}
+
+// Returns the first non whitespace character at or after p, or end.
+static const char *skipWhitespace(const char *p, const char *end)
+{
+#if defined(__SSE2__)
+    const __m128i space = _mm_set1_epi8(' ');
+    // '\t' '\n' '\v' '\f' '\r' are the contiguous range 9..13
+    const __m128i controlLow = _mm_set1_epi8(8);
+    const __m128i controlHigh = _mm_set1_epi8(14);
+    while (end - p >= 16)
+    {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        __m128i isBlank = _mm_cmpeq_epi8(chunk, space);
+        __m128i isControl = _mm_and_si128(_mm_cmpgt_epi8(chunk, controlLow), _mm_cmplt_epi8(chunk, controlHigh));
+        unsigned mask = ~static_cast<unsigned>(_mm_movemask_epi8(_mm_or_si128(isBlank, isControl))) & 0xFFFFu;
+        if (mask != 0)
+        {
+            return p + __builtin_ctz(mask);
+        }
+        p += 16;
+    }
+#endif
+    while (p < end && isSpace(*p))
+    {
+        p++;
+    }
+    return p;
+}
+
+static std::runtime_error badToken(const char *begin, const char *p, const char *end)
+{
+    const char *tokenEnd = p;
+    while (tokenEnd < end && !isSpace(*tokenEnd) && tokenEnd - p < 32)
+    {
+        tokenEnd++;
+    }
+    return std::runtime_error("Bad token \"" + std::string(p, tokenEnd) + "\" at byte " + std::to_string(p - begin));
+}
+
+/*
+ * Parses every number in [p, end). Numbers don't need whitespace between them, "-0.5-0.5" is read as two
+ * values the same way operator>> reads it.
+ */
+template <typename T>
+static void parseRange(const char *begin, const char *p, const char *end, std::vector<T> &values)
+{
+    p = skipWhitespace(p, end);
+    while (p < end)
+    {
+        // from_chars doesn't accept a leading '+' but operator>> does
+        const char *start = (*p == '+') ? p + 1 : p;
+        T value;
+        std::from_chars_result result = std::from_chars(start, end, value);
+        if (result.ec != std::errc())
+        {
+            throw badToken(begin, p, end);
+        }
+        values.push_back(value);
+        p = skipWhitespace(result.ptr, end);
+    }
+}
+
+template <typename T>
+static std::vector<T> parseValues(std::string_view text, ThreadPool *pool)
+{
+    const char *begin = text.data();
+    const char *end = begin + text.size();
+    // every value takes at least one character and one separator, most of the shipped files average about 4
+    std::size_t estimate = text.size() / 4 + 16;
+
+    if (pool == nullptr || text.size() < PARALLEL_PARSE_THRESHOLD)
+    {
+        std::vector<T> values;
+        values.reserve(estimate);
+        parseRange(begin, begin, end, values);
+        return values;
+    }
+
+    // split into a few chunks per thread, moving each split forward to the next line break
+    std::size_t chunkCount = pool->getThreadCount() * 4;
+    std::vector<const char *> splits;
+    splits.push_back(begin);
+    for (std::size_t i = 1; i < chunkCount; i++)
+    {
+        const char *split = std::max(begin + text.size() * i / chunkCount, splits.back());
+        split = static_cast<const char *>(std::memchr(split, '\n', end - split));
+        if (split == nullptr)
+        {
+            break;
+        }
+        splits.push_back(split + 1);
+    }
+    splits.push_back(end);
+
+    std::vector<std::vector<T>> chunks(splits.size() - 1);
+    pool->ParallelFor(chunks.size(), [&](std::size_t i)
+    {
+        chunks[i].reserve((splits[i + 1] - splits[i]) / 4 + 16);
+        parseRange(begin, splits[i], splits[i + 1], chunks[i]);
+    });
+
+    std::vector<std::size_t> offsets(chunks.size() + 1, 0);
+    for (std::size_t i = 0; i < chunks.size(); i++)
+    {
+        offsets[i + 1] = offsets[i] + chunks[i].size();
+    }
+    std::vector<T> values(offsets.back());
+    pool->ParallelFor(chunks.size(), [&](std::size_t i)
+    {
+        std::copy(chunks[i].begin(), chunks[i].end(), values.begin() + offsets[i]);
+    });
+    return values;
+}
+
+std::string readTextFile(const char *path)
+{
+    if (std::optional<std::string_view> packed = AssetPackMount::getShared().find(path))
+    {
+        return std::string(*packed);
+    }
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open())
+    {
+        throw std::runtime_error("Could not open file " + std::string(path));
+    }
+    std::string contents;
+    contents.resize(file.tellg());
+    file.seekg(0, std::ios::beg);
+    file.read(&contents[0], contents.size());
+    if (!file)
+    {
+        throw std::runtime_error("Could not read file " + std::string(path));
+    }
+    return contents;
+}
+
+std::vector<float> parseFloats(std::string_view text, ThreadPool *pool)
+{
+    return parseValues<float>(text, pool);
+}
+
+std::vector<std::uint32_t> parseIndices(std::string_view text, ThreadPool *pool)
+{
+    return parseValues<std::uint32_t>(text, pool);
+}
+
+std::vector<float> readVertexFile(const char *path)
+{
+    std::string contents = readTextFile(path);
+    try
+    {
+        return parseFloats(contents);
+    }
+    catch (const std::runtime_error &error)
+    {
+        throw std::runtime_error(std::string(path) + ": " + error.what());
+    }
+}
+
+std::vector<std::uint32_t> readIndexFile(const char *path)
+{
+    std::string contents = readTextFile(path);
+    try
+    {
+        return parseIndices(contents);
+    }
+    catch (const std::runtime_error &error)
+    {
+        throw std::runtime_error(std::string(path) + ": " + error.what());
+    }
+}
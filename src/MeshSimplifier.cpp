@@ -0,0 +1,374 @@
+#include "../include/MeshSimplifier.h"
+#include "../include/MeshOptimizer.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <unordered_map>
+#include <unordered_set>
+
+// Open border edges are held in place by a plane through the edge, weighted this much more than a face.
+constexpr double BORDER_WEIGHT = 10.0;
+
+// A symmetric 4x4 matrix that sums the squared distances to a set of planes, plus the total weight of the planes.
+struct Quadric
+{
+    double a2 = 0, ab = 0, ac = 0, ad = 0, b2 = 0, bc = 0, bd = 0, c2 = 0, cd = 0, d2 = 0;
+    double weight = 0;
+
+    void addPlane(double a, double b, double c, double d, double w)
+    {
+        a2 += w * a * a; ab += w * a * b; ac += w * a * c; ad += w * a * d;
+        b2 += w * b * b; bc += w * b * c; bd += w * b * d;
+        c2 += w * c * c; cd += w * c * d;
+        d2 += w * d * d;
+        weight += w;
+    }
+
+    void add(const Quadric &other)
+    {
+        a2 += other.a2; ab += other.ab; ac += other.ac; ad += other.ad;
+        b2 += other.b2; bc += other.bc; bd += other.bd;
+        c2 += other.c2; cd += other.cd;
+        d2 += other.d2;
+        weight += other.weight;
+    }
+
+    // the weighted mean squared distance from p to the planes
+    double evaluate(const float *p) const
+    {
+        double x = p[0], y = p[1], z = p[2];
+        double error = a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x
+                     + b2 * y * y + 2 * bc * y * z + 2 * bd * y
+                     + c2 * z * z + 2 * cd * z
+                     + d2;
+        return weight > 0 ? std::max(error, 0.0) / weight : 0.0;
+    }
+};
+
+enum class VertexKind : std::uint8_t
+{
+    Interior,
+    Border,
+    Locked
+};
+
+struct Collapse
+{
+    std::uint32_t from;
+    std::uint32_t to;
+    double cost;
+};
+
+static std::uint64_t edgeKey(std::uint32_t from, std::uint32_t to)
+{
+    return (static_cast<std::uint64_t>(from) << 32) | to;
+}
+
+static void triangleNormal(const float *a, const float *b, const float *c, double normal[3])
+{
+    double edge1[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+    double edge2[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+    normal[0] = edge1[1] * edge2[2] - edge1[2] * edge2[1];
+    normal[1] = edge1[2] * edge2[0] - edge1[0] * edge2[2];
+    normal[2] = edge1[0] * edge2[1] - edge1[1] * edge2[0];
+}
+
+std::vector<std::uint32_t> simplifyMesh(const float *vertices, std::size_t vertexCount, const std::uint32_t *indices,
+                                        std::size_t indexCount, std::size_t targetIndexCount, float &error)
+{
+    std::vector<std::uint32_t> result(indices, indices + indexCount / 3 * 3);
+    error = 0.0f;
+    auto position = [vertices](std::uint32_t vertex) { return &vertices[vertex * 6]; };
+
+    // vertices that share a position with a different color sit on a seam and stay where they are
+    std::vector<VertexKind> kind(vertexCount, VertexKind::Interior);
+    {
+        std::unordered_map<std::uint64_t, std::uint32_t> firstAtPosition;
+        firstAtPosition.reserve(vertexCount);
+        std::vector<bool> used(vertexCount, false);
+        for (std::uint32_t index : result)
+        {
+            used[index] = true;
+        }
+        for (std::uint32_t v = 0; v < vertexCount; v++)
+        {
+            if (!used[v])
+            {
+                continue;
+            }
+            const float *p = position(v);
+            std::uint64_t key = std::bit_cast<std::uint32_t>(p[0]);
+            key = key * 0x9E3779B97F4A7C15ull ^ std::bit_cast<std::uint32_t>(p[1]);
+            key = key * 0x9E3779B97F4A7C15ull ^ std::bit_cast<std::uint32_t>(p[2]);
+            auto [found, inserted] = firstAtPosition.try_emplace(key, v);
+            if (!inserted)
+            {
+                kind[v] = VertexKind::Locked;
+                kind[found->second] = VertexKind::Locked;
+            }
+        }
+    }
+
+    // a directed edge without its reverse is on an open border
+    std::unordered_set<std::uint64_t> edges;
+    edges.reserve(result.size());
+    for (std::size_t i = 0; i < result.size(); i += 3)
+    {
+        for (int corner = 0; corner < 3; corner++)
+        {
+            edges.insert(edgeKey(result[i + corner], result[i + (corner + 1) % 3]));
+        }
+    }
+    auto isBorderEdge = [&edges](std::uint32_t a, std::uint32_t b)
+    {
+        return edges.count(edgeKey(a, b)) != edges.count(edgeKey(b, a));
+    };
+
+    std::vector<Quadric> quadrics(vertexCount);
+    for (std::size_t i = 0; i < result.size(); i += 3)
+    {
+        const std::uint32_t *triangle = &result[i];
+        double normal[3];
+        triangleNormal(position(triangle[0]), position(triangle[1]), position(triangle[2]), normal);
+        double length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        if (length == 0.0)
+        {
+            continue;
+        }
+        // area weighted so big faces hold their shape more than small ones
+        double area = length * 0.5;
+        for (double &component : normal)
+        {
+            component /= length;
+        }
+        const float *p0 = position(triangle[0]);
+        double d = -(normal[0] * p0[0] + normal[1] * p0[1] + normal[2] * p0[2]);
+        for (int corner = 0; corner < 3; corner++)
+        {
+            quadrics[triangle[corner]].addPlane(normal[0], normal[1], normal[2], d, area);
+        }
+        for (int corner = 0; corner < 3; corner++)
+        {
+            std::uint32_t a = triangle[corner];
+            std::uint32_t b = triangle[(corner + 1) % 3];
+            if (!isBorderEdge(a, b))
+            {
+                continue;
+            }
+            const float *pa = position(a);
+            const float *pb = position(b);
+            double edge[3] = {pb[0] - pa[0], pb[1] - pa[1], pb[2] - pa[2]};
+            double edgeLengthSquared = edge[0] * edge[0] + edge[1] * edge[1] + edge[2] * edge[2];
+            double borderNormal[3] = {edge[1] * normal[2] - edge[2] * normal[1], edge[2] * normal[0] - edge[0] * normal[2],
+                                      edge[0] * normal[1] - edge[1] * normal[0]};
+            double borderLength = std::sqrt(borderNormal[0] * borderNormal[0] + borderNormal[1] * borderNormal[1] +
+                                            borderNormal[2] * borderNormal[2]);
+            if (borderLength == 0.0)
+            {
+                continue;
+            }
+            for (double &component : borderNormal)
+            {
+                component /= borderLength;
+            }
+            double borderD = -(borderNormal[0] * pa[0] + borderNormal[1] * pa[1] + borderNormal[2] * pa[2]);
+            quadrics[a].addPlane(borderNormal[0], borderNormal[1], borderNormal[2], borderD, edgeLengthSquared * BORDER_WEIGHT);
+            quadrics[b].addPlane(borderNormal[0], borderNormal[1], borderNormal[2], borderD, edgeLengthSquared * BORDER_WEIGHT);
+            if (kind[a] == VertexKind::Interior)
+            {
+                kind[a] = VertexKind::Border;
+            }
+            if (kind[b] == VertexKind::Interior)
+            {
+                kind[b] = VertexKind::Border;
+            }
+        }
+    }
+    auto canCollapse = [&](std::uint32_t from, std::uint32_t to)
+    {
+        // a border vertex that moved off its border would open a hole
+        return kind[from] == VertexKind::Interior || (kind[from] == VertexKind::Border && isBorderEdge(from, to));
+    };
+
+    std::vector<std::uint32_t> adjacencyOffset(vertexCount + 1);
+    std::vector<std::uint32_t> adjacency;
+    std::vector<Collapse> collapses;
+    std::vector<bool> touched(vertexCount);
+    double maxCost = 0.0;
+    std::size_t targetTriangles = targetIndexCount / 3;
+
+    // collapse the cheapest edges a pass at a time, each vertex takes part in at most one collapse per pass
+    while (result.size() / 3 > targetTriangles)
+    {
+        std::size_t triangleCount = result.size() / 3;
+        std::fill(adjacencyOffset.begin(), adjacencyOffset.end(), 0);
+        for (std::uint32_t index : result)
+        {
+            adjacencyOffset[index + 1]++;
+        }
+        for (std::size_t v = 0; v < vertexCount; v++)
+        {
+            adjacencyOffset[v + 1] += adjacencyOffset[v];
+        }
+        adjacency.resize(result.size());
+        std::vector<std::uint32_t> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+        for (std::size_t i = 0; i < result.size(); i++)
+        {
+            adjacency[fill[result[i]]++] = static_cast<std::uint32_t>(i / 3);
+        }
+
+        collapses.clear();
+        for (std::size_t i = 0; i < result.size(); i += 3)
+        {
+            for (int corner = 0; corner < 3; corner++)
+            {
+                std::uint32_t a = result[i + corner];
+                std::uint32_t b = result[i + (corner + 1) % 3];
+                // each edge is seen from both of its triangles, so only one direction is added per triangle
+                if (canCollapse(a, b))
+                {
+                    Quadric combined = quadrics[a];
+                    combined.add(quadrics[b]);
+                    collapses.push_back({a, b, combined.evaluate(position(b))});
+                }
+                if (isBorderEdge(a, b) && canCollapse(b, a))
+                {
+                    Quadric combined = quadrics[a];
+                    combined.add(quadrics[b]);
+                    collapses.push_back({b, a, combined.evaluate(position(a))});
+                }
+            }
+        }
+        if (collapses.empty())
+        {
+            break;
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse &a, const Collapse &b) { return a.cost < b.cost; });
+
+        std::fill(touched.begin(), touched.end(), false);
+        std::size_t removedTriangles = 0;
+        std::size_t wantedTriangles = triangleCount - targetTriangles;
+        std::size_t applied = 0;
+        for (const Collapse &collapse : collapses)
+        {
+            if (removedTriangles >= wantedTriangles)
+            {
+                break;
+            }
+            if (touched[collapse.from] || touched[collapse.to])
+            {
+                continue;
+            }
+            // a triangle that survives the collapse must not turn over
+            bool flips = false;
+            std::size_t removes = 0;
+            for (std::uint32_t a = adjacencyOffset[collapse.from]; a < adjacencyOffset[collapse.from + 1] && !flips; a++)
+            {
+                const std::uint32_t *triangle = &result[adjacency[a] * 3];
+                if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to)
+                {
+                    removes++;
+                    continue;
+                }
+                const float *corners[3];
+                const float *moved[3];
+                for (int corner = 0; corner < 3; corner++)
+                {
+                    corners[corner] = position(triangle[corner]);
+                    moved[corner] = triangle[corner] == collapse.from ? position(collapse.to) : corners[corner];
+                }
+                double before[3];
+                double after[3];
+                triangleNormal(corners[0], corners[1], corners[2], before);
+                triangleNormal(moved[0], moved[1], moved[2], after);
+                flips = before[0] * after[0] + before[1] * after[1] + before[2] * after[2] <= 0.0;
+            }
+            if (flips || removes == 0)
+            {
+                continue;
+            }
+            for (std::uint32_t a = adjacencyOffset[collapse.from]; a < adjacencyOffset[collapse.from + 1]; a++)
+            {
+                std::uint32_t *triangle = &result[adjacency[a] * 3];
+                for (int corner = 0; corner < 3; corner++)
+                {
+                    touched[triangle[corner]] = true;
+                    if (triangle[corner] == collapse.from)
+                    {
+                        triangle[corner] = collapse.to;
+                    }
+                }
+            }
+            quadrics[collapse.to].add(quadrics[collapse.from]);
+            maxCost = std::max(maxCost, collapse.cost);
+            removedTriangles += removes;
+            applied++;
+        }
+        if (applied == 0)
+        {
+            break;
+        }
+
+        // drop the triangles that collapsed to a line
+        std::size_t kept = 0;
+        for (std::size_t i = 0; i < result.size(); i += 3)
+        {
+            if (result[i] != result[i + 1] && result[i + 1] != result[i + 2] && result[i] != result[i + 2])
+            {
+                std::copy(result.begin() + i, result.begin() + i + 3, result.begin() + kept);
+                kept += 3;
+            }
+        }
+        result.resize(kept);
+    }
+    error = static_cast<float>(std::sqrt(maxCost));
+    return result;
+}
+
+std::vector<LodLevel> buildLodChain(const std::vector<float> &vertices, std::vector<std::uint32_t> &indices)
+{
+    std::vector<LodLevel> levels;
+    levels.push_back({0, static_cast<std::uint32_t>(indices.size()), 0.0f});
+    std::size_t vertexCount = vertices.size() / 6;
+    while (levels.size() < LOD_MAX_LEVELS && levels.back().indexCount / 3 >= LOD_MIN_TRIANGLES)
+    {
+        const LodLevel &previous = levels.back();
+        std::size_t target = static_cast<std::size_t>(previous.indexCount * LOD_TRIANGLE_RATIO) / 3 * 3;
+        // simplify the previous level rather than the original, it is smaller and the errors only ever add up
+        float error = 0.0f;
+        std::vector<std::uint32_t> simplified = simplifyMesh(vertices.data(), vertexCount, indices.data() + previous.indexOffset,
+                                                             previous.indexCount, target, error);
+        // a level that barely shrank isn't worth the memory, and the next one wouldn't shrink either
+        if (simplified.empty() || simplified.size() > previous.indexCount * 0.9f)
+        {
+            break;
+        }
+        optimizeVertexCache(simplified.data(), simplified.size(), vertexCount);
+        LodLevel level;
+        level.indexOffset = static_cast<std::uint32_t>(indices.size());
+        level.indexCount = static_cast<std::uint32_t>(simplified.size());
+        level.error = previous.error + error;
+        indices.insert(indices.end(), simplified.begin(), simplified.end());
+        levels.push_back(level);
+    }
+    return levels;
+}
+
+std::size_t selectLodLevel(const std::vector<LodLevel> &levels, float distance, float pixelsPerUnit, float maxPixelError)
+{
+    // inside the bounds everything is close enough to need the full mesh
+    if (distance <= 0.0f)
+    {
+        return 0;
+    }
+    std::size_t selected = 0;
+    for (std::size_t level = 1; level < levels.size(); level++)
+    {
+        if (levels[level].error / distance * pixelsPerUnit > maxPixelError)
+        {
+            break;
+        }
+        selected = level;
+    }
+    return selected;
+}
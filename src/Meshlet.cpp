@@ -0,0 +1,190 @@
+#include "../include/Meshlet.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+static float dot3(const float *a, const float *b)
+{
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+// Fills in the sphere and cone of a meshlet from its triangles.
+static void computeBounds(Meshlet &meshlet, const float *vertices, const std::uint32_t *indices)
+{
+    float boundsMin[3] = {INFINITY, INFINITY, INFINITY};
+    float boundsMax[3] = {-INFINITY, -INFINITY, -INFINITY};
+    for (std::uint32_t i = 0; i < meshlet.indexCount; i++)
+    {
+        const float *position = &vertices[indices[meshlet.indexOffset + i] * 6];
+        for (int axis = 0; axis < 3; axis++)
+        {
+            boundsMin[axis] = std::min(boundsMin[axis], position[axis]);
+            boundsMax[axis] = std::max(boundsMax[axis], position[axis]);
+        }
+    }
+    for (int axis = 0; axis < 3; axis++)
+    {
+        meshlet.center[axis] = (boundsMin[axis] + boundsMax[axis]) * 0.5f;
+    }
+    float radiusSquared = 0.0f;
+    for (std::uint32_t i = 0; i < meshlet.indexCount; i++)
+    {
+        const float *position = &vertices[indices[meshlet.indexOffset + i] * 6];
+        float offset[3] = {position[0] - meshlet.center[0], position[1] - meshlet.center[1], position[2] - meshlet.center[2]};
+        radiusSquared = std::max(radiusSquared, dot3(offset, offset));
+    }
+    meshlet.radius = std::sqrt(radiusSquared);
+
+    // counter clockwise triangles face the way of (b - a) x (c - a), the same as OpenGL's default front face
+    std::vector<float> normals;
+    normals.reserve(meshlet.indexCount);
+    float axis[3] = {0.0f, 0.0f, 0.0f};
+    for (std::uint32_t i = 0; i < meshlet.indexCount; i += 3)
+    {
+        const float *a = &vertices[indices[meshlet.indexOffset + i] * 6];
+        const float *b = &vertices[indices[meshlet.indexOffset + i + 1] * 6];
+        const float *c = &vertices[indices[meshlet.indexOffset + i + 2] * 6];
+        float edge1[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+        float edge2[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+        float normal[3] = {edge1[1] * edge2[2] - edge1[2] * edge2[1], edge1[2] * edge2[0] - edge1[0] * edge2[2],
+                           edge1[0] * edge2[1] - edge1[1] * edge2[0]};
+        float length = std::sqrt(dot3(normal, normal));
+        // degenerate triangles are never rasterized so they don't constrain the cone
+        if (length == 0.0f)
+        {
+            continue;
+        }
+        for (int component = 0; component < 3; component++)
+        {
+            normal[component] /= length;
+            axis[component] += normal[component];
+            normals.push_back(normal[component]);
+        }
+    }
+    float axisLength = std::sqrt(dot3(axis, axis));
+    float minimumDot = 1.0f;
+    if (axisLength > 0.0f)
+    {
+        for (int component = 0; component < 3; component++)
+        {
+            axis[component] /= axisLength;
+        }
+        for (std::size_t n = 0; n < normals.size(); n += 3)
+        {
+            minimumDot = std::min(minimumDot, dot3(axis, &normals[n]));
+        }
+    }
+    for (int component = 0; component < 3; component++)
+    {
+        meshlet.coneAxis[component] = axis[component];
+    }
+    // a cone of 90 degrees or more can't be entirely behind the camera from anywhere
+    meshlet.coneCutoff = axisLength == 0.0f || minimumDot <= 0.0f ? 1.0f : std::sqrt(1.0f - minimumDot * minimumDot);
+}
+
+std::vector<Meshlet> buildMeshlets(const float *vertices, std::size_t vertexCount, const std::uint32_t *indices,
+                                   std::size_t indexCount)
+{
+    std::vector<Meshlet> meshlets;
+    // the meshlet each vertex was last counted in, so a vertex is counted once per meshlet
+    std::vector<std::uint32_t> lastMeshlet(vertexCount, UINT32_MAX);
+    std::size_t meshletVertices = 0;
+    std::size_t triangleCount = indexCount / 3;
+    for (std::size_t t = 0; t < triangleCount; t++)
+    {
+        const std::uint32_t *triangle = &indices[t * 3];
+        for (int corner = 0; corner < 3; corner++)
+        {
+            if (triangle[corner] >= vertexCount)
+            {
+                throw std::runtime_error("Index " + std::to_string(triangle[corner]) + " is out of range");
+            }
+        }
+        std::uint32_t current = static_cast<std::uint32_t>(meshlets.size() - 1);
+        std::size_t newVertices = 0;
+        if (!meshlets.empty())
+        {
+            for (int corner = 0; corner < 3; corner++)
+            {
+                // a triangle can use the same vertex twice, it still only needs one slot
+                bool repeated = corner > 0 && triangle[corner] == triangle[corner - 1];
+                repeated = repeated || (corner == 2 && triangle[2] == triangle[0]);
+                newVertices += lastMeshlet[triangle[corner]] != current && !repeated ? 1 : 0;
+            }
+        }
+        if (meshlets.empty() || meshletVertices + newVertices > MESHLET_MAX_VERTICES ||
+            meshlets.back().indexCount / 3 >= MESHLET_MAX_TRIANGLES)
+        {
+            Meshlet &meshlet = meshlets.emplace_back();
+            meshlet.indexOffset = static_cast<std::uint32_t>(t * 3);
+            meshlet.indexCount = 0;
+            meshletVertices = 0;
+            current = static_cast<std::uint32_t>(meshlets.size() - 1);
+        }
+        for (int corner = 0; corner < 3; corner++)
+        {
+            if (lastMeshlet[triangle[corner]] != current)
+            {
+                lastMeshlet[triangle[corner]] = current;
+                meshletVertices++;
+            }
+        }
+        meshlets.back().indexCount += 3;
+    }
+    for (Meshlet &meshlet : meshlets)
+    {
+        computeBounds(meshlet, vertices, indices);
+    }
+    return meshlets;
+}
+
+MeshletFrustum makeMeshletFrustum(const float *modelViewProjection, const float *cameraPosition)
+{
+    // Gribb and Hartmann, each plane is the last row of the matrix plus or minus one of the others
+    auto row = [modelViewProjection](int r, int c) { return modelViewProjection[c * 4 + r]; };
+    MeshletFrustum frustum;
+    for (int plane = 0; plane < 6; plane++)
+    {
+        int axis = plane / 2;
+        float sign = plane % 2 == 0 ? 1.0f : -1.0f;
+        float length = 0.0f;
+        for (int c = 0; c < 4; c++)
+        {
+            frustum.planes[plane][c] = row(3, c) + sign * row(axis, c);
+        }
+        length = std::sqrt(dot3(frustum.planes[plane], frustum.planes[plane]));
+        for (int c = 0; c < 4 && length > 0.0f; c++)
+        {
+            frustum.planes[plane][c] /= length;
+        }
+    }
+    for (int axis = 0; axis < 3; axis++)
+    {
+        frustum.cameraPosition[axis] = cameraPosition[axis];
+    }
+    return frustum;
+}
+
+bool isMeshletVisible(const Meshlet &meshlet, const MeshletFrustum &frustum, bool coneCulling)
+{
+    for (const float *plane : frustum.planes)
+    {
+        if (dot3(plane, meshlet.center) + plane[3] < -meshlet.radius)
+        {
+            return false;
+        }
+    }
+    if (coneCulling && meshlet.coneCutoff < 1.0f)
+    {
+        // every triangle faces away when the view direction is inside the cone, widened by the sphere's size
+        float view[3] = {meshlet.center[0] - frustum.cameraPosition[0], meshlet.center[1] - frustum.cameraPosition[1],
+                         meshlet.center[2] - frustum.cameraPosition[2]};
+        float distance = std::sqrt(dot3(view, view));
+        if (dot3(view, meshlet.coneAxis) >= meshlet.coneCutoff * distance + meshlet.radius)
+        {
+            return false;
+        }
+    }
+    return true;
+}
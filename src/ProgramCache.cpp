@@ -0,0 +1,178 @@
+#include "../include/ProgramCache.h"
+#include "../include/MeshCache.h"
+#include "../include/MeshFile.h"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+// "SHPB" when read as little endian bytes
+constexpr std::uint32_t PROGRAM_CACHE_MAGIC = 0x42504853;
+constexpr std::uint32_t PROGRAM_CACHE_VERSION = 1;
+
+struct ProgramCacheHeader
+{
+    std::uint32_t magic;
+    std::uint32_t version;
+    // the key again, in case two keys ever share a file name
+    std::uint64_t key;
+    std::uint32_t format;
+    std::uint32_t length;
+};
+
+// Private Methods
+void ProgramCache::initialize()
+{
+    initialized = true;
+    // glad only loads these when the context is 4.1 or newer
+    if (glGetProgramBinary == nullptr || glProgramBinary == nullptr || glProgramParameteri == nullptr)
+    {
+        return;
+    }
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    supported = formats > 0;
+    for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION})
+    {
+        const GLubyte *value = glGetString(name);
+        driver += value != nullptr ? reinterpret_cast<const char *>(value) : "";
+        driver += '\n';
+    }
+}
+
+std::string ProgramCache::getPath(std::uint64_t key) const
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(key));
+    return directory + "/" + name;
+}
+
+// Public Methods
+ProgramCache::ProgramCache(std::string directory)
+    : directory(directory.empty() ? getCacheDirectory("programs") : std::move(directory))
+{
+}
+
+ProgramCache &ProgramCache::getShared()
+{
+    static ProgramCache cache;
+    return cache;
+}
+
+bool ProgramCache::isSupported()
+{
+    if (!initialized)
+    {
+        initialize();
+    }
+    return supported;
+}
+
+std::uint64_t ProgramCache::makeKey(std::string_view vertexCode, std::string_view fragmentCode)
+{
+    isSupported();
+    std::uint64_t lengths[3] = {PROGRAM_CACHE_VERSION, vertexCode.size(), fragmentCode.size()};
+    std::uint64_t key = meshChecksum(lengths, sizeof(lengths));
+    key = meshChecksum(driver.data(), driver.size(), key);
+    key = meshChecksum(vertexCode.data(), vertexCode.size(), key);
+    return meshChecksum(fragmentCode.data(), fragmentCode.size(), key);
+}
+
+GLuint ProgramCache::Load(std::uint64_t key)
+{
+    if (!isSupported())
+    {
+        return 0;
+    }
+    std::string path = getPath(key);
+    std::ifstream file(path, std::ios::binary);
+    ProgramCacheHeader header{};
+    if (!file.is_open() || !file.read(reinterpret_cast<char *>(&header), sizeof(header)))
+    {
+        stats.misses++;
+        return 0;
+    }
+    std::vector<char> binary;
+    // the length is checked against the file before anything is allocated for it
+    std::error_code sizeError;
+    std::uintmax_t fileSize = fs::file_size(path, sizeError);
+    if (header.magic == PROGRAM_CACHE_MAGIC && header.version == PROGRAM_CACHE_VERSION && header.key == key &&
+        !sizeError && header.length <= fileSize - sizeof(header))
+    {
+        binary.resize(header.length);
+        file.read(binary.data(), binary.size());
+    }
+
+    GLuint program = 0;
+    if (file && !binary.empty())
+    {
+        program = glCreateProgram();
+        glProgramBinary(program, header.format, binary.data(), binary.size());
+        GLint success = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        if (!success)
+        {
+            glDeleteProgram(program);
+            program = 0;
+        }
+    }
+    if (program == 0)
+    {
+        std::error_code error;
+        fs::remove(path, error);
+        stats.rejected++;
+        stats.misses++;
+        return 0;
+    }
+    stats.hits++;
+    return program;
+}
+
+void ProgramCache::Store(std::uint64_t key, GLuint program)
+{
+    if (!isSupported())
+    {
+        return;
+    }
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+    {
+        return;
+    }
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    glGetProgramBinary(program, length, &length, &format, binary.data());
+    ProgramCacheHeader header = {PROGRAM_CACHE_MAGIC, PROGRAM_CACHE_VERSION, key, format, static_cast<std::uint32_t>(length)};
+
+    std::error_code error;
+    fs::create_directories(directory, error);
+    std::string path = getPath(key);
+    std::string temporaryPath = path + ".tmp";
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        file.write(binary.data(), length);
+        if (!file)
+        {
+            std::cout << "ERROR::PROGRAM_CACHE::STORE_FAILED\n" << temporaryPath << std::endl;
+            file.close();
+            fs::remove(temporaryPath, error);
+            return;
+        }
+    }
+    fs::rename(temporaryPath, path, error);
+    if (!error)
+    {
+        stats.stores++;
+    }
+}
+
+const ProgramCacheStats &ProgramCache::getStats() const
+{
+    return stats;
+}
@@ -1,7 +1,20 @@
 #include"../include/ShaderClass.h"
+#include"../include/AssetPack.h"
+#include"../include/ProgramCache.h"
+#include"../include/GLStateCache.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+UniformUploadStats Shader::uniformStats;
+std::vector<std::pair<std::string, GLuint>> Shader::blockBindings;
 
 std::string get_file_contents(const char *filename)
 {
+    if (std::optional<std::string_view> packed = AssetPackMount::getShared().find(filename))
+    {
+        return std::string(*packed);
+    }
     std::ifstream in(filename, std::ios::binary);
     if (in)
     {
@@ -16,66 +29,407 @@ std::string get_file_contents(const char *filename)
     throw std::runtime_error("File could not be opened");
 }
 
-Shader::Shader(const char *vertexPath, const char *fragmentPath)
+GLuint Shader::compileShader(GLenum type, const char *source, const char *stageName)
 {
-    std::string vertexCode = get_file_contents(vertexPath);
-    std::string fragmentCode = get_file_contents(fragmentPath);
-
-    const char* vertexSource = vertexCode.c_str();
-    const char* fragmentSource = fragmentCode.c_str();
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, NULL);
+    glCompileShader(shader);
 
-    // vertex shader
-    GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, &vertexSource, NULL);
-    glCompileShader(vertexShader);
-
-    // TODO: the error checking can abstracted out
     int success;
     char infoLog[512];
-    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
     if (!success)
     {
-        glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
+        glGetShaderInfoLog(shader, 512, NULL, infoLog);
+        std::cout << "ERROR::SHADER::" << stageName << "::COMPILATION_FAILED\n" << infoLog << std::endl;
+        glDeleteShader(shader);
+        return 0;
     }
+    return shader;
+}
 
-    // fragment shader
-    GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, &fragmentSource, NULL);
-    glCompileShader(fragmentShader);
-    // check for shader compile errors
-    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
-    if (!success)
+GLuint Shader::buildProgram(const std::string &vertexCode, const std::string &fragmentCode)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    ProgramCache &cache = ProgramCache::getShared();
+    std::uint64_t key = cache.makeKey(vertexCode, fragmentCode);
+    GLuint cached = cache.Load(key);
+    if (cached != 0)
     {
-        glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
+        buildMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        fromProgramCache = true;
+        return cached;
+    }
+
+    GLuint vertexShader = compileShader(GL_VERTEX_SHADER, vertexCode.c_str(), "VERTEX");
+    GLuint fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentCode.c_str(), "FRAGMENT");
+    if (vertexShader == 0 || fragmentShader == 0)
+    {
+        glDeleteShader(vertexShader);
+        glDeleteShader(fragmentShader);
+        return 0;
     }
 
     // link shaders
-    ID = glCreateProgram();
-    glAttachShader(ID, vertexShader);
-    glAttachShader(ID, fragmentShader);
-    glLinkProgram(ID);
+    GLuint program = glCreateProgram();
+    if (cache.isSupported())
+    {
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+    glAttachShader(program, vertexShader);
+    glAttachShader(program, fragmentShader);
+    glLinkProgram(program);
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
 
     // check for linking errors
-    glGetProgramiv(ID, GL_LINK_STATUS, &success);
+    int success;
+    char infoLog[512];
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
     if (!success)
     {
-        glGetProgramInfoLog(ID, 512, NULL, infoLog);
+        glGetProgramInfoLog(program, 512, NULL, infoLog);
         std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+        glDeleteProgram(program);
+        return 0;
     }
+    cache.Store(key, program);
+    buildMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    fromProgramCache = false;
+    return program;
+}
 
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
+Shader::Shader(const char *vertexPath, const char *fragmentPath)
+    : vertexPath(vertexPath), fragmentPath(fragmentPath)
+{
+    ID = buildProgram(get_file_contents(vertexPath), get_file_contents(fragmentPath));
+    reflect();
+}
+
+Shader::Shader(ShaderCompiler &compiler, const char *vertexPath, const char *fragmentPath)
+    : Shader(compiler, "PROGRAM", get_file_contents(vertexPath), get_file_contents(fragmentPath))
+{
+    this->vertexPath = vertexPath;
+    this->fragmentPath = fragmentPath;
+}
+
+Shader::Shader(ShaderCompiler &compiler, const char *name, const std::string &vertexCode, const std::string &fragmentCode)
+    : compiler(&compiler), name(name), pending(true), ownsProgram(false)
+{
+    compileHandle = compiler.Submit(name, vertexCode, fragmentCode);
+    ID = compiler.getProgram(compileHandle);
+    reflect();
+}
+
+bool Shader::Update()
+{
+    if (!pending)
+    {
+        return false;
+    }
+    CompileState state = compiler->getState(compileHandle);
+    if (state == CompileState::Ready)
+    {
+        if (ownsProgram)
+        {
+            GLStateCache::getShared().ForgetProgram(ID);
+            glDeleteProgram(ID);
+        }
+        ID = compiler->Take(compileHandle);
+        ownsProgram = true;
+        reflect();
+        buildMilliseconds = compiler->getMilliseconds(compileHandle);
+        fromProgramCache = compiler->isFromProgramCache(compileHandle);
+        compiler->Release(compileHandle);
+        pending = false;
+        return true;
+    }
+    if (state == CompileState::Failed)
+    {
+        // the compiler already printed why, keep drawing with the old program or the fallback until a reload
+        // fixes it
+        compiler->Release(compileHandle);
+        pending = false;
+    }
+    return false;
+}
+
+bool Shader::isReady()
+{
+    return !pending && ownsProgram;
+}
+
+bool Shader::Reload()
+{
+    std::string vertexCode;
+    std::string fragmentCode;
+    try
+    {
+        vertexCode = get_file_contents(vertexPath.c_str());
+        fragmentCode = get_file_contents(fragmentPath.c_str());
+    }
+    catch (const std::exception &error)
+    {
+        std::cout << "ERROR::SHADER::RELOAD_FAILED\n" << error.what() << std::endl;
+        return false;
+    }
+    return Rebuild(vertexCode, fragmentCode);
+}
+
+bool Shader::Rebuild(const std::string &vertexCode, const std::string &fragmentCode)
+{
+    if (compiler != nullptr)
+    {
+        // a build that is still running for an older version of the sources is dropped
+        if (pending)
+        {
+            compiler->Release(compileHandle);
+        }
+        compileHandle = compiler->Submit(name.c_str(), vertexCode, fragmentCode);
+        pending = true;
+        return true;
+    }
+    GLuint program = buildProgram(vertexCode, fragmentCode);
+    if (program == 0)
+    {
+        // keep drawing with the program that worked
+        return false;
+    }
+    if (ownsProgram)
+    {
+        GLStateCache::getShared().ForgetProgram(ID);
+        glDeleteProgram(ID);
+    }
+    ID = program;
+    ownsProgram = true;
+    reflect();
+    return true;
+}
+
+const std::string &Shader::getVertexPath()
+{
+    return vertexPath;
+}
+
+const std::string &Shader::getFragmentPath()
+{
+    return fragmentPath;
+}
+
+double Shader::getBuildMilliseconds()
+{
+    return buildMilliseconds;
+}
+
+bool Shader::isFromProgramCache()
+{
+    return fromProgramCache;
+}
+
+void Shader::reflect()
+{
+    uniforms.clear();
+    blocks.clear();
+    if (ID != 0)
+    {
+        GLint count = 0;
+        GLint maxLength = 0;
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+        std::vector<GLchar> name(std::max(maxLength, 1));
+        for (GLint index = 0; index < count; index++)
+        {
+            GLsizei length = 0;
+            GLint size = 0;
+            GLenum type = 0;
+            glGetActiveUniform(ID, index, name.size(), &length, &size, &type, name.data());
+            std::string uniformName(name.data(), length);
+            if (uniformName.ends_with("[0]"))
+            {
+                uniformName.resize(uniformName.size() - 3);
+            }
+            // uniforms inside a block have no location, they are set through the block's buffer
+            GLint location = glGetUniformLocation(ID, uniformName.c_str());
+            if (location >= 0)
+            {
+                uniforms.push_back({uniformName, location, type, size});
+            }
+        }
+
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_BLOCKS, &count);
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxLength);
+        name.resize(std::max(maxLength, 1));
+        for (GLint index = 0; index < count; index++)
+        {
+            GLsizei length = 0;
+            GLint dataSize = 0;
+            GLint binding = 0;
+            glGetActiveUniformBlockName(ID, index, name.size(), &length, name.data());
+            glGetActiveUniformBlockiv(ID, index, GL_UNIFORM_BLOCK_DATA_SIZE, &dataSize);
+            glGetActiveUniformBlockiv(ID, index, GL_UNIFORM_BLOCK_BINDING, &binding);
+            std::string blockName(name.data(), length);
+            for (const std::pair<std::string, GLuint> &blockBinding : blockBindings)
+            {
+                if (blockBinding.first == blockName && static_cast<GLuint>(binding) != blockBinding.second)
+                {
+                    glUniformBlockBinding(ID, index, blockBinding.second);
+                    binding = blockBinding.second;
+                }
+            }
+            blocks.push_back({blockName, static_cast<GLuint>(index), dataSize, binding});
+        }
+    }
+    for (UniformSlot &slot : slots)
+    {
+        resolve(slot);
+    }
+}
+
+void Shader::resolve(UniformSlot &slot)
+{
+    // a new program starts with its own values, so nothing it was given before counts
+    slot.location = -1;
+    slot.hasValue = false;
+    for (const ShaderUniformInfo &uniform : uniforms)
+    {
+        if (uniform.name != slot.name)
+        {
+            continue;
+        }
+        if (uniform.type == slot.type)
+        {
+            slot.location = uniform.location;
+        }
+        else
+        {
+            std::cout << "ERROR::SHADER::UNIFORM_TYPE_MISMATCH\n" << slot.name << std::endl;
+        }
+        return;
+    }
+}
+
+std::size_t Shader::findSlot(const char *name, GLenum type)
+{
+    for (std::size_t index = 0; index < slots.size(); index++)
+    {
+        if (slots[index].name == name && slots[index].type == type)
+        {
+            return index;
+        }
+    }
+    slots.push_back({name, type});
+    resolve(slots.back());
+    return slots.size() - 1;
+}
+
+bool Shader::changed(std::size_t slot, const void *value, std::size_t size)
+{
+    if (slot >= slots.size() || slots[slot].location < 0)
+    {
+        return false;
+    }
+    UniformSlot &uniform = slots[slot];
+    if (uniform.hasValue && std::memcmp(uniform.value, value, size) == 0)
+    {
+        uniformStats.skipped++;
+        return false;
+    }
+    std::memcpy(uniform.value, value, size);
+    // the fallback program is shared by every Shader that is still building, so no one knows what it has
+    uniform.hasValue = ownsProgram;
+    uniformStats.uploads++;
+    return true;
+}
+
+void Shader::Set(Uniform<GLfloat> uniform, GLfloat value)
+{
+    if (changed(uniform.slot, &value, sizeof(value)))
+    {
+        glUniform1f(slots[uniform.slot].location, value);
+    }
+}
+
+void Shader::Set(Uniform<GLint> uniform, GLint value)
+{
+    if (changed(uniform.slot, &value, sizeof(value)))
+    {
+        glUniform1i(slots[uniform.slot].location, value);
+    }
+}
+
+void Shader::Set(Uniform<glm::vec3> uniform, const glm::vec3 &value)
+{
+    if (changed(uniform.slot, &value, sizeof(value)))
+    {
+        glUniform3fv(slots[uniform.slot].location, 1, &value[0]);
+    }
+}
+
+void Shader::Set(Uniform<glm::vec4> uniform, const glm::vec4 &value)
+{
+    if (changed(uniform.slot, &value, sizeof(value)))
+    {
+        glUniform4fv(slots[uniform.slot].location, 1, &value[0]);
+    }
+}
+
+void Shader::Set(Uniform<glm::mat4> uniform, const glm::mat4 &value)
+{
+    if (changed(uniform.slot, &value, sizeof(value)))
+    {
+        glUniformMatrix4fv(slots[uniform.slot].location, 1, GL_FALSE, &value[0][0]);
+    }
+}
+
+const std::vector<ShaderUniformInfo> &Shader::getActiveUniforms()
+{
+    return uniforms;
+}
+
+const std::vector<ShaderBlockInfo> &Shader::getActiveBlocks()
+{
+    return blocks;
+}
+
+const UniformUploadStats &Shader::getUniformStats()
+{
+    return uniformStats;
+}
+
+void Shader::resetUniformStats()
+{
+    uniformStats = UniformUploadStats();
+}
+
+void Shader::SetBlockBinding(const char *blockName, GLuint binding)
+{
+    for (std::pair<std::string, GLuint> &blockBinding : blockBindings)
+    {
+        if (blockBinding.first == blockName)
+        {
+            blockBinding.second = binding;
+            return;
+        }
+    }
+    blockBindings.emplace_back(blockName, binding);
 }
 
 void Shader::Delete()
 {
-    glDeleteProgram(ID);
+    if (pending)
+    {
+        compiler->Release(compileHandle);
+        pending = false;
+    }
+    if (ownsProgram)
+    {
+        GLStateCache::getShared().ForgetProgram(ID);
+        glDeleteProgram(ID);
+    }
 }
 
 
 void Shader::Activate()
 {
-    glUseProgram(ID);
-}
\ No newline at end of file
+    GLStateCache::getShared().UseProgram(ID);
+}
@@ -0,0 +1,323 @@
+#include "../include/ShaderCompiler.h"
+#include "../include/ProgramCache.h"
+#include "../include/GLStateCache.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+using Clock = std::chrono::steady_clock;
+
+// the same inputs and uniforms as default.vert so it can stand in for any program the demo draws with, the
+// Frame block is frame.glsl
+static const char *FALLBACK_VERTEX_SOURCE = R"(#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (std140) uniform Frame
+{
+    mat4 viewMatrix;
+    mat4 projectionMatrix;
+    mat4 viewProjectionMatrix;
+    vec4 viewport;
+    float time;
+};
+uniform mat4 modelMatrix;
+void main()
+{
+    gl_Position = viewProjectionMatrix * (modelMatrix * vec4(aPos, 1.0));
+}
+)";
+static const char *FALLBACK_FRAGMENT_SOURCE = R"(#version 330 core
+out vec4 FragColor;
+void main()
+{
+    FragColor = vec4(0.5, 0.5, 0.5, 1.0);
+}
+)";
+
+static bool hasExtension(const char *name)
+{
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++)
+    {
+        const GLubyte *extension = glGetStringi(GL_EXTENSIONS, i);
+        if (extension != nullptr && std::strcmp(reinterpret_cast<const char *>(extension), name) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static GLuint startShader(GLenum type, const std::string &source)
+{
+    GLuint shader = glCreateShader(type);
+    const char *code = source.c_str();
+    glShaderSource(shader, 1, &code, NULL);
+    glCompileShader(shader);
+    return shader;
+}
+
+// Private Methods
+bool ShaderCompiler::isComplete(GLuint object, bool isProgram)
+{
+    if (!parallel)
+    {
+        // without the extension there is no way to ask, the status checks will wait if they have to
+        return true;
+    }
+    GLint complete = GL_FALSE;
+    if (isProgram)
+    {
+        glGetProgramiv(object, GL_COMPLETION_STATUS_KHR, &complete);
+    }
+    else
+    {
+        glGetShaderiv(object, GL_COMPLETION_STATUS_KHR, &complete);
+    }
+    return complete == GL_TRUE;
+}
+
+void ShaderCompiler::fail(Job &job, const std::string &error)
+{
+    deleteObjects(job);
+    job.error = error;
+    job.state = CompileState::Failed;
+    std::cout << "ERROR::SHADER::" << job.name << "::BUILD_FAILED\n" << error << std::endl;
+}
+
+void ShaderCompiler::deleteObjects(Job &job)
+{
+    glDeleteShader(job.vertexShader);
+    glDeleteShader(job.fragmentShader);
+    // a program from the ProgramCache is ready from the start and may have been drawn with
+    GLStateCache::getShared().ForgetProgram(job.program);
+    glDeleteProgram(job.program);
+    job.vertexShader = 0;
+    job.fragmentShader = 0;
+    job.program = 0;
+}
+
+void ShaderCompiler::finishCompiling(Job &job)
+{
+    const std::pair<GLuint, const char *> stages[2] = {{job.vertexShader, "VERTEX"}, {job.fragmentShader, "FRAGMENT"}};
+    for (const auto &[shader, stageName] : stages)
+    {
+        GLint success = GL_FALSE;
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+        if (!success)
+        {
+            char infoLog[512];
+            glGetShaderInfoLog(shader, sizeof(infoLog), NULL, infoLog);
+            fail(job, std::string(stageName) + "::COMPILATION_FAILED\n" + infoLog);
+            return;
+        }
+    }
+    job.program = glCreateProgram();
+    if (ProgramCache::getShared().isSupported())
+    {
+        glProgramParameteri(job.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+    glAttachShader(job.program, job.vertexShader);
+    glAttachShader(job.program, job.fragmentShader);
+    glLinkProgram(job.program);
+    job.state = CompileState::Linking;
+}
+
+void ShaderCompiler::finishLinking(Job &job)
+{
+    GLint success = GL_FALSE;
+    glGetProgramiv(job.program, GL_LINK_STATUS, &success);
+    if (!success)
+    {
+        char infoLog[512];
+        glGetProgramInfoLog(job.program, sizeof(infoLog), NULL, infoLog);
+        fail(job, std::string("PROGRAM::LINKING_FAILED\n") + infoLog);
+        return;
+    }
+    // the shaders are only needed until the program links
+    glDeleteShader(job.vertexShader);
+    glDeleteShader(job.fragmentShader);
+    job.vertexShader = 0;
+    job.fragmentShader = 0;
+    ProgramCache::getShared().Store(job.cacheKey, job.program);
+    job.milliseconds = std::chrono::duration<double, std::milli>(Clock::now() - job.start).count();
+    job.state = CompileState::Ready;
+}
+
+ShaderCompiler::Job &ShaderCompiler::getJob(CompileHandle handle)
+{
+    if (handle >= jobs.size() || !jobs[handle].live)
+    {
+        throw std::out_of_range("Invalid compile handle " + std::to_string(handle));
+    }
+    return jobs[handle];
+}
+
+// Public Methods
+ShaderCompiler::ShaderCompiler(GLADloadproc getProcAddress)
+{
+    const char *names[2][2] = {{"GL_KHR_parallel_shader_compile", "glMaxShaderCompilerThreadsKHR"},
+                               {"GL_ARB_parallel_shader_compile", "glMaxShaderCompilerThreadsARB"}};
+    for (const auto &[extension, function] : names)
+    {
+        if (hasExtension(extension))
+        {
+            maxShaderCompilerThreads = reinterpret_cast<PFNGLMAXSHADERCOMPILERTHREADSKHRPROC>(getProcAddress(function));
+            if (maxShaderCompilerThreads != nullptr)
+            {
+                break;
+            }
+        }
+    }
+    if (maxShaderCompilerThreads != nullptr)
+    {
+        // let the driver use as many threads as it wants
+        maxShaderCompilerThreads(0xFFFFFFFF);
+        parallel = true;
+    }
+
+    // the fallback has to work from the first frame so it is built the slow way
+    CompileHandle fallback = Submit("FALLBACK", FALLBACK_VERTEX_SOURCE, FALLBACK_FRAGMENT_SOURCE);
+    bool savedParallel = parallel;
+    parallel = false;
+    Poll();
+    Poll();
+    parallel = savedParallel;
+    fallbackProgram = Take(fallback);
+    Release(fallback);
+}
+
+CompileHandle ShaderCompiler::Submit(const char *name, const std::string &vertexCode, const std::string &fragmentCode)
+{
+    CompileHandle handle = jobs.size();
+    if (!freeHandles.empty())
+    {
+        handle = freeHandles.back();
+        freeHandles.pop_back();
+    }
+    else
+    {
+        jobs.emplace_back();
+    }
+    Job &job = jobs[handle];
+    job.live = true;
+    job.name = name;
+    job.start = Clock::now();
+    ProgramCache &cache = ProgramCache::getShared();
+    job.cacheKey = cache.makeKey(vertexCode, fragmentCode);
+    job.program = cache.Load(job.cacheKey);
+    if (job.program != 0)
+    {
+        job.fromProgramCache = true;
+        job.milliseconds = std::chrono::duration<double, std::milli>(Clock::now() - job.start).count();
+        job.state = CompileState::Ready;
+        return handle;
+    }
+    // no status checks here, that is what would make the driver finish the compile right away
+    job.vertexShader = startShader(GL_VERTEX_SHADER, vertexCode);
+    job.fragmentShader = startShader(GL_FRAGMENT_SHADER, fragmentCode);
+    active.push_back(handle);
+    return handle;
+}
+
+void ShaderCompiler::Poll()
+{
+    for (std::size_t i = 0; i < active.size();)
+    {
+        Job &job = jobs[active[i]];
+        if (job.state == CompileState::Compiling && isComplete(job.vertexShader, false) && isComplete(job.fragmentShader, false))
+        {
+            finishCompiling(job);
+        }
+        else if (job.state == CompileState::Linking && isComplete(job.program, true))
+        {
+            finishLinking(job);
+        }
+        if (job.state == CompileState::Ready || job.state == CompileState::Failed)
+        {
+            active[i] = active.back();
+            active.pop_back();
+        }
+        else
+        {
+            i++;
+        }
+    }
+}
+
+CompileState ShaderCompiler::getState(CompileHandle handle)
+{
+    return getJob(handle).state;
+}
+
+GLuint ShaderCompiler::getProgram(CompileHandle handle)
+{
+    Job &job = getJob(handle);
+    return job.state == CompileState::Ready && job.program != 0 ? job.program : fallbackProgram;
+}
+
+GLuint ShaderCompiler::Take(CompileHandle handle)
+{
+    Job &job = getJob(handle);
+    if (job.state != CompileState::Ready)
+    {
+        return 0;
+    }
+    GLuint program = job.program;
+    job.program = 0;
+    return program;
+}
+
+void ShaderCompiler::Release(CompileHandle handle)
+{
+    Job &job = getJob(handle);
+    deleteObjects(job);
+    job = Job();
+    active.erase(std::remove(active.begin(), active.end(), handle), active.end());
+    freeHandles.push_back(handle);
+}
+
+const std::string &ShaderCompiler::getError(CompileHandle handle)
+{
+    return getJob(handle).error;
+}
+
+double ShaderCompiler::getMilliseconds(CompileHandle handle)
+{
+    return getJob(handle).milliseconds;
+}
+
+bool ShaderCompiler::isFromProgramCache(CompileHandle handle)
+{
+    return getJob(handle).fromProgramCache;
+}
+
+std::size_t ShaderCompiler::getPendingCount()
+{
+    return active.size();
+}
+
+bool ShaderCompiler::isParallel()
+{
+    return parallel;
+}
+
+GLuint ShaderCompiler::getFallbackProgram()
+{
+    return fallbackProgram;
+}
+
+void ShaderCompiler::Delete()
+{
+    for (Job &job : jobs)
+    {
+        deleteObjects(job);
+    }
+    jobs.clear();
+    freeHandles.clear();
+    active.clear();
+    GLStateCache::getShared().ForgetProgram(fallbackProgram);
+    glDeleteProgram(fallbackProgram);
+    fallbackProgram = 0;
+}
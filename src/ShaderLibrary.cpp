@@ -0,0 +1,324 @@
+#include "../include/ShaderLibrary.h"
+#include "../include/MeshFile.h"
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_set>
+
+const char *getLightingModelName(LightingModel model)
+{
+    switch (model)
+    {
+        case LightingModel::Unlit: return "Unlit";
+        case LightingModel::Lambert: return "Lambert";
+        default: return "Unknown";
+    }
+}
+
+std::vector<std::string> getFeatureDefines(const ShaderFeatures &features)
+{
+    std::vector<std::string> defines;
+    if (features.instancing)
+    {
+        defines.push_back("INSTANCING");
+    }
+    if (features.quantizedPositions)
+    {
+        defines.push_back("QUANTIZED_POSITIONS");
+    }
+    if (features.wireframe)
+    {
+        defines.push_back("WIREFRAME");
+    }
+    if (features.lighting == LightingModel::Lambert)
+    {
+        defines.push_back("LIGHTING_LAMBERT");
+    }
+    return defines;
+}
+
+std::uint64_t makePermutationKey(ShaderProgramId program, const ShaderFeatures &features)
+{
+    std::uint64_t bits = (features.instancing ? 1u : 0u) | (features.quantizedPositions ? 2u : 0u) |
+                         (features.wireframe ? 4u : 0u) | (static_cast<std::uint32_t>(features.lighting) << 8);
+    return (static_cast<std::uint64_t>(program) << 32) | bits;
+}
+
+// The name of the file an #include line asks for, or an empty view if line isn't an #include.
+static std::string_view getIncludeName(std::string_view line, const std::string &path, std::size_t lineNumber)
+{
+    std::size_t start = line.find_first_not_of(" \t");
+    if (start == std::string_view::npos || line[start] != '#')
+    {
+        return {};
+    }
+    std::size_t directive = line.find_first_not_of(" \t", start + 1);
+    if (directive == std::string_view::npos || line.substr(directive, 7) != "include")
+    {
+        return {};
+    }
+    std::size_t open = line.find('"', directive + 7);
+    std::size_t close = open == std::string_view::npos ? open : line.find('"', open + 1);
+    if (close == std::string_view::npos || close == open + 1)
+    {
+        throw std::runtime_error(path + "(" + std::to_string(lineNumber) + "): #include needs a quoted file name");
+    }
+    return line.substr(open + 1, close - open - 1);
+}
+
+// Appends path to code with its includes expanded. The first file keeps its #version line first and marks
+// where the defines go.
+static void expandFile(const std::string &path, std::vector<std::string> &files, std::string &code,
+                       std::size_t &defineOffset)
+{
+    std::string index = std::to_string(files.size());
+    bool first = files.empty();
+    files.push_back(path);
+    if (!first)
+    {
+        code += "#line 1 " + index + "\n";
+    }
+    std::string contents;
+    try
+    {
+        contents = get_file_contents(path.c_str());
+    }
+    catch (const std::exception &)
+    {
+        throw std::runtime_error("Could not open shader " + path);
+    }
+    std::istringstream stream(contents);
+    std::string line;
+    std::size_t lineNumber = 0;
+    while (std::getline(stream, line))
+    {
+        lineNumber++;
+        if (!line.empty() && line.back() == '\r')
+        {
+            line.pop_back();
+        }
+        if (first && defineOffset == std::string::npos && line.find("#version") != std::string::npos)
+        {
+            code += line + "\n";
+            defineOffset = code.size();
+            code += "#line " + std::to_string(lineNumber + 1) + " " + index + "\n";
+            continue;
+        }
+        std::string_view name = getIncludeName(line, path, lineNumber);
+        if (name.empty())
+        {
+            code += line + "\n";
+            continue;
+        }
+        std::string included = (std::filesystem::path(path).parent_path() / name).lexically_normal().string();
+        if (std::find(files.begin(), files.end(), included) == files.end())
+        {
+            expandFile(included, files, code, defineOffset);
+        }
+        // back to where the include was
+        code += "#line " + std::to_string(lineNumber + 1) + " " + index + "\n";
+    }
+}
+
+PreprocessedShader preprocessShader(const std::string &path, const std::vector<std::string> &defines)
+{
+    PreprocessedShader shader;
+    std::size_t defineOffset = std::string::npos;
+    expandFile(path, shader.files, shader.code, defineOffset);
+
+    std::string defineLines;
+    for (const std::string &define : defines)
+    {
+        // a define nothing reads would only make another copy of the same program
+        if (shader.code.find(define) != std::string::npos)
+        {
+            defineLines += "#define " + define + " 1\n";
+        }
+    }
+    if (defineOffset == std::string::npos)
+    {
+        // no #version, so the defines go first and the line numbers start over after them
+        defineOffset = 0;
+        defineLines += "#line 1 0\n";
+    }
+    shader.code.insert(defineOffset, defineLines);
+    return shader;
+}
+
+ShaderLibrary::ShaderLibrary(ShaderCompiler &compiler)
+    : compiler(compiler)
+{
+}
+
+std::string ShaderLibrary::getVariantName(const Program &program, const ShaderFeatures &features)
+{
+    std::string name = program.name;
+    for (const std::string &define : getFeatureDefines(features))
+    {
+        name += "+" + define;
+    }
+    return name;
+}
+
+std::uint64_t ShaderLibrary::hashSources(const std::string &vertexCode, const std::string &fragmentCode)
+{
+    std::uint64_t lengths[2] = {vertexCode.size(), fragmentCode.size()};
+    std::uint64_t hash = meshChecksum(lengths, sizeof(lengths));
+    hash = meshChecksum(vertexCode.data(), vertexCode.size(), hash);
+    return meshChecksum(fragmentCode.data(), fragmentCode.size(), hash);
+}
+
+void ShaderLibrary::preprocess(const Program &program, const ShaderFeatures &features, std::string &vertexCode,
+                               std::string &fragmentCode, std::vector<std::string> &files)
+{
+    std::vector<std::string> defines = getFeatureDefines(features);
+    PreprocessedShader vertex = preprocessShader(program.vertexPath, defines);
+    PreprocessedShader fragment = preprocessShader(program.fragmentPath, defines);
+    vertexCode = std::move(vertex.code);
+    fragmentCode = std::move(fragment.code);
+    files = std::move(vertex.files);
+    for (std::string &file : fragment.files)
+    {
+        if (std::find(files.begin(), files.end(), file) == files.end())
+        {
+            files.push_back(std::move(file));
+        }
+    }
+}
+
+ShaderProgramId ShaderLibrary::Register(const char *name, const char *vertexPath, const char *fragmentPath)
+{
+    programs.push_back({name, vertexPath, fragmentPath});
+    return static_cast<ShaderProgramId>(programs.size() - 1);
+}
+
+Shader &ShaderLibrary::getShader(ShaderProgramId program, const ShaderFeatures &features)
+{
+    std::uint64_t key = makePermutationKey(program, features);
+    std::unordered_map<std::uint64_t, std::size_t>::iterator found = variants.find(key);
+    if (found != variants.end())
+    {
+        return *shaders[found->second].shader;
+    }
+
+    const Program &source = programs.at(program);
+    std::string vertexCode;
+    std::string fragmentCode;
+    std::vector<std::string> files;
+    preprocess(source, features, vertexCode, fragmentCode, files);
+    std::uint64_t hash = hashSources(vertexCode, fragmentCode);
+    std::unordered_map<std::uint64_t, std::size_t>::iterator existing = sources.find(hash);
+    if (existing != sources.end())
+    {
+        variants.emplace(key, existing->second);
+        return *shaders[existing->second].shader;
+    }
+
+    std::string name = getVariantName(source, features);
+    std::unique_ptr<Shader> shader = std::make_unique<Shader>(compiler, name.c_str(), vertexCode, fragmentCode);
+    shaders.push_back({std::move(shader), program, features, std::move(name), hash, std::move(files)});
+    sources.emplace(hash, shaders.size() - 1);
+    variants.emplace(key, shaders.size() - 1);
+    return *shaders.back().shader;
+}
+
+std::size_t ShaderLibrary::Update(const std::function<void(const std::string &name, Shader &shader)> &onReady)
+{
+    std::size_t ready = 0;
+    for (Variant &variant : shaders)
+    {
+        if (variant.shader->Update())
+        {
+            ready++;
+            if (onReady)
+            {
+                onReady(variant.name, *variant.shader);
+            }
+        }
+    }
+    return ready;
+}
+
+std::size_t ShaderLibrary::Reload(const std::string &path)
+{
+    std::vector<bool> rebuilt(shaders.size(), false);
+    std::size_t rebuiltCount = 0;
+    for (std::size_t index = 0; index < shaders.size(); index++)
+    {
+        Variant &variant = shaders[index];
+        if (std::find(variant.files.begin(), variant.files.end(), path) == variant.files.end())
+        {
+            continue;
+        }
+        std::string vertexCode;
+        std::string fragmentCode;
+        std::vector<std::string> files;
+        try
+        {
+            preprocess(programs[variant.program], variant.features, vertexCode, fragmentCode, files);
+        }
+        catch (const std::exception &error)
+        {
+            std::cout << "ERROR::SHADER::RELOAD_FAILED\n" << error.what() << std::endl;
+            continue;
+        }
+        std::uint64_t hash = hashSources(vertexCode, fragmentCode);
+        // saved without changes, or a change inside an #ifdef this variant doesn't take
+        if (hash == variant.sourceHash || !variant.shader->Rebuild(vertexCode, fragmentCode))
+        {
+            continue;
+        }
+        std::unordered_map<std::uint64_t, std::size_t>::iterator old = sources.find(variant.sourceHash);
+        if (old != sources.end() && old->second == index)
+        {
+            sources.erase(old);
+        }
+        sources.insert_or_assign(hash, index);
+        variant.sourceHash = hash;
+        variant.files = std::move(files);
+        rebuilt[index] = true;
+        rebuiltCount++;
+    }
+
+    // the keys that shared a rebuilt variant are looked up again, their features may matter to the new sources
+    for (std::unordered_map<std::uint64_t, std::size_t>::iterator it = variants.begin(); it != variants.end();)
+    {
+        const Variant &variant = shaders[it->second];
+        if (rebuilt[it->second] && it->first != makePermutationKey(variant.program, variant.features))
+        {
+            it = variants.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+    return rebuiltCount;
+}
+
+const ShaderLibraryStats &ShaderLibrary::getStats()
+{
+    std::unordered_set<std::size_t> used;
+    for (const std::pair<const std::uint64_t, std::size_t> &variant : variants)
+    {
+        used.insert(variant.second);
+    }
+    stats.variants = variants.size();
+    stats.programs = shaders.size();
+    stats.shared = variants.size() - used.size();
+    return stats;
+}
+
+void ShaderLibrary::Delete()
+{
+    for (Variant &variant : shaders)
+    {
+        variant.shader->Delete();
+    }
+    shaders.clear();
+    variants.clear();
+    sources.clear();
+}
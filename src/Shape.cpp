@@ -1,80 +1,352 @@
 #include "../include/Shape.h"
+#include "../include/InstanceBuffer.h"
+#include "../include/MeshFile.h"
+#include "../include/MeshParser.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 
 // Private Methods
 std::vector<GLfloat> Shape::readVertices(const char *verticesPath)
 {
-    std::ifstream file(verticesPath);
-    if (!file.is_open())
+    return readVertexFile(verticesPath);
+}
+
+std::vector<GLuint> Shape::readIndices(const char *indicesPath)
+{
+    return readIndexFile(indicesPath);
+}
+
+PackedIndices Shape::upload(const GLfloat *vertexData, GLsizeiptr vertexFloatCount, const GLuint *indexData, GLsizeiptr indexCount)
+{
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &VBO);
+    glGenBuffers(1, &EBO);
+    vertexCapacity = 0;
+    indexCapacity = 0;
+
+    writeVertices(vertexData, vertexFloatCount);
+    PackedIndices packed = writeIndices(indexData, indexCount);
+
+    // the attribute types come from the vertex format, normalized integers get turned back into floats by the GPU
+    VertexLayout layout = getVertexLayout(format);
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glVertexAttribPointer(0, layout.position.size, layout.position.type, layout.position.normalized, layout.stride, (void*)(GLintptr)layout.position.offset);
+    glVertexAttribPointer(1, layout.color.size, layout.color.type, layout.color.normalized, layout.stride, (void*)(GLintptr)layout.color.offset);
+
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return packed;
+}
+
+void Shape::writeVertices(const GLfloat *vertexData, GLsizeiptr vertexFloatCount)
+{
+    if (format == VertexFormat::Float32)
     {
-        throw std::runtime_error("Could not open file " + std::string(verticesPath));
+        writeBuffer(GL_ARRAY_BUFFER, VBO, vertexCapacity, vertexData, vertexFloatCount * sizeof(GLfloat));
+        return;
     }
-    std::vector<GLfloat> emptyVertices;
-    GLfloat value;
-    while (file >> value)
+    PackedVertices packed = packVertices(vertexData, vertexFloatCount / 6, format);
+    for (int axis = 0; axis < 3; axis++)
     {
-        emptyVertices.emplace_back(value);
+        positionScale[axis] = packed.positionScale[axis];
+        positionOffset[axis] = packed.positionOffset[axis];
     }
-    file.close();
-    return emptyVertices;
+    maxPositionError = packed.maxPositionError;
+    writeBuffer(GL_ARRAY_BUFFER, VBO, vertexCapacity, packed.data.data(), packed.data.size());
 }
 
-std::vector<GLuint> Shape::readIndices(const char *indicesPath)
+PackedIndices Shape::writeIndices(const GLuint *indexData, GLsizeiptr indexCount)
+{
+    PackedIndices packed = packIndices(indexData, indexCount, vertexCount / 6);
+    indexType = packed.type;
+    writeBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO, indexCapacity, packed.data.data(), packed.data.size());
+    return packed;
+}
+
+void Shape::writeBuffer(GLenum target, GLuint buffer, GLsizeiptr &capacity, const void *data, GLsizeiptr bytes)
 {
-    std::ifstream file(indicesPath);
-    if (!file.is_open())
+    // the element buffer binding belongs to the VAO so it has to be bound while we write
+    glBindVertexArray(VAO);
+    glBindBuffer(target, buffer);
+    if (bytes <= capacity)
     {
-        throw std::runtime_error("Could not open file " + std::string(indicesPath));
+        glBufferSubData(target, 0, bytes, data);
     }
-    std::vector<GLuint> emptyIndices;
-    GLuint value;
-    while (file >> value)
+    else
     {
-        emptyIndices.emplace_back(value);
+        glBufferData(target, bytes, data, GL_STATIC_DRAW);
+        capacity = bytes;
+    }
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void Shape::validate(GLsizeiptr vertexFloatCount, const GLuint *indices, GLsizeiptr indexCount)
+{
+    if (vertexFloatCount % 6 != 0)
+    {
+        throw std::runtime_error("Vertex data is not a multiple of 6 floats");
+    }
+    for (GLsizeiptr i = 0; i < indexCount; i++)
+    {
+        if (static_cast<GLsizeiptr>(indices[i]) >= vertexFloatCount / 6)
+        {
+            throw std::runtime_error("Index " + std::to_string(indices[i]) + " is out of range");
+        }
+    }
+}
+
+void Shape::create(std::vector<GLuint> indices)
+{
+    validate(vertices.size(), indices.data(), indices.size());
+    vertexCount = vertices.size();
+    indexCount = indices.size();
+    computeBounds(vertices.data(), vertexCount);
+
+    // only the narrowed copy of the indices is kept
+    this->indices = upload(vertices.data(), vertexCount, indices.data(), indexCount);
+}
+
+void Shape::setBounds(const float *boundsMin, const float *boundsMax)
+{
+    float radiusSquared = 0.0f;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        boundsCenter[axis] = (boundsMin[axis] + boundsMax[axis]) * 0.5f;
+        float halfSize = (boundsMax[axis] - boundsMin[axis]) * 0.5f;
+        radiusSquared += halfSize * halfSize;
+    }
+    boundsRadius = std::sqrt(radiusSquared);
+}
+
+void Shape::computeBounds(const GLfloat *vertexData, GLsizeiptr vertexFloatCount)
+{
+    if (vertexFloatCount == 0)
+    {
+        float zero[3] = {0.0f, 0.0f, 0.0f};
+        setBounds(zero, zero);
+        return;
+    }
+    float boundsMin[3] = {vertexData[0], vertexData[1], vertexData[2]};
+    float boundsMax[3] = {vertexData[0], vertexData[1], vertexData[2]};
+    for (GLsizeiptr i = 0; i < vertexFloatCount; i += 6)
+    {
+        for (int axis = 0; axis < 3; axis++)
+        {
+            boundsMin[axis] = std::min(boundsMin[axis], vertexData[i + axis]);
+            boundsMax[axis] = std::max(boundsMax[axis], vertexData[i + axis]);
+        }
+    }
+    setBounds(boundsMin, boundsMax);
+}
+
+void Shape::readLods(const MappedMesh &mesh)
+{
+    // the file was checked when it was mapped so the levels are in range
+    lods.clear();
+    currentLod = 0;
+    for (std::size_t i = 0; i < mesh.getLodCount(); i++)
+    {
+        const MeshFileLod &lod = mesh.getLods()[i];
+        lods.push_back({static_cast<std::uint32_t>(lod.indexOffset), static_cast<std::uint32_t>(lod.indexCount), lod.error});
     }
-    file.close();
-    return emptyIndices;
 }
 
 // Public Methods
-Shape::Shape(const char *verticesPath, const char *indicesPath)
+Shape::Shape(const char *verticesPath, const char *indicesPath, VertexFormat format)
+    : format(format), vertices(readVertices(verticesPath))
 {
-    vertices = readVertices(verticesPath);
-    indices = readIndices(indicesPath);
+    std::vector<GLuint> indices = readIndices(indicesPath);
+    optimize(vertices, indices);
+    lods = buildLodChain(vertices, indices);
+    meshlets = buildMeshlets(vertices.data(), vertices.size() / 6, indices.data(), lods[0].indexCount);
+    create(std::move(indices));
+}
 
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glGenBuffers(1, &EBO);
+// the mapping only has to live as long as the upload, the driver copies out of it
+Shape::Shape(const char *meshPath, VertexFormat format) : Shape(MappedMesh(meshPath), format)
+{
+}
 
-    glBindVertexArray(VAO);
+Shape::Shape(std::vector<GLfloat> vertices, std::vector<GLuint> indices, VertexFormat format)
+    : format(format), vertices(std::move(vertices))
+{
+    create(std::move(indices));
+}
 
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(GLfloat),vertices.data(), GL_STATIC_DRAW);
+Shape::Shape(const MappedMesh &mesh, VertexFormat format) : format(format)
+{
+#ifndef NDEBUG
+    if (!mesh.verifyChecksum())
+    {
+        throw std::runtime_error("Checksum mismatch in mesh file");
+    }
+#endif
+    const MeshFileHeader &header = mesh.getHeader();
+    validate(header.vertexCount * 6, static_cast<const GLuint *>(mesh.getIndexData()), header.indexCount);
+    vertexCount = header.vertexCount * 6;
+    indexCount = header.indexCount;
+    setBounds(header.boundsMin, header.boundsMax);
+    readLods(mesh);
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint),indices.data(), GL_STATIC_DRAW);
+    upload(static_cast<const GLfloat *>(mesh.getVertexData()), vertexCount, static_cast<const GLuint *>(mesh.getIndexData()), indexCount);
+}
 
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE,6 * sizeof(GLfloat), (void*)0);
-    glVertexAttribPointer(1,3, GL_FLOAT, GL_FALSE,6 * sizeof(GLfloat), (void*)(3 * sizeof(GLfloat)));
 
-    glEnableVertexAttribArray(0);
-    glEnableVertexAttribArray(1);
+MeshOptimizationReport Shape::optimize(std::vector<GLfloat> &vertices, std::vector<GLuint> &indices, float weldEpsilon)
+{
+    // the files are written by hand so the triangle order is whatever was typed
+    validate(vertices.size(), indices.data(), indices.size());
+    return optimizeMesh(vertices, indices, weldEpsilon);
+}
 
+void Shape::Draw()
+{
+    GLsizeiptr first = 0;
+    GLsizeiptr count = indexCount;
+    if (!lods.empty())
+    {
+        first = lods[currentLod].indexOffset;
+        count = lods[currentLod].indexCount;
+    }
+    glBindVertexArray(VAO);
+    glDrawElements(GL_TRIANGLES, count, indexType, (void*)(GLintptr)(first * getIndexSize(indexType)));
     glBindVertexArray(0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
 
-    indexCount = indices.size();
+void Shape::DrawInstanced(InstanceBuffer &instances)
+{
+    if (instances.getCount() == 0)
+    {
+        return;
+    }
+    GLsizeiptr first = 0;
+    GLsizeiptr count = indexCount;
+    if (!lods.empty())
+    {
+        first = lods[currentLod].indexOffset;
+        count = lods[currentLod].indexCount;
+    }
+    glBindVertexArray(VAO);
+    // the instance attributes are part of the VAO, so they are only set up again for a different buffer
+    if (instanceBufferId != instances.getId())
+    {
+        instances.BindAttributes();
+        instanceBufferId = instances.getId();
+    }
+    glDrawElementsInstanced(GL_TRIANGLES, count, indexType, (void*)(GLintptr)(first * getIndexSize(indexType)),
+                            instances.getCount());
+    glBindVertexArray(0);
 }
 
+void Shape::Update(std::vector<GLfloat> newVertices, std::vector<GLuint> newIndices)
+{
+    validate(newVertices.size(), newIndices.data(), newIndices.size());
+    meshlets.clear();
+    lods.clear();
+    currentLod = 0;
+    vertices = std::move(newVertices);
+    vertexCount = vertices.size();
+    indexCount = newIndices.size();
+    computeBounds(vertices.data(), vertexCount);
+    writeVertices(vertices.data(), vertexCount);
+    indices = writeIndices(newIndices.data(), indexCount);
+}
 
-void Shape::Draw()
+void Shape::Update(const MappedMesh &mesh)
+{
+    const MeshFileHeader &header = mesh.getHeader();
+    validate(header.vertexCount * 6, static_cast<const GLuint *>(mesh.getIndexData()), header.indexCount);
+    vertices.clear();
+    indices = PackedIndices();
+    meshlets.clear();
+    readLods(mesh);
+    vertexCount = header.vertexCount * 6;
+    indexCount = header.indexCount;
+    setBounds(header.boundsMin, header.boundsMax);
+    writeVertices(static_cast<const GLfloat *>(mesh.getVertexData()), vertexCount);
+    writeIndices(static_cast<const GLuint *>(mesh.getIndexData()), indexCount);
+}
+
+void Shape::DrawMeshlets(const MeshletFrustum &frustum, bool coneCulling)
 {
+    if (meshlets.empty() || currentLod > 0)
+    {
+        culledMeshlets = 0;
+        Draw();
+        return;
+    }
+    drawCounts.clear();
+    drawOffsets.clear();
+    culledMeshlets = 0;
+    GLsizeiptr indexSize = getIndexSize(indexType);
+    std::uint32_t previousEnd = UINT32_MAX;
+    for (const Meshlet &meshlet : meshlets)
+    {
+        if (!isMeshletVisible(meshlet, frustum, coneCulling))
+        {
+            culledMeshlets++;
+            continue;
+        }
+        // meshlets next to each other in the index buffer are drawn as one range
+        if (meshlet.indexOffset == previousEnd)
+        {
+            drawCounts.back() += meshlet.indexCount;
+        }
+        else
+        {
+            drawCounts.push_back(meshlet.indexCount);
+            drawOffsets.push_back((const void *)(GLintptr)(meshlet.indexOffset * indexSize));
+        }
+        previousEnd = meshlet.indexOffset + meshlet.indexCount;
+    }
+    if (drawCounts.empty())
+    {
+        return;
+    }
     glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
+    glMultiDrawElements(GL_TRIANGLES, drawCounts.data(), indexType, drawOffsets.data(), drawCounts.size());
     glBindVertexArray(0);
 }
 
+void Shape::setMeshlets(std::vector<Meshlet> meshlets)
+{
+    this->meshlets = std::move(meshlets);
+}
+
+void Shape::setLods(std::vector<LodLevel> lods)
+{
+    for (const LodLevel &lod : lods)
+    {
+        if (lod.indexOffset > indexCount || lod.indexCount > indexCount - lod.indexOffset)
+        {
+            throw std::runtime_error("LOD is outside the index buffer");
+        }
+    }
+    this->lods = std::move(lods);
+    currentLod = 0;
+}
+
+std::size_t Shape::SelectLod(const float *cameraPosition, float pixelsPerUnit)
+{
+    // the distance to the nearest point of the bounds, so the error is never underestimated
+    float offset[3] = {cameraPosition[0] - boundsCenter[0], cameraPosition[1] - boundsCenter[1], cameraPosition[2] - boundsCenter[2]};
+    float distance = std::sqrt(offset[0] * offset[0] + offset[1] * offset[1] + offset[2] * offset[2]) - boundsRadius;
+    currentLod = selectLodLevel(lods, distance, pixelsPerUnit);
+    return currentLod;
+}
+
+void Shape::setLod(std::size_t level)
+{
+    currentLod = lods.empty() ? 0 : std::min(level, lods.size() - 1);
+}
+
 void Shape::Delete()
 {
     glDeleteVertexArrays(1, &VAO);
@@ -89,24 +361,100 @@ std::vector<GLfloat> Shape::getVertices()
 
 std::vector<GLuint> Shape::getIndices()
 {
-    return indices;
+    return unpackIndices(indices);
 }
 
 GLsizeiptr Shape::getVerticesSize()
 {
-    return vertices.size();
+    return vertexCount;
 }
 GLsizeiptr Shape::getIndicesSize()
 {
-    return indices.size();
+    return indexCount;
 }
 GLsizeiptr Shape::getVerticesSizeInBytes()
 {
-    return vertices.size() * sizeof(GLfloat);
+    return vertexCount / 6 * getVertexLayout(format).stride;
 }
 
 GLsizeiptr Shape::getIndicesSizeInBytes()
 {
-    return indices.size() * sizeof(GLuint);
+    return indexCount * getIndexSize(indexType);
+}
+
+VertexFormat Shape::getVertexFormat()
+{
+    return format;
+}
+
+GLenum Shape::getIndexType()
+{
+    return indexType;
+}
+
+float Shape::getMaxPositionError()
+{
+    return maxPositionError;
+}
+
+glm::mat4 Shape::getPositionTransform()
+{
+    glm::mat4 transform = glm::translate(glm::mat4(1.0f), glm::vec3(positionOffset[0], positionOffset[1], positionOffset[2]));
+    return glm::scale(transform, glm::vec3(positionScale[0], positionScale[1], positionScale[2]));
+}
+
+std::size_t Shape::getLod()
+{
+    return currentLod;
+}
+
+std::size_t Shape::getLodCount()
+{
+    return lods.empty() ? 1 : lods.size();
+}
+
+float Shape::getLodError()
+{
+    return lods.empty() ? 0.0f : lods[currentLod].error;
+}
+
+glm::vec3 Shape::getBoundsCenter()
+{
+    return glm::vec3(boundsCenter[0], boundsCenter[1], boundsCenter[2]);
+}
+
+float Shape::getBoundsRadius()
+{
+    return boundsRadius;
+}
+
+GLsizeiptr Shape::getLodIndexOffset()
+{
+    return lods.empty() ? 0 : lods[currentLod].indexOffset;
+}
+
+GLsizeiptr Shape::getLodIndexCount()
+{
+    return lods.empty() ? indexCount : lods[currentLod].indexCount;
+}
+
+std::size_t Shape::getMeshletCount()
+{
+    return meshlets.size();
+}
+
+std::size_t Shape::getCulledMeshletCount()
+{
+    return culledMeshlets;
+}
+
+GLsizeiptr Shape::getGpuSizeInBytes()
+{
+    return vertexCapacity + indexCapacity;
+}
+
+GLsizeiptr Shape::getCpuSizeInBytes()
+{
+    return vertices.size() * sizeof(GLfloat) + indices.data.size() + meshlets.size() * sizeof(Meshlet);
 }
 
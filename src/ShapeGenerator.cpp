@@ -0,0 +1,317 @@
+#include "../include/ShapeGenerator.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+/*
+ * The files give phi / 2, 1 / (2 phi) and 0.5 cos(45 degrees) rounded like this, the generated shapes use the
+ * same values so both sources draw the same thing.
+ */
+constexpr float GOLDEN_HALF = 0.80902f;
+constexpr float GOLDEN_HALF_INVERSE = 0.30902f;
+constexpr float OCTAGON_DIAGONAL = 0.3536f;
+// the height of the apexes of the pyramid and the octahedron
+constexpr float APEX_HEIGHT = 0.8f;
+
+// Positions and colors are kept apart so the positions can be built from the geometry and the colors from a palette.
+static GeneratedMesh makeMesh(const std::vector<float> &positions, const std::vector<float> &colors,
+                              std::vector<std::uint32_t> indices)
+{
+    GeneratedMesh mesh;
+    std::size_t vertexCount = positions.size() / 3;
+    mesh.vertices.reserve(vertexCount * 6);
+    for (std::size_t v = 0; v < vertexCount; v++)
+    {
+        mesh.vertices.insert(mesh.vertices.end(), positions.begin() + v * 3, positions.begin() + v * 3 + 3);
+        mesh.vertices.insert(mesh.vertices.end(), colors.begin() + v * 3, colors.begin() + v * 3 + 3);
+    }
+    mesh.indices = std::move(indices);
+    return mesh;
+}
+
+// The corners of a square in the xz plane at height y, in the order the files list them.
+static void addSquare(std::vector<float> &positions, float y, float half)
+{
+    const float corners[4][2] = {{half, -half}, {half, half}, {-half, half}, {-half, -half}};
+    for (const float *corner : corners)
+    {
+        positions.insert(positions.end(), {corner[0], y, corner[1]});
+    }
+}
+
+// The three golden rectangles, one in each axis plane, make the 12 vertices of an icosahedron.
+static void addGoldenRectangles(std::vector<float> &positions, float shortHalf, float longHalf)
+{
+    for (float z : {-longHalf, longHalf})
+    {
+        for (float y : {shortHalf, -shortHalf})
+        {
+            positions.insert(positions.end(), {0.0f, y, z});
+        }
+    }
+    for (float x : {shortHalf, -shortHalf})
+    {
+        for (float y : {longHalf, -longHalf})
+        {
+            positions.insert(positions.end(), {x, y, 0.0f});
+        }
+    }
+    for (float x : {longHalf, -longHalf})
+    {
+        for (float z : {-shortHalf, shortHalf})
+        {
+            positions.insert(positions.end(), {x, 0.0f, z});
+        }
+    }
+}
+
+static GeneratedMesh generateBase(PolyhedronType type)
+{
+    std::vector<float> positions;
+    switch (type)
+    {
+        case PolyhedronType::Octagon:
+        {
+            // a fan around the center, clockwise from the top, with both windings so it shows from either side
+            positions = {0.0f, 0.0f, 0.0f};
+            const float points[8][2] = {{0.0f, 0.5f}, {OCTAGON_DIAGONAL, OCTAGON_DIAGONAL}, {0.5f, 0.0f},
+                                        {OCTAGON_DIAGONAL, -OCTAGON_DIAGONAL}, {0.0f, -0.5f},
+                                        {-OCTAGON_DIAGONAL, -OCTAGON_DIAGONAL}, {-0.5f, 0.0f},
+                                        {-OCTAGON_DIAGONAL, OCTAGON_DIAGONAL}};
+            for (const float *point : points)
+            {
+                positions.insert(positions.end(), {point[0], point[1], 0.0f});
+            }
+            std::vector<std::uint32_t> indices;
+            for (std::uint32_t i = 1; i <= 8; i++)
+            {
+                indices.insert(indices.end(), {0, i, i % 8 + 1});
+            }
+            for (std::uint32_t i = 1; i <= 8; i++)
+            {
+                indices.insert(indices.end(), {0, i % 8 + 1, i});
+            }
+            return makeMesh(positions, {1.0f, 1.0f, 1.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.5f, 0.2f, 1.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f,
+                                        0.0f, 0.0f, 1.0f, 0.2f, 0.0f, 0.5f, 0.6f, 0.1f, 0.9f, 1.0f, 0.2f, 0.2f},
+                            std::move(indices));
+        }
+        case PolyhedronType::Pyramid:
+        case PolyhedronType::Octahedron:
+        {
+            // a square base with an apex above it, and for the octahedron a second apex below
+            positions = {0.0f, APEX_HEIGHT, 0.0f};
+            const float base[4][2] = {{-0.5f, -0.5f}, {0.5f, -0.5f}, {0.5f, 0.5f}, {-0.5f, 0.5f}};
+            for (const float *corner : base)
+            {
+                positions.insert(positions.end(), {corner[0], 0.0f, corner[1]});
+            }
+            if (type == PolyhedronType::Pyramid)
+            {
+                return makeMesh(positions, {1.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f, 0.0f, 1.0f, 0.0f, 1.0f},
+                                {0, 2, 1, 0, 1, 4, 0, 4, 3, 0, 3, 2, 2, 3, 1, 4, 1, 3});
+            }
+            positions.insert(positions.end(), {0.0f, -APEX_HEIGHT, 0.0f});
+            return makeMesh(positions, {1.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f, 0.0f, 1.0f, 0.0f, 1.0f,
+                                        1.0f, 0.2f, 0.0f},
+                            {1, 0, 2, 0, 1, 4, 0, 4, 3, 0, 3, 2, 5, 2, 3, 5, 3, 4, 5, 1, 2, 5, 4, 1});
+        }
+        case PolyhedronType::Cube:
+        {
+            addSquare(positions, -0.5f, 0.5f);
+            addSquare(positions, 0.5f, 0.5f);
+            return makeMesh(positions, {1.0f, 0.0f, 0.0f, 1.0f, 0.3f, 0.0f, 1.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f,
+                                        0.0f, 0.0f, 1.0f, 0.2f, 0.0f, 0.5f, 0.6f, 0.1f, 0.9f, 1.0f, 0.2f, 0.2f},
+                            {0, 1, 3, 3, 1, 2, 0, 4, 1, 1, 4, 5, 1, 5, 2, 2, 5, 6, 2, 6, 3, 3, 6, 7, 0, 7, 4, 0, 3, 7,
+                             5, 4, 7, 5, 7, 6});
+        }
+        case PolyhedronType::Icosahedron:
+        {
+            addGoldenRectangles(positions, 0.5f, GOLDEN_HALF);
+            std::vector<float> colors;
+            for (int group = 0; group < 3; group++)
+            {
+                for (int corner = 0; corner < 4; corner++)
+                {
+                    colors.insert(colors.end(), {group == 0 ? 1.0f : 0.0f, group == 1 ? 1.0f : 0.0f, group == 2 ? 1.0f : 0.0f});
+                }
+            }
+            return makeMesh(positions, colors,
+                            {2, 9, 4, 0, 4, 8, 2, 6, 11, 9, 3, 5, 0, 10, 6, 5, 3, 7, 2, 4, 6, 4, 0, 6, 5, 7, 1, 3, 11, 7,
+                             5, 1, 8, 1, 7, 10, 1, 0, 8, 1, 10, 0, 10, 11, 6, 7, 11, 10, 3, 2, 11, 3, 9, 2, 5, 8, 9, 8, 4, 9});
+        }
+        case PolyhedronType::Dodecahedron:
+        {
+            // a cube with a golden rectangle pushed out through each pair of opposite faces, 12 pentagons as fans of 3
+            addSquare(positions, -0.5f, 0.5f);
+            addSquare(positions, 0.5f, 0.5f);
+            for (float z : {-GOLDEN_HALF_INVERSE, GOLDEN_HALF_INVERSE})
+            {
+                for (float y : {GOLDEN_HALF, -GOLDEN_HALF})
+                {
+                    positions.insert(positions.end(), {0.0f, y, z});
+                }
+            }
+            for (float x : {GOLDEN_HALF_INVERSE, -GOLDEN_HALF_INVERSE})
+            {
+                for (float z : {-GOLDEN_HALF, GOLDEN_HALF})
+                {
+                    positions.insert(positions.end(), {x, 0.0f, z});
+                }
+            }
+            for (float x : {GOLDEN_HALF, -GOLDEN_HALF})
+            {
+                for (float y : {GOLDEN_HALF_INVERSE, -GOLDEN_HALF_INVERSE})
+                {
+                    positions.insert(positions.end(), {x, y, 0.0f});
+                }
+            }
+            std::vector<float> colors = {1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.8f, 0.0f,
+                                         0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.8f,
+                                         0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.8f, 0.0f, 0.0f,
+                                         1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.8f, 0.0f,
+                                         0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f};
+            return makeMesh(positions, colors,
+                            {1, 13, 15, 1, 2, 11, 1, 15, 2, 6, 5, 10, 6, 13, 5, 6, 15, 13, 16, 5, 1, 13, 1, 5, 17, 16, 1,
+                             2, 6, 18, 2, 15, 6, 2, 18, 19, 6, 10, 18, 7, 18, 10, 7, 10, 8, 1, 11, 17, 9, 17, 11, 0, 17, 9,
+                             4, 16, 17, 4, 17, 0, 4, 0, 12, 8, 10, 4, 4, 10, 16, 16, 10, 5, 4, 7, 8, 4, 12, 7, 14, 7, 12,
+                             7, 19, 18, 7, 14, 19, 3, 19, 14, 3, 14, 12, 3, 12, 0, 3, 0, 9, 3, 9, 19, 11, 19, 9, 11, 2, 19});
+        }
+        case PolyhedronType::Tetrahedron:
+        {
+            // every other corner of the cube
+            positions = {0.5f, 0.5f, 0.5f, 0.5f, -0.5f, -0.5f, -0.5f, 0.5f, -0.5f, -0.5f, -0.5f, 0.5f};
+            return makeMesh(positions, {1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f, 0.0f},
+                            {0, 1, 2, 0, 3, 1, 0, 2, 3, 1, 3, 2});
+        }
+        default:
+            throw std::invalid_argument("Unknown polyhedron type");
+    }
+}
+
+const char *getPolyhedronName(PolyhedronType type)
+{
+    switch (type)
+    {
+        case PolyhedronType::Octagon: return "Octagon";
+        case PolyhedronType::Pyramid: return "Pyramid";
+        case PolyhedronType::Cube: return "Cube";
+        case PolyhedronType::Octahedron: return "Octahedron";
+        case PolyhedronType::Icosahedron: return "Icosahedron";
+        case PolyhedronType::Dodecahedron: return "Dodecahedron";
+        case PolyhedronType::Tetrahedron: return "Tetrahedron";
+        default: return "Unknown";
+    }
+}
+
+std::size_t getPolyhedronTriangleCount(const PolyhedronSettings &settings)
+{
+    std::size_t frequency = std::max<std::uint32_t>(settings.frequency, 1);
+    return generateBase(settings.type).indices.size() / 3 * frequency * frequency;
+}
+
+GeneratedMesh generatePolyhedron(const PolyhedronSettings &settings, ThreadPool *pool)
+{
+    GeneratedMesh base = generateBase(settings.type);
+    std::size_t frequency = std::max<std::uint32_t>(settings.frequency, 1);
+    if (frequency == 1)
+    {
+        return base;
+    }
+    std::size_t faceCount = base.indices.size() / 3;
+    std::size_t faceVertices = (frequency + 1) * (frequency + 2) / 2;
+    std::size_t faceTriangles = frequency * frequency;
+    if (faceCount * faceVertices > UINT32_MAX)
+    {
+        throw std::runtime_error("A frequency of " + std::to_string(frequency) + " needs more vertices than 32-bit indices can address");
+    }
+
+    GeneratedMesh mesh;
+    mesh.vertices.resize(faceCount * faceVertices * 6);
+    mesh.indices.resize(faceCount * faceTriangles * 3);
+    float inverseFrequency = 1.0f / frequency;
+
+    // row i of a face runs from the edge ab (i = 0) to the corner c (i = frequency), column j from a towards b
+    auto rowVertexStart = [frequency](std::size_t i) { return i * (frequency + 1) - i * (i - 1) / 2; };
+    auto rowTriangleStart = [frequency](std::size_t i) { return 2 * frequency * i - i * i; };
+    auto buildRow = [&](std::size_t job)
+    {
+        std::size_t face = job / (frequency + 1);
+        std::size_t i = job % (frequency + 1);
+        const std::uint32_t *corners = &base.indices[face * 3];
+        // adding the corners in index order makes a vertex on a shared edge the same in both faces
+        int order[3] = {0, 1, 2};
+        std::sort(order, order + 3, [corners](int a, int b) { return corners[a] < corners[b]; });
+        float radius[3];
+        for (int corner = 0; corner < 3; corner++)
+        {
+            const float *p = &base.vertices[corners[corner] * 6];
+            radius[corner] = std::sqrt(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+        }
+
+        std::uint32_t faceBase = static_cast<std::uint32_t>(face * faceVertices);
+        float *vertex = &mesh.vertices[(faceBase + rowVertexStart(i)) * 6];
+        for (std::size_t j = 0; j + i <= frequency; j++)
+        {
+            float weights[3] = {(frequency - i - j) * inverseFrequency, j * inverseFrequency, i * inverseFrequency};
+            float attributes[6] = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f};
+            float vertexRadius = 0.0f;
+            for (int corner : order)
+            {
+                const float *source = &base.vertices[corners[corner] * 6];
+                for (int component = 0; component < 6; component++)
+                {
+                    attributes[component] += source[component] * weights[corner];
+                }
+                vertexRadius += radius[corner] * weights[corner];
+            }
+            float length = std::sqrt(attributes[0] * attributes[0] + attributes[1] * attributes[1] + attributes[2] * attributes[2]);
+            // the corners are already on the sphere so they are left exactly where they were
+            bool isCorner = weights[0] == 1.0f || weights[1] == 1.0f || weights[2] == 1.0f;
+            if (settings.spherical && !isCorner && length > 0.0f)
+            {
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    attributes[axis] *= vertexRadius / length;
+                }
+            }
+            std::copy(attributes, attributes + 6, vertex);
+            vertex += 6;
+        }
+
+        if (i == frequency)
+        {
+            return;
+        }
+        auto index = [&](std::size_t row, std::size_t column)
+        {
+            return static_cast<std::uint32_t>(faceBase + rowVertexStart(row) + column);
+        };
+        std::uint32_t *triangle = &mesh.indices[(face * faceTriangles + rowTriangleStart(i)) * 3];
+        for (std::size_t j = 0; j + i < frequency; j++)
+        {
+            // the same winding as the face, pointing at a, b and c
+            *triangle++ = index(i, j);
+            *triangle++ = index(i, j + 1);
+            *triangle++ = index(i + 1, j);
+            if (j + i + 1 < frequency)
+            {
+                *triangle++ = index(i, j + 1);
+                *triangle++ = index(i + 1, j + 1);
+                *triangle++ = index(i + 1, j);
+            }
+        }
+    };
+    if (pool != nullptr)
+    {
+        pool->ParallelFor(faceCount * (frequency + 1), buildRow);
+    }
+    else
+    {
+        for (std::size_t job = 0; job < faceCount * (frequency + 1); job++)
+        {
+            buildRow(job);
+        }
+    }
+    return mesh;
+}
@@ -0,0 +1,589 @@
+#include "../include/ShapeRegistry.h"
+#include "../include/MeshFile.h"
+#include "../include/MeshParser.h"
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+
+using Clock = std::chrono::steady_clock;
+
+// Private Methods
+ShapeHandle ShapeRegistry::addEntry(const char *name, const char *verticesPath, const char *indicesPath, const char *meshPath)
+{
+    Entry &entry = entries.emplace_back();
+    entry.name = name;
+    entry.verticesPath = verticesPath;
+    entry.indicesPath = indicesPath;
+    entry.meshPath = meshPath;
+    return entries.size() - 1;
+}
+
+// Puts a freshly loaded shape in the registry, deleting the one it replaces.
+void ShapeRegistry::install(ShapeHandle handle, Shape shape, const MeshOptimizationReport &optimization)
+{
+    Entry &entry = entries[handle];
+    if (entry.shape)
+    {
+        entry.shape->Delete();
+    }
+    entry.shape = shape;
+    entry.optimization = optimization;
+    entry.error.clear();
+}
+
+void ShapeRegistry::placeInArena(ShapeHandle handle, const GLfloat *vertices, std::size_t vertexFloatCount, const GLuint *indices,
+                                 std::size_t indexCount)
+{
+    Entry &entry = entries[handle];
+    arena.Remove(entry.arenaHandle);
+    entry.arenaHandle = arena.Add(vertices, vertexFloatCount, indices, indexCount);
+}
+
+void ShapeRegistry::placeInArena(ShapeHandle handle, const MappedMesh &mesh)
+{
+    const MeshFileHeader &header = mesh.getHeader();
+    placeInArena(handle, static_cast<const GLfloat *>(mesh.getVertexData()), header.vertexCount * 6,
+                 static_cast<const GLuint *>(mesh.getIndexData()), header.indexCount);
+}
+
+// The cache statistics of a cooked mesh. shapecook already optimized it so there is no before.
+static MeshOptimizationReport analyzeMesh(const MappedMesh &mesh)
+{
+    const MeshFileHeader &header = mesh.getHeader();
+    MeshOptimizationReport report;
+    report.after = analyzeVertexCache(static_cast<const std::uint32_t *>(mesh.getIndexData()), header.indexCount, header.vertexCount);
+    report.before = report.after;
+    return report;
+}
+
+// Meshlets cover LOD level 0, which is the whole index blob when the file has no LODs.
+static std::vector<Meshlet> buildMeshlets(const MappedMesh &mesh)
+{
+    const MeshFileHeader &header = mesh.getHeader();
+    const std::uint32_t *indices = static_cast<const std::uint32_t *>(mesh.getIndexData());
+    std::size_t indexCount = header.indexCount;
+    if (mesh.getLodCount() > 0)
+    {
+        indices += mesh.getLods()[0].indexOffset;
+        indexCount = mesh.getLods()[0].indexCount;
+    }
+    return buildMeshlets(static_cast<const float *>(mesh.getVertexData()), header.vertexCount, indices, indexCount);
+}
+
+/*
+ * Reads, parses and optimizes the text files on a worker thread, then uploads on the render thread. Only the
+ * handle is kept across suspension points because entries can grow while the shape is loading. Generated
+ * shapes take the same path with generating in place of reading and parsing. Text shapes that were cooked
+ * before are mapped from the mesh cache instead of being parsed and optimized again.
+ */
+LoadTask ShapeRegistry::loadText(AssetPipeline &pipeline, ShapeHandle handle)
+{
+    AssetPipeline::Ticket ticket(pipeline);
+    entries[handle].loading = true;
+    std::string verticesPath = entries[handle].verticesPath;
+    std::string indicesPath = entries[handle].indicesPath;
+    std::optional<PolyhedronSettings> polyhedron = entries[handle].polyhedron;
+    float weldEpsilon = this->weldEpsilon;
+    Clock::time_point start = Clock::now();
+    std::vector<GLfloat> vertices;
+    std::vector<GLuint> indices;
+    MeshOptimizationReport optimization;
+    std::vector<LodLevel> lods;
+    std::vector<Meshlet> meshlets;
+    std::unique_ptr<MappedMesh> cached;
+    std::string error;
+
+    co_await pipeline.ResumeOnWorker();
+    try
+    {
+        Clock::time_point optimizeStart;
+        std::optional<std::uint64_t> cacheKey;
+        if (polyhedron)
+        {
+            // generating stands in for parsing, nothing is read
+            Clock::time_point generateStart = Clock::now();
+            GeneratedMesh mesh = generatePolyhedron(*polyhedron);
+            vertices = std::move(mesh.vertices);
+            indices = std::move(mesh.indices);
+            optimizeStart = Clock::now();
+            pipeline.Record(LoadStage::Parse, optimizeStart - generateStart);
+        }
+        else
+        {
+            Clock::time_point readStart = Clock::now();
+            std::string verticesText = readTextFile(verticesPath.c_str());
+            std::string indicesText = readTextFile(indicesPath.c_str());
+            cacheKey = MeshCache::makeKey(verticesText, indicesText, weldEpsilon);
+            cached = meshCache.Open(*cacheKey);
+            Clock::time_point parseStart = Clock::now();
+            pipeline.Record(LoadStage::Read, parseStart - readStart);
+
+            optimizeStart = parseStart;
+            if (!cached)
+            {
+                vertices = parseFloats(verticesText);
+                indices = parseIndices(indicesText);
+                optimizeStart = Clock::now();
+                pipeline.Record(LoadStage::Parse, optimizeStart - parseStart);
+            }
+        }
+
+        if (cached)
+        {
+            optimization = analyzeMesh(*cached);
+            meshlets = buildMeshlets(*cached);
+        }
+        else
+        {
+            optimization = Shape::optimize(vertices, indices, weldEpsilon);
+            lods = buildLodChain(vertices, indices);
+            meshlets = buildMeshlets(vertices.data(), vertices.size() / 6, indices.data(), lods[0].indexCount);
+            if (cacheKey)
+            {
+                meshCache.Store(*cacheKey, vertices, indices, lods);
+            }
+        }
+        pipeline.Record(LoadStage::Optimize, Clock::now() - optimizeStart);
+    }
+    catch (const std::exception &exception)
+    {
+        error = exception.what();
+    }
+
+    Clock::time_point queued = Clock::now();
+    if (!co_await pipeline.ResumeOnRenderThread())
+    {
+        co_return;
+    }
+    Clock::time_point uploadStart = Clock::now();
+    pipeline.Record(LoadStage::Wait, uploadStart - queued);
+    entries[handle].loading = false;
+    try
+    {
+        if (!error.empty())
+        {
+            throw std::runtime_error(error);
+        }
+        if (cached)
+        {
+            Shape shape(*cached, vertexFormat);
+            shape.setMeshlets(std::move(meshlets));
+            install(handle, shape, optimization);
+            placeInArena(handle, *cached);
+        }
+        else
+        {
+            // optimize() already checked the mesh, so it goes into the arena before the shape takes the vectors
+            placeInArena(handle, vertices.data(), vertices.size(), indices.data(), indices.size());
+            Shape shape(std::move(vertices), std::move(indices), vertexFormat);
+            shape.setLods(std::move(lods));
+            shape.setMeshlets(std::move(meshlets));
+            install(handle, shape, optimization);
+        }
+        pipeline.Record(LoadStage::Upload, Clock::now() - uploadStart);
+        pipeline.Record(LoadStage::Total, Clock::now() - start);
+    }
+    catch (const std::exception &exception)
+    {
+        std::cout << "ERROR::SHAPE::LOAD_FAILED\n" << exception.what() << std::endl;
+        entries[handle].error = exception.what();
+    }
+}
+
+/*
+ * Maps a cooked mesh on a worker thread and uploads straight from the mapping on the render thread.
+ */
+LoadTask ShapeRegistry::loadMesh(AssetPipeline &pipeline, ShapeHandle handle)
+{
+    AssetPipeline::Ticket ticket(pipeline);
+    entries[handle].loading = true;
+    std::string meshPath = entries[handle].meshPath;
+    Clock::time_point start = Clock::now();
+    std::unique_ptr<MappedMesh> mesh;
+    MeshOptimizationReport optimization;
+    std::vector<Meshlet> meshlets;
+    std::string error;
+
+    co_await pipeline.ResumeOnWorker();
+    try
+    {
+        Clock::time_point readStart = Clock::now();
+        mesh = std::make_unique<MappedMesh>(meshPath.c_str());
+        Clock::time_point optimizeStart = Clock::now();
+        pipeline.Record(LoadStage::Read, optimizeStart - readStart);
+        optimization = analyzeMesh(*mesh);
+        meshlets = buildMeshlets(*mesh);
+        pipeline.Record(LoadStage::Optimize, Clock::now() - optimizeStart);
+    }
+    catch (const std::exception &exception)
+    {
+        error = exception.what();
+    }
+
+    Clock::time_point queued = Clock::now();
+    if (!co_await pipeline.ResumeOnRenderThread())
+    {
+        co_return;
+    }
+    Clock::time_point uploadStart = Clock::now();
+    pipeline.Record(LoadStage::Wait, uploadStart - queued);
+    entries[handle].loading = false;
+    try
+    {
+        if (!error.empty())
+        {
+            throw std::runtime_error(error);
+        }
+        Shape shape(*mesh, vertexFormat);
+        shape.setMeshlets(std::move(meshlets));
+        install(handle, shape, optimization);
+        placeInArena(handle, *mesh);
+        pipeline.Record(LoadStage::Upload, Clock::now() - uploadStart);
+        pipeline.Record(LoadStage::Total, Clock::now() - start);
+    }
+    catch (const std::exception &exception)
+    {
+        std::cout << "ERROR::SHAPE::LOAD_FAILED\n" << exception.what() << std::endl;
+        entries[handle].error = exception.what();
+    }
+}
+
+/*
+ * Re-reads the shape and updates it in place. A text shape reads both files again because optimizing
+ * renumbers the vertices, so the file that didn't change no longer matches what is on the GPU. If the new
+ * data is bad the shape keeps drawing what it had before.
+ */
+LoadTask ShapeRegistry::reload(AssetPipeline &pipeline, ShapeHandle handle, std::string path, std::function<void()> onApplied)
+{
+    AssetPipeline::Ticket ticket(pipeline);
+    entries[handle].loading = true;
+    bool isMesh = path == entries[handle].meshPath;
+    std::string verticesPath = entries[handle].verticesPath;
+    std::string indicesPath = entries[handle].indicesPath;
+    float weldEpsilon = this->weldEpsilon;
+    std::vector<GLfloat> vertices;
+    std::vector<GLuint> indices;
+    std::unique_ptr<MappedMesh> mesh;
+    MeshOptimizationReport optimization;
+    std::vector<LodLevel> lods;
+    std::vector<Meshlet> meshlets;
+    std::string error;
+
+    co_await pipeline.ResumeOnWorker();
+    try
+    {
+        if (isMesh)
+        {
+            mesh = std::make_unique<MappedMesh>(path.c_str());
+            optimization = analyzeMesh(*mesh);
+            meshlets = buildMeshlets(*mesh);
+        }
+        else
+        {
+            std::string verticesText = readTextFile(verticesPath.c_str());
+            std::string indicesText = readTextFile(indicesPath.c_str());
+            std::uint64_t cacheKey = MeshCache::makeKey(verticesText, indicesText, weldEpsilon);
+            // an edit that is undone maps the old entry again
+            mesh = meshCache.Open(cacheKey);
+            if (mesh)
+            {
+                optimization = analyzeMesh(*mesh);
+                meshlets = buildMeshlets(*mesh);
+            }
+            else
+            {
+                vertices = parseFloats(verticesText);
+                indices = parseIndices(indicesText);
+                optimization = Shape::optimize(vertices, indices, weldEpsilon);
+                lods = buildLodChain(vertices, indices);
+                meshlets = buildMeshlets(vertices.data(), vertices.size() / 6, indices.data(), lods[0].indexCount);
+                meshCache.Store(cacheKey, vertices, indices, lods);
+            }
+        }
+    }
+    catch (const std::exception &exception)
+    {
+        error = exception.what();
+    }
+
+    if (!co_await pipeline.ResumeOnRenderThread())
+    {
+        co_return;
+    }
+    entries[handle].loading = false;
+    try
+    {
+        if (!error.empty())
+        {
+            throw std::runtime_error(error);
+        }
+        Shape &shape = *entries[handle].shape;
+        if (mesh)
+        {
+            shape.Update(*mesh);
+            placeInArena(handle, *mesh);
+        }
+        else
+        {
+            placeInArena(handle, vertices.data(), vertices.size(), indices.data(), indices.size());
+            shape.Update(std::move(vertices), std::move(indices));
+            shape.setLods(std::move(lods));
+        }
+        shape.setMeshlets(std::move(meshlets));
+        entries[handle].optimization = optimization;
+        entries[handle].error.clear();
+        onApplied();
+    }
+    catch (const std::exception &exception)
+    {
+        std::cout << "ERROR::SHAPE::RELOAD_FAILED\n" << path << ": " << exception.what() << std::endl;
+        entries[handle].error = exception.what();
+    }
+}
+
+// Public Methods
+ShapeHandle ShapeRegistry::Load(AssetPipeline &pipeline, const char *name, const char *verticesPath, const char *indicesPath)
+{
+    // a shape that is already in the registry is handed out again instead of being read a second time
+    for (ShapeHandle handle = 0; handle < entries.size(); handle++)
+    {
+        if (!entries[handle].polyhedron && entries[handle].verticesPath == verticesPath &&
+            entries[handle].indicesPath == indicesPath)
+        {
+            return handle;
+        }
+    }
+    ShapeHandle handle = addEntry(name, verticesPath, indicesPath, "");
+    loadText(pipeline, handle);
+    return handle;
+}
+
+ShapeHandle ShapeRegistry::LoadMesh(AssetPipeline &pipeline, const char *name, const char *meshPath)
+{
+    for (ShapeHandle handle = 0; handle < entries.size(); handle++)
+    {
+        if (!entries[handle].polyhedron && entries[handle].meshPath == meshPath)
+        {
+            return handle;
+        }
+    }
+    ShapeHandle handle = addEntry(name, "", "", meshPath);
+    loadMesh(pipeline, handle);
+    return handle;
+}
+
+ShapeHandle ShapeRegistry::LoadPolyhedron(AssetPipeline &pipeline, const char *name, const PolyhedronSettings &settings)
+{
+    for (ShapeHandle handle = 0; handle < entries.size(); handle++)
+    {
+        const std::optional<PolyhedronSettings> &polyhedron = entries[handle].polyhedron;
+        if (polyhedron && polyhedron->type == settings.type && polyhedron->frequency == settings.frequency &&
+            polyhedron->spherical == settings.spherical)
+        {
+            return handle;
+        }
+    }
+    ShapeHandle handle = addEntry(name, "", "", "");
+    entries[handle].polyhedron = settings;
+    loadText(pipeline, handle);
+    return handle;
+}
+
+std::size_t ShapeRegistry::Reload(AssetPipeline &pipeline, const std::string &path, std::function<void()> onApplied)
+{
+    std::size_t reloaded = 0;
+    for (ShapeHandle handle = 0; handle < entries.size(); handle++)
+    {
+        Entry &entry = entries[handle];
+        // generated shapes have no files to change
+        if (entry.polyhedron)
+        {
+            continue;
+        }
+        if (path != entry.verticesPath && path != entry.indicesPath && path != entry.meshPath)
+        {
+            continue;
+        }
+        // a write that lands while the shape is still loading gets picked up by that load
+        if (entry.loading)
+        {
+            continue;
+        }
+        if (entry.shape)
+        {
+            reload(pipeline, handle, path, onApplied);
+        }
+        else if (!entry.meshPath.empty())
+        {
+            // the last load failed, so there is nothing to update and the whole shape is loaded again
+            loadMesh(pipeline, handle);
+        }
+        else
+        {
+            loadText(pipeline, handle);
+        }
+        reloaded++;
+    }
+    return reloaded;
+}
+
+void ShapeRegistry::setVertexFormat(AssetPipeline &pipeline, VertexFormat format)
+{
+    if (format == vertexFormat)
+    {
+        return;
+    }
+    vertexFormat = format;
+    // each shape keeps drawing in the old format until its replacement is uploaded
+    for (ShapeHandle handle = 0; handle < entries.size(); handle++)
+    {
+        if (entries[handle].loading)
+        {
+            continue;
+        }
+        if (!entries[handle].meshPath.empty())
+        {
+            loadMesh(pipeline, handle);
+        }
+        else
+        {
+            loadText(pipeline, handle);
+        }
+    }
+}
+
+VertexFormat ShapeRegistry::getVertexFormat()
+{
+    return vertexFormat;
+}
+
+void ShapeRegistry::setWeldEpsilon(AssetPipeline &pipeline, float epsilon)
+{
+    if (epsilon == weldEpsilon)
+    {
+        return;
+    }
+    weldEpsilon = epsilon;
+    for (ShapeHandle handle = 0; handle < entries.size(); handle++)
+    {
+        if (!entries[handle].loading && entries[handle].meshPath.empty())
+        {
+            loadText(pipeline, handle);
+        }
+    }
+}
+
+float ShapeRegistry::getWeldEpsilon()
+{
+    return weldEpsilon;
+}
+
+MeshCache &ShapeRegistry::getMeshCache()
+{
+    return meshCache;
+}
+
+GeometryArena &ShapeRegistry::getArena()
+{
+    return arena;
+}
+
+void ShapeRegistry::Delete()
+{
+    for (Entry &entry : entries)
+    {
+        if (entry.shape)
+        {
+            entry.shape->Delete();
+        }
+    }
+    entries.clear();
+    entries.shrink_to_fit();
+    arena.Delete();
+}
+
+bool ShapeRegistry::isLoaded(ShapeHandle handle)
+{
+    return handle < entries.size() && entries[handle].shape.has_value();
+}
+
+Shape &ShapeRegistry::getShape(ShapeHandle handle)
+{
+    if (!isLoaded(handle))
+    {
+        throw std::out_of_range("Invalid shape handle " + std::to_string(handle));
+    }
+    return *entries[handle].shape;
+}
+
+const char *ShapeRegistry::getName(ShapeHandle handle)
+{
+    if (handle >= entries.size())
+    {
+        throw std::out_of_range("Invalid shape handle " + std::to_string(handle));
+    }
+    return entries[handle].name.c_str();
+}
+
+const std::string &ShapeRegistry::getError(ShapeHandle handle)
+{
+    if (handle >= entries.size())
+    {
+        throw std::out_of_range("Invalid shape handle " + std::to_string(handle));
+    }
+    return entries[handle].error;
+}
+
+const MeshOptimizationReport &ShapeRegistry::getOptimizationReport(ShapeHandle handle)
+{
+    if (handle >= entries.size())
+    {
+        throw std::out_of_range("Invalid shape handle " + std::to_string(handle));
+    }
+    return entries[handle].optimization;
+}
+
+ArenaHandle ShapeRegistry::getArenaHandle(ShapeHandle handle)
+{
+    if (handle >= entries.size())
+    {
+        throw std::out_of_range("Invalid shape handle " + std::to_string(handle));
+    }
+    return entries[handle].arenaHandle;
+}
+
+std::size_t ShapeRegistry::getCount()
+{
+    return entries.size();
+}
+
+ShapeRegistryStats ShapeRegistry::getStats()
+{
+    ShapeRegistryStats stats;
+    for (Entry &entry : entries)
+    {
+        if (!entry.shape)
+        {
+            if (entry.error.empty())
+            {
+                stats.loadingShapes++;
+            }
+            else
+            {
+                stats.failedShapes++;
+            }
+            continue;
+        }
+        // every shape owns one VAO plus a VBO and an EBO, shapes loaded from text also keep a CPU copy
+        stats.liveShapes++;
+        stats.liveVertexArrays++;
+        stats.liveBuffers += 2;
+        stats.gpuBytes += entry.shape->getGpuSizeInBytes();
+        stats.cpuBytes += entry.shape->getCpuSizeInBytes();
+        stats.indexBytesSaved += entry.shape->getIndicesSize() * sizeof(GLuint) - entry.shape->getIndicesSizeInBytes();
+        stats.weldBytesSaved += entry.optimization.weld.verticesRemoved * getVertexLayout(entry.shape->getVertexFormat()).stride;
+    }
+    stats.bytesResident = stats.gpuBytes + stats.cpuBytes;
+    return stats;
+}
@@ -0,0 +1,145 @@
+#include "../include/StreamRing.h"
+#include <algorithm>
+#include <cstring>
+
+StreamRing::StreamRing(GLsizeiptr regionSize)
+    : regionSize(regionSize)
+{
+    GLsizeiptr size = regionSize * REGION_COUNT;
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    if (GLAD_GL_VERSION_4_4 && glBufferStorage != nullptr)
+    {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_COPY_WRITE_BUFFER, size, nullptr, flags);
+        memory = static_cast<unsigned char *>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, size, flags));
+    }
+    if (memory == nullptr)
+    {
+        glBufferData(GL_COPY_WRITE_BUFFER, size, nullptr, GL_STREAM_DRAW);
+        staging.resize(size);
+        memory = staging.data();
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    stats.regionSize = regionSize;
+    stats.persistent = staging.empty();
+    // the first BeginFrame() moves to region 0
+    current = REGION_COUNT - 1;
+}
+
+void StreamRing::BeginFrame()
+{
+    current = (current + 1) % REGION_COUNT;
+    if (fences[current] != nullptr)
+    {
+        // the GPU is REGION_COUNT frames behind, which only happens when it is the bottleneck anyway
+        GLenum result = glClientWaitSync(fences[current], 0, 0);
+        if (result == GL_TIMEOUT_EXPIRED)
+        {
+            stats.stalls++;
+        }
+        while (result == GL_TIMEOUT_EXPIRED)
+        {
+            result = glClientWaitSync(fences[current], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+        }
+        glDeleteSync(fences[current]);
+        fences[current] = nullptr;
+    }
+    head.store(0, std::memory_order_relaxed);
+    flushed = 0;
+}
+
+StreamAllocation StreamRing::Allocate(GLsizeiptr size, GLsizeiptr alignment)
+{
+    GLintptr base = regionSize * current;
+    GLsizeiptr start = head.load(std::memory_order_relaxed);
+    GLsizeiptr end;
+    do
+    {
+        // offsets are aligned in the whole buffer, which is what the GL checks
+        GLsizeiptr aligned = (base + start + alignment - 1) / alignment * alignment - base;
+        end = aligned + size;
+        if (end > regionSize)
+        {
+            overflows.fetch_add(1, std::memory_order_relaxed);
+            return {};
+        }
+    }
+    while (!head.compare_exchange_weak(start, end, std::memory_order_acq_rel, std::memory_order_relaxed));
+
+    StreamAllocation allocation;
+    allocation.offset = base + end - size;
+    allocation.size = size;
+    allocation.data = memory + allocation.offset;
+    return allocation;
+}
+
+void StreamRing::Flush()
+{
+    GLsizeiptr end = head.load(std::memory_order_acquire);
+    if (staging.empty() || end <= flushed)
+    {
+        return;
+    }
+    GLintptr offset = regionSize * current + flushed;
+    GLsizeiptr size = end - flushed;
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    // the fence already says the region is free, so the driver doesn't need to check
+    void *range = glMapBufferRange(GL_COPY_WRITE_BUFFER, offset, size,
+                                   GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    if (range != nullptr)
+    {
+        std::memcpy(range, staging.data() + offset, size);
+        glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+    }
+    else
+    {
+        glBufferSubData(GL_COPY_WRITE_BUFFER, offset, size, staging.data() + offset);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    flushed = end;
+}
+
+void StreamRing::EndFrame()
+{
+    if (fences[current] == nullptr)
+    {
+        fences[current] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+    stats.bytesLastFrame = head.load(std::memory_order_relaxed);
+    stats.peakFrameBytes = std::max(stats.peakFrameBytes, stats.bytesLastFrame);
+}
+
+void StreamRing::Delete()
+{
+    for (GLsync &fence : fences)
+    {
+        if (fence != nullptr)
+        {
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+    if (staging.empty() && memory != nullptr)
+    {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+    glDeleteBuffers(1, &buffer);
+    buffer = 0;
+    memory = nullptr;
+    staging.clear();
+    staging.shrink_to_fit();
+}
+
+GLuint StreamRing::getBuffer()
+{
+    return buffer;
+}
+
+StreamRingStats StreamRing::getStats()
+{
+    stats.overflows = overflows.load(std::memory_order_relaxed);
+    return stats;
+}
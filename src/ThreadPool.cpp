@@ -0,0 +1,134 @@
+#include "../include/ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
+ThreadPool::ThreadPool(std::size_t threadCount)
+{
+    if (threadCount == 0)
+    {
+        threadCount = 1;
+    }
+    workers.reserve(threadCount);
+    for (std::size_t i = 0; i < threadCount; i++)
+    {
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    condition.notify_all();
+    for (std::thread &worker : workers)
+    {
+        worker.join();
+    }
+}
+
+ThreadPool &ThreadPool::getShared()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::Enqueue(std::function<void()> job)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push(std::move(job));
+    }
+    condition.notify_one();
+}
+
+void ThreadPool::ParallelFor(std::size_t count, const std::function<void(std::size_t)> &body)
+{
+    if (count == 0)
+    {
+        return;
+    }
+    if (count == 1)
+    {
+        body(0);
+        return;
+    }
+    // helpers that only get to run after every item was claimed return without touching body
+    struct State
+    {
+        const std::function<void(std::size_t)> *body;
+        std::size_t count;
+        std::atomic<std::size_t> next{0};
+        std::size_t finished = 0;
+        std::exception_ptr error;
+        std::mutex mutex;
+        std::condition_variable done;
+    };
+    auto state = std::make_shared<State>();
+    state->body = &body;
+    state->count = count;
+    auto work = [state]()
+    {
+        std::size_t index;
+        while ((index = state->next.fetch_add(1)) < state->count)
+        {
+            std::exception_ptr error;
+            try
+            {
+                (*state->body)(index);
+            }
+            catch (...)
+            {
+                error = std::current_exception();
+            }
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if (error && !state->error)
+            {
+                state->error = error;
+            }
+            if (++state->finished == state->count)
+            {
+                state->done.notify_all();
+            }
+        }
+    };
+    std::size_t helpers = std::min(count - 1, workers.size());
+    for (std::size_t i = 0; i < helpers; i++)
+    {
+        Enqueue(work);
+    }
+    work();
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->done.wait(lock, [&state]() { return state->finished == state->count; });
+    if (state->error)
+    {
+        std::rethrow_exception(state->error);
+    }
+}
+
+std::size_t ThreadPool::getThreadCount()
+{
+    return workers.size();
+}
+
+void ThreadPool::workerLoop()
+{
+    while (true)
+    {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [this]() { return stopping || !jobs.empty(); });
+            // finish whatever is queued before shutting down
+            if (jobs.empty())
+            {
+                return;
+            }
+            job = std::move(jobs.front());
+            jobs.pop();
+        }
+        job();
+    }
+}
@@ -0,0 +1,186 @@
+#include "../include/VertexFormat.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+const char *getVertexFormatName(VertexFormat format)
+{
+    switch (format)
+    {
+        case VertexFormat::Float32: return "Float32";
+        case VertexFormat::Half: return "Half";
+        case VertexFormat::Quantized: return "Quantized";
+        default: return "Unknown";
+    }
+}
+
+VertexLayout getVertexLayout(VertexFormat format)
+{
+    switch (format)
+    {
+        case VertexFormat::Half:
+            return {8 * sizeof(std::uint16_t), {3, GL_HALF_FLOAT, GL_FALSE, 0}, {3, GL_HALF_FLOAT, GL_FALSE, 4 * sizeof(std::uint16_t)}};
+        case VertexFormat::Quantized:
+            return {4 * sizeof(std::int16_t) + 4, {3, GL_SHORT, GL_TRUE, 0}, {3, GL_UNSIGNED_BYTE, GL_TRUE, 4 * sizeof(std::int16_t)}};
+        default:
+            return {6 * sizeof(GLfloat), {3, GL_FLOAT, GL_FALSE, 0}, {3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat)}};
+    }
+}
+
+std::uint16_t floatToHalf(float value)
+{
+    std::uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    std::uint32_t sign = (bits >> 16) & 0x8000u;
+    std::uint32_t exponent = (bits >> 23) & 0xFFu;
+    std::uint32_t mantissa = bits & 0x7FFFFFu;
+
+    if (exponent == 0xFFu)
+    {
+        // infinity stays infinity, NaN stays a quiet NaN
+        return static_cast<std::uint16_t>(sign | 0x7C00u | (mantissa != 0 ? 0x200u : 0u));
+    }
+    int halfExponent = static_cast<int>(exponent) - 127 + 15;
+    if (halfExponent >= 0x1F)
+    {
+        return static_cast<std::uint16_t>(sign | 0x7C00u);
+    }
+    if (halfExponent <= 0)
+    {
+        // subnormal half, or zero when it is too small
+        if (halfExponent < -10)
+        {
+            return static_cast<std::uint16_t>(sign);
+        }
+        mantissa |= 0x800000u;
+        std::uint32_t shift = static_cast<std::uint32_t>(14 - halfExponent);
+        std::uint32_t halfMantissa = mantissa >> shift;
+        std::uint32_t remainder = mantissa & ((1u << shift) - 1u);
+        std::uint32_t halfway = 1u << (shift - 1);
+        if (remainder > halfway || (remainder == halfway && (halfMantissa & 1u)))
+        {
+            halfMantissa++;
+        }
+        return static_cast<std::uint16_t>(sign | halfMantissa);
+    }
+    std::uint32_t half = sign | (static_cast<std::uint32_t>(halfExponent) << 10) | (mantissa >> 13);
+    std::uint32_t remainder = mantissa & 0x1FFFu;
+    // round to nearest even, a carry into the exponent is still the right answer
+    if (remainder > 0x1000u || (remainder == 0x1000u && (half & 1u)))
+    {
+        half++;
+    }
+    return static_cast<std::uint16_t>(half);
+}
+
+float halfToFloat(std::uint16_t value)
+{
+    std::uint32_t sign = static_cast<std::uint32_t>(value & 0x8000u) << 16;
+    std::uint32_t exponent = (value >> 10) & 0x1Fu;
+    std::uint32_t mantissa = value & 0x3FFu;
+    std::uint32_t bits;
+    if (exponent == 0)
+    {
+        float magnitude = std::ldexp(static_cast<float>(mantissa), -24);
+        return sign ? -magnitude : magnitude;
+    }
+    if (exponent == 0x1F)
+    {
+        bits = sign | 0x7F800000u | (mantissa << 13);
+    }
+    else
+    {
+        bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+    }
+    float result;
+    std::memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+static std::int16_t quantizeSnorm16(float value)
+{
+    return static_cast<std::int16_t>(std::lround(std::clamp(value, -1.0f, 1.0f) * 32767.0f));
+}
+
+static float dequantizeSnorm16(std::int16_t value)
+{
+    return std::max(value / 32767.0f, -1.0f);
+}
+
+static std::uint8_t quantizeUnorm8(float value)
+{
+    return static_cast<std::uint8_t>(std::lround(std::clamp(value, 0.0f, 1.0f) * 255.0f));
+}
+
+PackedVertices packVertices(const float *vertices, std::size_t vertexCount, VertexFormat format)
+{
+    PackedVertices packed;
+    packed.format = format;
+    VertexLayout layout = getVertexLayout(format);
+    packed.data.resize(vertexCount * layout.stride);
+
+    if (format == VertexFormat::Float32)
+    {
+        std::memcpy(packed.data.data(), vertices, packed.data.size());
+        return packed;
+    }
+
+    if (format == VertexFormat::Quantized && vertexCount > 0)
+    {
+        // positions are stored relative to the center of the bounds, scaled so the bounds fill [-1, 1]
+        for (int axis = 0; axis < 3; axis++)
+        {
+            float low = std::numeric_limits<float>::max();
+            float high = std::numeric_limits<float>::lowest();
+            for (std::size_t v = 0; v < vertexCount; v++)
+            {
+                low = std::min(low, vertices[v * 6 + axis]);
+                high = std::max(high, vertices[v * 6 + axis]);
+            }
+            packed.positionOffset[axis] = (low + high) * 0.5f;
+            // a flat axis (like the octagon's z) gets a scale of 1 so nothing divides by zero
+            packed.positionScale[axis] = (high > low) ? (high - low) * 0.5f : 1.0f;
+        }
+    }
+
+    float maxErrorSquared = 0.0f;
+    for (std::size_t v = 0; v < vertexCount; v++)
+    {
+        const float *source = vertices + v * 6;
+        std::uint8_t *destination = packed.data.data() + v * layout.stride;
+        float decoded[3];
+        if (format == VertexFormat::Half)
+        {
+            std::uint16_t halves[8] = {};
+            for (int i = 0; i < 3; i++)
+            {
+                halves[i] = floatToHalf(source[i]);
+                halves[4 + i] = floatToHalf(source[3 + i]);
+                decoded[i] = halfToFloat(halves[i]);
+            }
+            std::memcpy(destination, halves, sizeof(halves));
+        }
+        else
+        {
+            std::int16_t positions[4] = {};
+            std::uint8_t colors[4] = {};
+            for (int i = 0; i < 3; i++)
+            {
+                positions[i] = quantizeSnorm16((source[i] - packed.positionOffset[i]) / packed.positionScale[i]);
+                colors[i] = quantizeUnorm8(source[3 + i]);
+                decoded[i] = dequantizeSnorm16(positions[i]) * packed.positionScale[i] + packed.positionOffset[i];
+            }
+            std::memcpy(destination, positions, sizeof(positions));
+            std::memcpy(destination + sizeof(positions), colors, sizeof(colors));
+        }
+        float errorSquared = 0.0f;
+        for (int i = 0; i < 3; i++)
+        {
+            errorSquared += (decoded[i] - source[i]) * (decoded[i] - source[i]);
+        }
+        maxErrorSquared = std::max(maxErrorSquared, errorSquared);
+    }
+    packed.maxPositionError = std::sqrt(maxErrorSquared);
+    return packed;
+}
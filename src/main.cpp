@@ -24,6 +24,12 @@
 #include <glm/glm.hpp> // OpenGL Mathematics library (eg. matrices/mat4s, vectors/vec4s)
 #include <iostream> // Basic C++ I/O
 #include <vector> // C++ Vectors/Linked Lists
+#include <array> // fixed size arrays
+#include <chrono> // time budgets for asset uploads
+#include <cfloat> // FLT_MAX
+#include <cmath> // std::tan for the LOD selection
+#include <cstdio> // printf for the benchmark results
+#include <algorithm> // std::max for the shape row
 #include <glm/gtc/matrix_transform.hpp> // eg). contains all the different types of transformation matrices for graphics
 #include <glm/gtc/type_ptr.hpp> // to get a pointer to my matrices/vectors
 #include "../external/imgui/imgui.h"
@@ -31,26 +37,61 @@
 #include "../external/imgui/imgui_impl_opengl3.h"
 #include "../include/ShaderClass.h" // A class to easily load shader files
 #include "../include/Shape.h" // A class to create shapes that get there data from a file.
+#include "../include/ShapeRegistry.h" // Owns every shape so they only get loaded once.
+#include "../include/AssetPipeline.h" // Loads assets on worker threads and uploads them a few at a time each frame.
+#include "../include/AssetWatcher.h" // Watches the asset folders so edited files get reloaded while the demo runs.
+#include "../include/GpuTimer.h" // Measures how long the GPU spends drawing the shape.
+#include "../include/Meshlet.h" // Splits shapes into small clusters that can be culled before they are drawn.
+#include "../include/ShapeGenerator.h" // Builds the shapes in code and subdivides them into much bigger meshes.
+#include "../include/AssetPack.h" // Every asset in one file that is mapped once at startup.
+#include "../include/ProgramCache.h" // Saves linked shader programs so later runs don't compile them again.
+#include "../include/ShaderCompiler.h" // Builds shader programs without making the render loop wait for the driver.
+#include "../include/ShaderLibrary.h" // Builds a variant of a shader for each set of features it is drawn with.
+#include "../include/StreamRing.h" // A persistently mapped buffer that per frame data is written straight into.
+#include "../include/FrameUniforms.h" // One uniform buffer with the camera matrices that every shader reads.
+#include "../include/GLStateCache.h" // Skips GL state calls that wouldn't change anything.
+#include "../include/InstanceBuffer.h" // Per instance transforms and colors for drawing a shape many times in one call.
+#include "../include/InstanceBenchmark.h" // Steps the instance count up to a million and times each step.
+#include "../include/GeometryArena.h" // Every shape in one vertex and index buffer, drawn with one multi-draw.
+#include "../include/FrustumCulling.h" // Skips the instances outside the view with SIMD sphere tests.
+#include <string> // names for the generated shapes
 
 #define ASSET_PATH "/usr/local/share/GraphicsDemo/assets"
 
 /* PROTYPES */
 void frameBufferSizeCallback(GLFWwindow *window, int width, int height);
-void generateMatrices(const unsigned int WINDOW_WIDTH, const unsigned int WINDOW_HEIGHT, Shader shaderProgram);
+void generateMatrices(const unsigned int WINDOW_WIDTH, const unsigned int WINDOW_HEIGHT, Shader &shaderProgram, FrameUniformBuffer &frameUniforms, const glm::mat4 &positionTransform, bool instanced);
 void initializeGUI(GLFWwindow *window);
 void createGUIFrame();
 void createGUI();
 void deleteGUI();
 void resetParameters();
-void constructShapes(const std::vector<Shape>&);
+void bakeShapeRenderState();
+void loadShapes();
+void loadShape(const char *name, const char *meshPath, const char *verticesPath, const char *indicesPath);
+void createLoadingGUI();
+void createVertexFormatGUI();
+void createGeneratorGUI();
+void createInstancingGUI();
+void recordInstanceBenchmark(double frameMilliseconds);
+void updateInstances(InstanceBuffer &instanceBuffer, StreamRing &streamRing, Shape &shape);
+void createArenaGUI();
+void drawAllShapes(InstanceBuffer &placements, StreamRing &streamRing);
+void processAssetChanges(AssetWatcher &assetWatcher, ShaderLibrary &shaderLibrary);
+void recordReloadLatencies();
 void processInput(GLFWwindow *window);
 void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
 
 /* BASIC CONSTANTS */
 static const int SUCCESS = 0;
 static const int FAILURE = -1;
+// How long each frame is allowed to spend uploading freshly loaded assets to the GPU
+static const std::chrono::microseconds UPLOAD_BUDGET(2000);
+// How many bytes of uniforms, instances and draw commands each frame can stream to the GPU
+static const GLsizeiptr STREAM_REGION_SIZE = 4 << 20;
 
 // shader paths
+static const char *assetPackPath = ASSET_PATH "/assets.pack";
 static const char *vertexShaderPath = ASSET_PATH "/shaders/default.vert";
 static const char *fragmentShaderPath = ASSET_PATH "/shaders/default.frag";
 // vertices/indices paths
@@ -66,6 +107,13 @@ static const char *icosahedronVerticesPath = ASSET_PATH "/data/Vertices/icosahed
 static const char *icosahedronIndicesPath = ASSET_PATH "/data/Indices/icosahedron.txt";
 static const char *dodecahedronVerticesPath = ASSET_PATH "/data/Vertices/dodecahedron.txt";
 static const char *dodecahedronIndicesPath = ASSET_PATH "/data/Indices/dodecahedron.txt";
+// cooked binary meshes made by shapecook, these are used instead of the text files when they exist
+static const char *octagonMeshPath = ASSET_PATH "/data/Meshes/octagon.mesh";
+static const char *pyramidMeshPath = ASSET_PATH "/data/Meshes/pyramid.mesh";
+static const char *cubeMeshPath = ASSET_PATH "/data/Meshes/cube.mesh";
+static const char *octahedronMeshPath = ASSET_PATH "/data/Meshes/octahedron.mesh";
+static const char *icosahedronMeshPath = ASSET_PATH "/data/Meshes/icosahedron.mesh";
+static const char *dodecahedronMeshPath = ASSET_PATH "/data/Meshes/dodecahedron.mesh";
 
 /* Parameters */
 static float rotateX = 0.0f;
@@ -76,18 +124,74 @@ static glm::vec3 translation = glm::vec3(0.0f, 0.0f, 0.0f);
 static glm::vec3 scale = glm::vec3(0.7f, 0.7f, 0.7f);
 static glm::vec3 cameraPosition = glm::vec3(0.0f, 0.0f, -2.2f);
 
-// A list of shapes. C++ is wierd, and it uses vectors as the name of its version of a list data structure.
-// "vec's" and "mat's" are the names of the actual mathematical matrices included in the OpenGL Mathematics Library.
-static std::vector<Shape> shapes;
-// The index of the shape that is currently being drawn to the screen.
-static int currentShapeIndex = 0;
+// Every shape is loaded into the registry once at startup and looked up by its handle after that.
+static ShapeRegistry shapeRegistry;
+// Reads and parses assets on worker threads, the GPU upload happens on this thread inside the frame budget.
+static AssetPipeline assetPipeline;
+// Hot reloads that have reached the GPU but not the screen yet, and how long it took from write to frame.
+static std::vector<std::chrono::steady_clock::time_point> appliedReloads;
+// shader reloads that are still building, they count as applied once the compiler has nothing left to build
+static std::vector<std::chrono::steady_clock::time_point> buildingShaderReloads;
+static LatencyHistogram reloadLatency;
+static double lastReloadMilliseconds = 0.0;
+// How long the shader program took to build the last time, and whether the program cache had it.
+static double shaderBuildMilliseconds = 0.0;
+static bool shaderFromProgramCache = false;
+// Whether the driver compiles shaders on its own threads, and how many programs it is still building.
+static bool parallelShaderCompile = false;
+static std::size_t shadersBuilding = 0;
+// How many shader variants have been asked for and how many programs they needed.
+static ShaderLibraryStats shaderVariantStats;
+// The model matrix uniform of the shader variant it was looked up on, it is only looked up again when that changes.
+static Shader *matrixShader = nullptr;
+static Uniform<glm::mat4> modelMatrixUniform;
+static Uniform<glm::mat4> positionTransformUniform;
+// uniform uploads in the last frame, and how many were skipped because the program already had the value
+static UniformUploadStats uniformUploads;
+// GL state calls in the last frame, and how many of them were dropped because nothing would have changed
+static GLStateStats glStateCalls;
+// GPU time spent drawing the current shape, used to compare the vertex formats
+static double shapeDrawMicroseconds = 0.0;
+// The handle of the shape that is currently being drawn to the screen.
+static ShapeHandle currentShapeIndex = 0;
 // I multiply this by my degrees of rotation according to the windows time when the shape is auto rotating so it spins faster every second.
 static float rotationSpeed = 1.5f;
 // These are some booleans I have set to determine the default state of certain parameters in the program.
 static bool autoRotate = false;
 static bool isWireframe = false;
 static bool faceCulling = true;
+// Skip meshlets outside the frustum, and facing away from the camera when face culling is on.
+static bool meshletCulling = true;
+// Draw a simpler LOD when the shape is too small on screen for the detail to show.
+static bool autoLod = true;
+// The view frustum in the current shape's own space, made by generateMatrices for meshlet culling.
+static MeshletFrustum shapeFrustum;
+// What the Generate button builds, a frequency of 1 gives the same shape as the files.
+static PolyhedronSettings generatorSettings;
 static bool antialiasing = true;
+static LightingModel lightingModel = LightingModel::Unlit;
+// The state the shape is drawn with, baked again only when one of the settings above changes.
+static RenderState shapeRenderState;
+// Draw a cube of instances of the current shape in one call instead of the shape once.
+static bool drawInstances = false;
+static int instanceCount = 10000;
+static InstanceBenchmark instanceBenchmark;
+// CPU time spent issuing the last instanced draw
+static double instanceSubmitMicroseconds = 0.0;
+// every instance on the CPU, only the visible ones are sent to the GPU while culling is on
+static std::vector<InstanceData> instanceField;
+static std::vector<InstanceData> visibleInstances;
+static bool instanceFieldUploaded = false;
+static bool instanceCulling = true;
+static FrustumCuller instanceCuller;
+static BoundingSpheres instanceBounds;
+// the shape radius the bounds were made for, they are made again when the shape changes
+static float instanceBoundsRadius = -1.0f;
+static CullingStats instanceCullingStats;
+// every loaded shape side by side from the geometry arena, in one draw call
+static bool drawShapeRow = false;
+static GeometryArenaStats arenaStats;
+static StreamRingStats streamStats;
 
 int main()
 {
@@ -136,17 +240,105 @@ int main()
       std::cout << "Failed to initialize GLAD" << std::endl;
       return FAILURE;
    }
-   // Create the shader program given the glsl and fragment shader files
-   Shader shaderProgram(vertexShaderPath, fragmentShaderPath);
+   // map the asset pack so the shaders and shapes below don't open their files one at a time
+   if (!AssetPackMount::getShared().Mount(assetPackPath, ASSET_PATH))
+   {
+      std::cout << "No asset pack at " << assetPackPath << ", reading the loose asset files" << std::endl;
+   }
+   // every program reads the view and projection from the one frame uniform buffer
+   Shader::SetBlockBinding(FRAME_UNIFORM_BLOCK, FRAME_UNIFORM_BINDING);
+   // uniforms, instances and draw commands that change every frame are written into this
+   StreamRing streamRing(STREAM_REGION_SIZE);
+   FrameUniformBuffer frameUniforms(streamRing);
+   // builds the shader programs in the background, anything drawn before they are ready uses a flat grey fallback
+   ShaderCompiler shaderCompiler((GLADloadproc)glfwGetProcAddress);
+   // every variant of the shader program is made from these two files and the files they include
+   ShaderLibrary shaderLibrary(shaderCompiler);
+   ShaderProgramId defaultProgram = shaderLibrary.Register("default", vertexShaderPath, fragmentShaderPath);
+   // start building the variants the GUI can switch between so switching doesn't show the fallback
+   for (int variant = 0; variant < 2 * 2 * 2 * static_cast<int>(LightingModel::Count); variant++)
+   {
+      ShaderFeatures features;
+      features.wireframe = variant & 1;
+      features.instancing = variant & 2;
+      features.quantizedPositions = variant & 4;
+      features.lighting = static_cast<LightingModel>(variant / 8);
+      // without instancing the position transform is part of the model matrix, so there is no quantized variant
+      if (features.quantizedPositions && !features.instancing)
+      {
+         continue;
+      }
+      shaderLibrary.getShader(defaultProgram, features);
+   }
+   // per instance transforms and colors, made again whenever the instance count changes
+   InstanceBuffer instanceBuffer;
+   // where each shape goes when they are all drawn together, one instance per shape
+   InstanceBuffer shapeRowPlacements;
+   // start loading every shape, they show up as they finish so the first frame isn't held up
+   loadShapes();
+   // watch the asset folders so edited meshes and shaders get reloaded without restarting
+   AssetWatcher assetWatcher({ASSET_PATH "/data/Vertices", ASSET_PATH "/data/Indices", ASSET_PATH "/data/Meshes",
+                              ASSET_PATH "/shaders"});
+   // times the shape draw on the GPU
+   GpuTimer shapeDrawTimer;
    // initialize the GUI
    initializeGUI(window);
+   bakeShapeRenderState();
+   std::chrono::steady_clock::time_point lastFrame = std::chrono::steady_clock::now();
 
    while(!glfwWindowShouldClose(window))
    {
-      // fill the shapes vector with all my shapes
-      constructShapes(shapes);
-      // generate the matrices and send them to the vertex shader
-      generateMatrices(WINDOW_WIDTH, WINDOW_HEIGHT, shaderProgram);
+      std::chrono::steady_clock::time_point frameStart = std::chrono::steady_clock::now();
+      double frameMilliseconds = std::chrono::duration<double, std::milli>(frameStart - lastFrame).count();
+      lastFrame = frameStart;
+      // waits only if the GPU is still reading the region this frame writes into
+      streamRing.BeginFrame();
+      // start reloading anything that was edited and upload whatever finished loading since the last frame
+      processAssetChanges(assetWatcher, shaderLibrary);
+      // switch to the real shader programs on the frame they finish building
+      shaderCompiler.Poll();
+      parallelShaderCompile = shaderCompiler.isParallel();
+      shadersBuilding = shaderCompiler.getPendingCount();
+      shaderLibrary.Update([](const std::string &name, Shader &shader)
+      {
+         // compiling is the cold start, loading the saved program binary the warm one
+         std::cout << "Shader " << name << " built in " << shader.getBuildMilliseconds() << " ms"
+                   << (shader.isFromProgramCache() ? " from the program cache" : " from source") << std::endl;
+      });
+      if (shadersBuilding == 0)
+      {
+         appliedReloads.insert(appliedReloads.end(), buildingShaderReloads.begin(), buildingShaderReloads.end());
+         buildingShaderReloads.clear();
+      }
+      assetPipeline.Pump(UPLOAD_BUDGET);
+      // quantized shapes store their positions relative to their bounds, this scales them back to their real size
+      glm::mat4 positionTransform = glm::mat4(1.0f);
+      // the shader variant is picked by how the shape is drawn, so the shaders never branch on these settings
+      ShaderFeatures shaderFeatures;
+      shaderFeatures.wireframe = isWireframe;
+      shaderFeatures.lighting = lightingModel;
+      // the benchmark draws instances whatever the GUI says
+      bool instanced = drawInstances || instanceBenchmark.isRunning();
+      std::size_t instancesWanted = instanceBenchmark.isRunning() ? instanceBenchmark.getInstanceCount() : instanceCount;
+      if (instanced && instanceField.size() != instancesWanted)
+      {
+         instanceField = makeInstanceField(instancesWanted);
+         instanceFieldUploaded = false;
+      }
+      // the shape row is placed by instance attributes too, and the arena only holds Float32 vertices
+      bool shapeRow = drawShapeRow && !instanceBenchmark.isRunning();
+      shaderFeatures.instancing = instanced || shapeRow;
+      if (shapeRegistry.isLoaded(currentShapeIndex) && !shapeRow)
+      {
+         Shape &shape = shapeRegistry.getShape(currentShapeIndex);
+         positionTransform = shape.getPositionTransform();
+         // only the instanced shader applies the position transform, otherwise it is folded into the model matrix
+         shaderFeatures.quantizedPositions = shaderFeatures.instancing && shape.getVertexFormat() == VertexFormat::Quantized;
+      }
+      Shader &shaderProgram = shaderLibrary.getShader(defaultProgram, shaderFeatures);
+      shaderBuildMilliseconds = shaderProgram.getBuildMilliseconds();
+      shaderFromProgramCache = shaderProgram.isFromProgramCache();
+      shaderVariantStats = shaderLibrary.getStats();
       // process any keyboard input
       processInput(window);
       // create the frame for the GUI
@@ -154,54 +346,123 @@ int main()
 
       // clear the window color every frame
       glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
-      // enable depth testing
-      glEnable(GL_DEPTH_TEST);
+      // fill mode, culling, multisampling and depth testing for the shape, only what changed is set
+      GLStateCache::getShared().Apply(shapeRenderState);
       // clear the color and depth buffers before each render iteration
       glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
       // activate the shader program
       shaderProgram.Activate();
+      // generate the matrices and send them to the vertex shader, the uniforms go to the active program
+      generateMatrices(WINDOW_WIDTH, WINDOW_HEIGHT, shaderProgram, frameUniforms, positionTransform, instanced || shapeRow);
+      if (shapeRow)
+      {
+         shapeDrawTimer.Begin();
+         drawAllShapes(shapeRowPlacements, streamRing);
+         shapeDrawTimer.End();
+         shapeDrawMicroseconds = shapeDrawTimer.getMicroseconds();
+      }
       // draw the whichever shape is at the currently selected index
-      shapes[currentShapeIndex].Draw();
+      else if (shapeRegistry.isLoaded(currentShapeIndex))
+      {
+         Shape &shape = shapeRegistry.getShape(currentShapeIndex);
+         if (autoLod)
+         {
+            // how many pixels tall one unit is at a distance of one
+            float pixelsPerUnit = WINDOW_HEIGHT / (2.0f * std::tan(glm::radians(fov) / 2.0f));
+            if (instanced)
+            {
+               // every instance is scaled down by the same amount, so the LOD is picked as if it were the shape
+               pixelsPerUnit *= getInstanceFieldScale(instanceField.size());
+            }
+            shape.SelectLod(shapeFrustum.cameraPosition, pixelsPerUnit);
+         }
+         else
+         {
+            shape.setLod(0);
+         }
+         shapeDrawTimer.Begin();
+         if (instanced)
+         {
+            updateInstances(instanceBuffer, streamRing, shape);
+            std::chrono::steady_clock::time_point submitStart = std::chrono::steady_clock::now();
+            shape.DrawInstanced(instanceBuffer);
+            instanceSubmitMicroseconds = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - submitStart).count();
+         }
+         else if (meshletCulling)
+         {
+            shape.DrawMeshlets(shapeFrustum, faceCulling);
+         }
+         else
+         {
+            shape.Draw();
+         }
+         shapeDrawTimer.End();
+         shapeDrawMicroseconds = shapeDrawTimer.getMicroseconds();
+         recordInstanceBenchmark(frameMilliseconds);
+      }
+      // the uniform counts for the GUI cover everything drawn this frame
+      uniformUploads = Shader::getUniformStats();
+      Shader::resetUniformStats();
+      glStateCalls = GLStateCache::getShared().getStats();
+      GLStateCache::getShared().resetStats();
+      arenaStats = shapeRegistry.getArena().getStats();
+      streamStats = streamRing.getStats();
       // create the GUI
       createGUI();
 
+      // this frame's region of the stream can be written again once the GPU is past this point
+      streamRing.EndFrame();
       glfwSwapBuffers(window);
+      recordReloadLatencies();
       glfwPollEvents();
    }
    deleteGUI();
-   // delete the shader program
-   shaderProgram.Delete();
-   // delete all the shapes
-   for (int i = 0; i < shapes.size(); i++)
-   {
-      shapes[i].Delete();
-   }
+   // delete the shader programs
+   shaderLibrary.Delete();
+   shaderCompiler.Delete();
+   streamRing.Delete();
+   // stop anything that is still loading and delete all the shapes
+   assetPipeline.Shutdown();
+   shapeRegistry.Delete();
+   shapeDrawTimer.Delete();
+   instanceBuffer.Delete();
+   shapeRowPlacements.Delete();
+   AssetPackMount::getShared().Unmount();
    // terminate the window
    glfwTerminate();
    return SUCCESS;
 }
 
-/* Fills a vector with shape data from a file to be constructed. An improvement would be to put this in an array but
- * for now it is fine.
+/* Starts loading every shape from its files into the registry. This only runs once at startup, the render
+ * loop just looks the shapes up by their handle.
  */
-void constructShapes(const std::vector<Shape>&)
+void loadShapes()
 {
-   // reserve space for 6 shapes
-   shapes.reserve(6);
-   // add the shapes to the vector
-   shapes.emplace_back(octagonVerticesPath,octagonIndicesPath);
-   shapes.emplace_back(cubeVerticesPath, cubeIndicesPath);
-   shapes.emplace_back(pyramidVerticesPath, pyramidIndicesPath);
-   shapes.emplace_back(octahedronVerticesPath, octahedronIndicesPath);
-   shapes.emplace_back(icosahedronVerticesPath, icosahedronIndicesPath);
-   shapes.emplace_back(dodecahedronVerticesPath,dodecahedronIndicesPath);
+   loadShape("Octagon", octagonMeshPath, octagonVerticesPath, octagonIndicesPath);
+   loadShape("Cube", cubeMeshPath, cubeVerticesPath, cubeIndicesPath);
+   loadShape("Pyramid", pyramidMeshPath, pyramidVerticesPath, pyramidIndicesPath);
+   loadShape("Octahedron", octahedronMeshPath, octahedronVerticesPath, octahedronIndicesPath);
+   loadShape("Icosahedron", icosahedronMeshPath, icosahedronVerticesPath, icosahedronIndicesPath);
+   loadShape("Dodecahedron", dodecahedronMeshPath, dodecahedronVerticesPath, dodecahedronIndicesPath);
+}
+/* Loads a shape from its cooked binary mesh when it has one, otherwise from the text files */
+void loadShape(const char *name, const char *meshPath, const char *verticesPath, const char *indicesPath)
+{
+   if (AssetPackMount::getShared().exists(meshPath))
+   {
+      shapeRegistry.LoadMesh(assetPipeline, name, meshPath);
+   }
+   else
+   {
+      shapeRegistry.Load(assetPipeline, name, verticesPath, indicesPath);
+   }
 }
 /*
  * A function that I use to create my model, view, and projection matrix
  * before sending the data to the vertex shader.
  */
-void generateMatrices(const unsigned int WINDOW_WIDTH, const unsigned int WINDOW_HEIGHT, Shader shaderProgram)
+void generateMatrices(const unsigned int WINDOW_WIDTH, const unsigned int WINDOW_HEIGHT, Shader &shaderProgram, FrameUniformBuffer &frameUniforms, const glm::mat4 &positionTransform, bool instanced)
 {
    // the model matrix.. which is a combination of scale, translation, and rotation matrices
    glm::mat4 modelMatrix = glm::mat4(1.0f);
@@ -225,13 +486,39 @@ void generateMatrices(const unsigned int WINDOW_WIDTH, const unsigned int WINDOW
    glm::mat4 projectionMatrix = glm::mat4(1.0);
    projectionMatrix = glm::perspective(glm::radians(fov), (GLfloat)WINDOW_WIDTH/(GLfloat)WINDOW_HEIGHT, 0.1f, 100.0f);
 
-   // Get the locations of each uniform and send them to the vertex shader
-   int modelLocation = glGetUniformLocation(shaderProgram.ID, "modelMatrix");
-   glUniformMatrix4fv(modelLocation, 1, GL_FALSE, glm::value_ptr(modelMatrix));
-   int viewLocation = glGetUniformLocation(shaderProgram.ID, "viewMatrix");
-   glUniformMatrix4fv(viewLocation, 1, GL_FALSE,glm::value_ptr(viewMatrix));
-   int projectionLocation = glGetUniformLocation(shaderProgram.ID, "projectionMatrix");
-   glUniformMatrix4fv(projectionLocation, 1, GL_FALSE,glm::value_ptr(projectionMatrix));
+   // meshlet bounds are in the shape's file space, so the frustum and camera are moved into that space
+   glm::mat4 modelViewProjection = projectionMatrix * viewMatrix * modelMatrix;
+   glm::vec4 camera = glm::inverse(viewMatrix * modelMatrix) * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+   float cameraInModel[3] = {camera.x / camera.w, camera.y / camera.w, camera.z / camera.w};
+   shapeFrustum = makeMeshletFrustum(glm::value_ptr(modelViewProjection), cameraInModel);
+
+   // dequantize the positions as part of the model matrix so the vertex shader does it for free, instances
+   // are placed between the two so the instancing variant does it itself
+   if (!instanced)
+   {
+      modelMatrix = modelMatrix * positionTransform;
+   }
+
+   // the camera goes into the frame uniform buffer once for every program, premultiplied so the vertex shader
+   // doesn't multiply the matrices together for every vertex
+   FrameUniforms frame = {};
+   frame.viewMatrix = viewMatrix;
+   frame.projectionMatrix = projectionMatrix;
+   frame.viewProjectionMatrix = projectionMatrix * viewMatrix;
+   frame.viewport = glm::vec4(0.0f, 0.0f, (GLfloat)WINDOW_WIDTH, (GLfloat)WINDOW_HEIGHT);
+   frame.time = (float)glfwGetTime();
+   frameUniforms.Update(frame);
+
+   // the model matrix is sent to the shader, but not again if it hasn't changed since the last frame
+   if (matrixShader != &shaderProgram)
+   {
+      matrixShader = &shaderProgram;
+      modelMatrixUniform = shaderProgram.getUniform<glm::mat4>("modelMatrix");
+      positionTransformUniform = shaderProgram.getUniform<glm::mat4>("positionTransform");
+   }
+   shaderProgram.Set(modelMatrixUniform, modelMatrix);
+   // only the instanced quantized variant has it, for every other one this does nothing
+   shaderProgram.Set(positionTransformUniform, positionTransform);
 }
 
 /*
@@ -265,7 +552,7 @@ void createGUI() {
 
    if (ImGui::Button("Swap Shapes"))
    {
-      currentShapeIndex = (currentShapeIndex + 1) % shapes.size();
+      currentShapeIndex = (currentShapeIndex + 1) % shapeRegistry.getCount();
    }
    ImGui::SameLine();
    ImGui::SameLine();
@@ -275,32 +562,27 @@ void createGUI() {
    }
    ImGui::Checkbox("Auto Rotate", &autoRotate);
    ImGui::SameLine();
-   ImGui::Checkbox("Wire Frame", &isWireframe);
-   if (isWireframe)
+   if (ImGui::Checkbox("Wire Frame", &isWireframe))
    {
-      glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+      bakeShapeRenderState();
    }
-   else
+   int lighting = static_cast<int>(lightingModel);
+   const char *lightingNames[] = {getLightingModelName(LightingModel::Unlit), getLightingModelName(LightingModel::Lambert)};
+   if (ImGui::Combo("Lighting", &lighting, lightingNames, static_cast<int>(LightingModel::Count)))
    {
-      glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+      lightingModel = static_cast<LightingModel>(lighting);
    }
-   ImGui::Checkbox("Face Culling", &faceCulling);
-   if (faceCulling)
-   {
-      glEnable(GL_CULL_FACE);
-   } else
+   if (ImGui::Checkbox("Face Culling", &faceCulling))
    {
-      glDisable(GL_CULL_FACE);
+      bakeShapeRenderState();
    }
    ImGui::SameLine();
-   ImGui::Checkbox("Anti-Aliasing",&antialiasing);
-   if (antialiasing)
-   {
-      glEnable(GL_MULTISAMPLE);
-   }
-   else
+   ImGui::Checkbox("Meshlet Culling", &meshletCulling);
+   ImGui::SameLine();
+   ImGui::Checkbox("Auto LOD", &autoLod);
+   if (ImGui::Checkbox("Anti-Aliasing",&antialiasing))
    {
-      glDisable(GL_MULTISAMPLE);
+      bakeShapeRenderState();
    }
 
    ImGui::Text("\nModel Matrix Parameters:");
@@ -324,11 +606,370 @@ void createGUI() {
    ImGui::SliderFloat3("Camera Position", &cameraPosition.x,-10.0f,10.0f);
    ImGui::Text("\nProjection Matrix Parameters:");
    ImGui::SliderFloat("FOV",&fov,0.0f,180.0f);
+
+   // memory counters for the shapes, these should stay flat no matter how long the demo runs
+   ShapeRegistryStats stats = shapeRegistry.getStats();
+   if (shapeRegistry.isLoaded(currentShapeIndex))
+   {
+      ImGui::Text("\nShape: %s", shapeRegistry.getName(currentShapeIndex));
+   }
+   else if (!shapeRegistry.getError(currentShapeIndex).empty())
+   {
+      ImGui::Text("\nShape: %s (failed to load)", shapeRegistry.getName(currentShapeIndex));
+   }
+   else
+   {
+      ImGui::Text("\nShape: %s (loading...)", shapeRegistry.getName(currentShapeIndex));
+   }
+   ImGui::Text("Live shapes: %zu  GL buffers: %zu  VAOs: %zu", stats.liveShapes, stats.liveBuffers, stats.liveVertexArrays);
+   ImGui::Text("Resident: %.1f KB (GPU %.1f KB, CPU %.1f KB)", stats.bytesResident / 1024.0, stats.gpuBytes / 1024.0, stats.cpuBytes / 1024.0);
+   ImGui::Text("Saved by narrowing indices: %.1f KB", stats.indexBytesSaved / 1024.0);
+   ImGui::Text("Saved by welding vertices: %.1f KB", stats.weldBytesSaved / 1024.0);
+   if (shapeRegistry.isLoaded(currentShapeIndex))
+   {
+      Shape &shape = shapeRegistry.getShape(currentShapeIndex);
+      ImGui::Text("Indices: %lld %s (%lld bytes)", static_cast<long long>(shape.getIndicesSize()),
+                  getIndexTypeName(shape.getIndexType()), static_cast<long long>(shape.getIndicesSizeInBytes()));
+      // misses in a 16 entry FIFO cache, per triangle (ACMR) and per vertex (ATVR)
+      const MeshOptimizationReport &optimization = shapeRegistry.getOptimizationReport(currentShapeIndex);
+      ImGui::Text("Welded: %zu vertices (%zu bytes of float data)", optimization.weld.verticesRemoved, optimization.weld.bytesRemoved);
+      ImGui::Text("LOD: %zu of %zu (%lld triangles, error %.4f)", shape.getLod(), shape.getLodCount() - 1,
+                  static_cast<long long>(shape.getLodIndexCount() / 3), shape.getLodError());
+      if (meshletCulling && shape.getMeshletCount() > 0)
+      {
+         ImGui::Text("Meshlets culled: %zu / %zu (%.1f%%)", shape.getCulledMeshletCount(), shape.getMeshletCount(),
+                     100.0 * shape.getCulledMeshletCount() / shape.getMeshletCount());
+      }
+      ImGui::Text("ACMR: %.3f -> %.3f  ATVR: %.3f -> %.3f", optimization.before.acmr, optimization.after.acmr,
+                  optimization.before.atvr, optimization.after.atvr);
+   }
+   createVertexFormatGUI();
+   createGeneratorGUI();
+   createInstancingGUI();
+   createArenaGUI();
+   createLoadingGUI();
    ImGui::End();
 
    ImGui::Render();
    ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 }
+/*
+ * Reloads only the assets that changed on disk. Shapes are re-read on the asset pipeline, shaders are
+ * handed to the shader compiler and switched to once they are built.
+ */
+void processAssetChanges(AssetWatcher &assetWatcher, ShaderLibrary &shaderLibrary)
+{
+   for (const AssetChange &change : assetWatcher.Poll())
+   {
+      std::chrono::steady_clock::time_point detected = change.detected;
+      // the pack still has the old contents, so the edited file is read from the disk from now on
+      AssetPackMount::getShared().Override(change.path);
+      // every variant that read the file is rebuilt, including the ones that only #include it
+      if (shaderLibrary.Reload(change.path) > 0)
+      {
+         buildingShaderReloads.push_back(detected);
+         continue;
+      }
+      shapeRegistry.Reload(assetPipeline, change.path, [detected]() { appliedReloads.push_back(detected); });
+   }
+}
+/*
+ * Called right after the buffers are swapped, so any reload that was applied this frame is now on screen
+ */
+void recordReloadLatencies()
+{
+   for (std::chrono::steady_clock::time_point detected : appliedReloads)
+   {
+      std::chrono::steady_clock::duration latency = std::chrono::steady_clock::now() - detected;
+      reloadLatency.Record(latency);
+      lastReloadMilliseconds = std::chrono::duration<double, std::milli>(latency).count();
+   }
+   appliedReloads.clear();
+}
+/*
+ * Lets the vertex format be switched at runtime and shows what it costs in memory, accuracy and GPU time
+ */
+void createVertexFormatGUI()
+{
+   if (!ImGui::CollapsingHeader("Vertex Format"))
+   {
+      return;
+   }
+   int format = static_cast<int>(shapeRegistry.getVertexFormat());
+   const char *names[] = {getVertexFormatName(VertexFormat::Float32), getVertexFormatName(VertexFormat::Half),
+                          getVertexFormatName(VertexFormat::Quantized)};
+   if (ImGui::Combo("Format", &format, names, static_cast<int>(VertexFormat::Count)))
+   {
+      shapeRegistry.setVertexFormat(assetPipeline, static_cast<VertexFormat>(format));
+   }
+   if (shapeRegistry.isLoaded(currentShapeIndex))
+   {
+      Shape &shape = shapeRegistry.getShape(currentShapeIndex);
+      VertexLayout layout = getVertexLayout(shape.getVertexFormat());
+      ImGui::Text("%s: %d bytes per vertex, %lld bytes of vertices", getVertexFormatName(shape.getVertexFormat()),
+                  layout.stride, static_cast<long long>(shape.getVerticesSizeInBytes()));
+      ImGui::Text("Max position error: %g", shape.getMaxPositionError());
+   }
+   ImGui::Text("Shape draw: %.1f us GPU, frame %.2f ms", shapeDrawMicroseconds, 1000.0f / ImGui::GetIO().Framerate);
+   ImGui::Text("Uniforms: %zu uploaded  %zu skipped (unchanged) this frame", uniformUploads.uploads, uniformUploads.skipped);
+   ImGui::Text("GL state: %zu calls  %zu filtered (no change) this frame", glStateCalls.submitted, glStateCalls.filtered);
+   ImGui::Text("Stream: %.1f KB last frame  %.1f KB peak of %.0f KB  %zu stalls  %zu overflows (%s)",
+               streamStats.bytesLastFrame / 1024.0, streamStats.peakFrameBytes / 1024.0, streamStats.regionSize / 1024.0,
+               streamStats.stalls, streamStats.overflows, streamStats.persistent ? "persistent" : "copied");
+}
+/*
+ * Draws the current shape many times with one instanced draw, and benchmarks it from 1 to 1M instances
+ */
+void createInstancingGUI()
+{
+   if (!ImGui::CollapsingHeader("Instancing"))
+   {
+      return;
+   }
+   ImGui::Checkbox("Draw Instances", &drawInstances);
+   ImGui::SliderInt("Instances", &instanceCount, 1, 1000000, "%d", ImGuiSliderFlags_Logarithmic);
+   ImGui::Text("Instanced draw: %.1f us CPU submit, %.1f us GPU", instanceSubmitMicroseconds, shapeDrawMicroseconds);
+   ImGui::Checkbox("Frustum Culling", &instanceCulling);
+   int isa = static_cast<int>(instanceCuller.getIsa());
+   const char *isaNames[static_cast<int>(CullingIsa::Count)];
+   for (int index = 0; index < static_cast<int>(CullingIsa::Count); index++)
+   {
+      isaNames[index] = getCullingIsaName(static_cast<CullingIsa>(index));
+   }
+   // an instruction set the CPU doesn't have falls back to the next one down
+   if (ImGui::Combo("Culling ISA", &isa, isaNames, static_cast<int>(CullingIsa::Count)))
+   {
+      instanceCuller.setIsa(static_cast<CullingIsa>(isa));
+   }
+   if (instanceCulling)
+   {
+      ImGui::Text("Culling: %zu visible  %zu culled  %.1f us (%.0f us per 1M, %s, %zu threads)",
+                  instanceCullingStats.visible, instanceCullingStats.culled, instanceCullingStats.microseconds,
+                  instanceCullingStats.microsecondsPerMillion, getCullingIsaName(instanceCullingStats.isa),
+                  instanceCullingStats.threads);
+   }
+   if (instanceBenchmark.isRunning())
+   {
+      ImGui::Text("Benchmarking %zu instances", instanceBenchmark.getInstanceCount());
+      if (ImGui::Button("Stop Benchmark"))
+      {
+         instanceBenchmark.Stop();
+         glfwSwapInterval(1);
+      }
+   }
+   else if (ImGui::Button("Run Benchmark"))
+   {
+      // without vsync the frame time is how long the frame actually took
+      glfwSwapInterval(0);
+      instanceBenchmark.Start(1000000);
+   }
+   for (const InstanceBenchmarkResult &result : instanceBenchmark.getResults())
+   {
+      ImGui::Text("%8zu instances  frame %7.2f ms  submit %7.1f us  GPU %9.1f us", result.instances,
+                  result.frameMilliseconds, result.submitMicroseconds, result.gpuMicroseconds);
+   }
+}
+/*
+ * Culls the instance field against the frustum and streams only the visible instances, or uploads the whole
+ * field once when culling is off
+ */
+void updateInstances(InstanceBuffer &instanceBuffer, StreamRing &streamRing, Shape &shape)
+{
+   if (!instanceCulling)
+   {
+      if (!instanceFieldUploaded)
+      {
+         instanceBuffer.Update(instanceField);
+         instanceFieldUploaded = true;
+      }
+      return;
+   }
+   // instances rotate about their own origin, so a sphere there that holds the shape's sphere holds every rotation
+   float shapeRadius = glm::length(shape.getBoundsCenter()) + shape.getBoundsRadius();
+   if (instanceBounds.getCount() != instanceField.size() || instanceBoundsRadius != shapeRadius)
+   {
+      instanceBounds.Resize(instanceField.size());
+      for (std::size_t i = 0; i < instanceField.size(); i++)
+      {
+         instanceBounds.Set(i, instanceField[i].position, instanceField[i].scale * shapeRadius);
+      }
+      instanceBoundsRadius = shapeRadius;
+   }
+   // the instance positions are in the shape's model space, which is the space the frustum is in
+   const std::vector<std::uint32_t> &visible = instanceCuller.Cull(instanceBounds, shapeFrustum.planes);
+   visibleInstances.resize(visible.size());
+   for (std::size_t i = 0; i < visible.size(); i++)
+   {
+      visibleInstances[i] = instanceField[visible[i]];
+   }
+   instanceBuffer.Stream(streamRing, visibleInstances);
+   instanceFieldUploaded = false;
+   instanceCullingStats = instanceCuller.getStats();
+}
+/*
+ * Hands the frame's times to the instancing benchmark, and prints the results when the last step finishes
+ */
+void recordInstanceBenchmark(double frameMilliseconds)
+{
+   if (!instanceBenchmark.isRunning())
+   {
+      return;
+   }
+   instanceBenchmark.Record(frameMilliseconds, instanceSubmitMicroseconds, shapeDrawMicroseconds);
+   if (instanceBenchmark.isRunning())
+   {
+      return;
+   }
+   glfwSwapInterval(1);
+   std::cout << "instances    frame ms   submit us      GPU us" << std::endl;
+   for (const InstanceBenchmarkResult &result : instanceBenchmark.getResults())
+   {
+      std::printf("%9zu %10.2f %11.1f %11.1f\n", result.instances, result.frameMilliseconds, result.submitMicroseconds,
+                  result.gpuMicroseconds);
+   }
+   std::fflush(stdout);
+}
+/*
+ * Draws every loaded shape in a row from the geometry arena with one draw call, each placed by its own instance
+ */
+void drawAllShapes(InstanceBuffer &placements, StreamRing &streamRing)
+{
+   GeometryArena &arena = shapeRegistry.getArena();
+   std::vector<ShapeHandle> shapes;
+   for (ShapeHandle handle = 0; handle < shapeRegistry.getCount(); handle++)
+   {
+      if (shapeRegistry.isLoaded(handle) && shapeRegistry.getArenaHandle(handle) != INVALID_ARENA_HANDLE)
+      {
+         shapes.push_back(handle);
+      }
+   }
+   // a row across the same [-1, 1] the instance field uses, each shape spinning on its own so the placements
+   // are streamed again every frame
+   std::vector<InstanceData> row(shapes.size());
+   float spacing = 2.0f / std::max<std::size_t>(shapes.size(), 1);
+   float halfAngle = 0.5f * (float)glfwGetTime() * glm::radians(50.0f) * rotationSpeed;
+   for (std::size_t i = 0; i < row.size(); i++)
+   {
+      float angle = halfAngle * (1.0f + 0.25f * i);
+      row[i] = {{-1.0f + spacing * (i + 0.5f), 0.0f, 0.0f}, 0.4f * spacing, {0.0f, std::sin(angle), 0.0f, std::cos(angle)},
+                {255, 255, 255, 255}};
+   }
+   placements.Stream(streamRing, row);
+   for (std::size_t i = 0; i < shapes.size(); i++)
+   {
+      Shape &shape = shapeRegistry.getShape(shapes[i]);
+      arena.AddDraw(shapeRegistry.getArenaHandle(shapes[i]), shape.getLodIndexOffset(), shape.getLodIndexCount(), 1, i);
+   }
+   arena.DrawQueued(placements, streamRing);
+}
+/*
+ * Shows how full the geometry arena is and draws every shape from it at once
+ */
+void createArenaGUI()
+{
+   if (!ImGui::CollapsingHeader("Geometry Arena"))
+   {
+      return;
+   }
+   ImGui::Checkbox("Draw All Shapes", &drawShapeRow);
+   ImGui::Text("%zu shapes: %zu draws in %zu draw calls (%s)", arenaStats.allocations, arenaStats.draws, arenaStats.drawCalls,
+               GeometryArena::isIndirectSupported() ? "multi-draw indirect" : "one per shape, no GL 4.3");
+   ImGui::Text("Vertices: %zu / %zu  Indices: %zu / %zu", arenaStats.verticesUsed, arenaStats.vertexCapacity,
+               arenaStats.indicesUsed, arenaStats.indexCapacity);
+   ImGui::Text("Free blocks: %zu  Defragmentations: %zu", arenaStats.freeBlocks, arenaStats.defragmentations);
+   if (ImGui::Button("Defragment"))
+   {
+      shapeRegistry.getArena().Defragment();
+   }
+}
+/*
+ * Generates a shape in code, subdivided up to millions of triangles to see how loading and drawing scale
+ */
+void createGeneratorGUI()
+{
+   if (!ImGui::CollapsingHeader("Generate Shape"))
+   {
+      return;
+   }
+   int type = static_cast<int>(generatorSettings.type);
+   const char *names[static_cast<int>(PolyhedronType::Count)];
+   for (int index = 0; index < static_cast<int>(PolyhedronType::Count); index++)
+   {
+      names[index] = getPolyhedronName(static_cast<PolyhedronType>(index));
+   }
+   if (ImGui::Combo("Polyhedron", &type, names, static_cast<int>(PolyhedronType::Count)))
+   {
+      generatorSettings.type = static_cast<PolyhedronType>(type);
+   }
+   int frequency = static_cast<int>(generatorSettings.frequency);
+   if (ImGui::SliderInt("Frequency", &frequency, 1, 1024, "%d", ImGuiSliderFlags_Logarithmic))
+   {
+      generatorSettings.frequency = static_cast<std::uint32_t>(frequency);
+   }
+   ImGui::Checkbox("Spherical", &generatorSettings.spherical);
+   ImGui::Text("Triangles: %zu", getPolyhedronTriangleCount(generatorSettings));
+   if (ImGui::Button("Generate"))
+   {
+      std::string name = std::string(getPolyhedronName(generatorSettings.type)) + " x" + std::to_string(generatorSettings.frequency);
+      if (generatorSettings.spherical)
+      {
+         name += " (spherical)";
+      }
+      currentShapeIndex = shapeRegistry.LoadPolyhedron(assetPipeline, name.c_str(), generatorSettings);
+   }
+}
+/*
+ * Shows how long each stage of asset loading takes so we can see where load time goes
+ */
+void createLoadingGUI()
+{
+   if (!ImGui::CollapsingHeader("Asset Loading"))
+   {
+      return;
+   }
+   ImGui::Text("In flight: %d", assetPipeline.getInFlight());
+   // the disk usage is only measured again when something was written or deleted
+   static MeshCacheUsage meshCacheUsage = shapeRegistry.getMeshCache().getUsage();
+   static std::size_t meshCacheWrites = 0;
+   MeshCacheStats meshCacheStats = shapeRegistry.getMeshCache().getStats();
+   if (meshCacheStats.stores + meshCacheStats.evictions != meshCacheWrites)
+   {
+      meshCacheWrites = meshCacheStats.stores + meshCacheStats.evictions;
+      meshCacheUsage = shapeRegistry.getMeshCache().getUsage();
+   }
+   ImGui::Text("Mesh cache: %zu hits  %zu misses  %zu stores  %zu evicted  %zu entries (%.1f KB)", meshCacheStats.hits,
+               meshCacheStats.misses, meshCacheStats.stores, meshCacheStats.evictions, meshCacheUsage.entries,
+               meshCacheUsage.bytes / 1024.0);
+   if (ImGui::Button("Clear Mesh Cache"))
+   {
+      shapeRegistry.getMeshCache().Clear();
+      meshCacheUsage = shapeRegistry.getMeshCache().getUsage();
+   }
+   const ProgramCacheStats &programCacheStats = ProgramCache::getShared().getStats();
+   ImGui::Text("Shader: %.2f ms %s", shaderBuildMilliseconds, shaderFromProgramCache ? "(program cache)" : "(compiled)");
+   ImGui::Text("Shader compiler: %s, %zu programs building", parallelShaderCompile ? "parallel" : "serial", shadersBuilding);
+   ImGui::Text("Shader variants: %zu keys  %zu programs  %zu shared", shaderVariantStats.variants,
+               shaderVariantStats.programs, shaderVariantStats.shared);
+   ImGui::Text("Program cache: %s  %zu hits  %zu misses  %zu stores  %zu rejected",
+               ProgramCache::getShared().isSupported() ? "on" : "unsupported", programCacheStats.hits,
+               programCacheStats.misses, programCacheStats.stores, programCacheStats.rejected);
+   ImGui::Text("Hot reloads: %llu  last %.1f ms  mean %.1f ms  (file write to frame)",
+               static_cast<unsigned long long>(reloadLatency.getCount()), lastReloadMilliseconds,
+               reloadLatency.getMeanMicroseconds() / 1000.0);
+   for (int stage = 0; stage < static_cast<int>(LoadStage::Count); stage++)
+   {
+      LatencyHistogram &histogram = assetPipeline.getHistogram(static_cast<LoadStage>(stage));
+      const char *name = getLoadStageName(static_cast<LoadStage>(stage));
+      ImGui::Text("%-6s n=%llu mean %.0f us  p50 <%.0f us  p95 <%.0f us  max %.0f us", name,
+                  static_cast<unsigned long long>(histogram.getCount()), histogram.getMeanMicroseconds(),
+                  histogram.getPercentileMicroseconds(0.5), histogram.getPercentileMicroseconds(0.95),
+                  histogram.getMaxMicroseconds());
+      std::array<float, LatencyHistogram::BUCKET_COUNT> buckets = histogram.getBuckets();
+      ImGui::PushID(stage);
+      ImGui::PlotHistogram("##buckets", buckets.data(), buckets.size(), 0, "log2 us buckets", 0.0f, FLT_MAX, ImVec2(0, 40));
+      ImGui::PopID();
+   }
+}
 /* Function for deleting the GUI */
 void deleteGUI()
 {
@@ -349,6 +990,12 @@ void resetParameters()
    cameraPosition = glm::vec3(0.0f, 0.0f, -2.2f);
 }
 
+/* Makes the render state the shape is drawn with from the GUI settings */
+void bakeShapeRenderState()
+{
+   shapeRenderState = RenderState(isWireframe ? GL_LINE : GL_FILL, faceCulling, antialiasing, true);
+}
+
 /* This is used for buttons that are only pressed once and don't constantly update stuff*/
 void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods) {
    if (action == GLFW_PRESS)
@@ -363,17 +1010,17 @@ void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods
       }
       if (key == GLFW_KEY_SPACE)
       {
-         currentShapeIndex = (currentShapeIndex + 1) % shapes.size();
+         currentShapeIndex = (currentShapeIndex + 1) % shapeRegistry.getCount();
       }
       if (key == GLFW_KEY_W)
       {
          isWireframe = true;
-         glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+         bakeShapeRenderState();
       }
       if (key == GLFW_KEY_F)
       {
          isWireframe = false;
-         glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+         bakeShapeRenderState();
       }
       if (key == GLFW_KEY_ESCAPE)
       {
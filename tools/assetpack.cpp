@@ -0,0 +1,75 @@
+/* assetpack puts every file under one or more asset folders into a single asset pack, which the demo maps at
+ * startup instead of opening each asset on its own. A file in a later folder replaces one with the same name
+ * in an earlier folder, so the cooked meshes from the build folder can be layered over the source assets.
+ *
+ * Usage:
+ *   assetpack <output.pack> <assets directory>...
+ *   assetpack --list <input.pack>
+ */
+#include "../include/AssetPack.h"
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+static const int SUCCESS = 0;
+static const int FAILURE = 1;
+
+static void list(const char *path)
+{
+    AssetPack pack(path);
+    for (std::size_t i = 0; i < pack.getCount(); i++)
+    {
+        const AssetPackEntry &entry = pack.getEntries()[i];
+        std::cout << pack.getName(entry) << ": " << getAssetTypeName(static_cast<AssetType>(entry.type)) << ", "
+                  << entry.size << " bytes at " << entry.offset << std::endl;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<std::string> args(argv + 1, argv + argc);
+    try
+    {
+        if (args.size() == 2 && args[0] == "--list")
+        {
+            list(args[1].c_str());
+            return SUCCESS;
+        }
+        if (args.size() >= 2)
+        {
+            std::map<std::string, AssetPackSource> sources;
+            for (std::size_t root = 1; root < args.size(); root++)
+            {
+                for (AssetPackSource &source : listAssetFiles(args[root].c_str()))
+                {
+                    sources[source.name] = source;
+                }
+            }
+            std::vector<AssetPackSource> files;
+            for (const auto &[name, source] : sources)
+            {
+                files.push_back(source);
+            }
+            writeAssetPack(args[0].c_str(), files);
+
+            AssetPack pack(args[0].c_str());
+            std::size_t bytes = 0;
+            for (std::size_t i = 0; i < pack.getCount(); i++)
+            {
+                bytes += pack.getEntries()[i].size;
+            }
+            std::cout << args[0] << ": " << pack.getCount() << " assets, " << bytes << " bytes" << std::endl;
+            return SUCCESS;
+        }
+    }
+    catch (const std::exception &error)
+    {
+        std::cerr << "assetpack: " << error.what() << std::endl;
+        return FAILURE;
+    }
+    std::cerr << "Usage: assetpack <output.pack> <assets directory>...\n"
+              << "       assetpack --list <input.pack>" << std::endl;
+    return FAILURE;
+}
@@ -0,0 +1,138 @@
+/* shapecook converts the Vertices/Indices text files used by the demo into the binary mesh format that
+ * Shape can map and upload directly. Meshes are optimized for the vertex cache and overdraw on the way, and
+ * get a chain of simplified LODs. --compress stores the vertices and indices as MeshCodec streams, which is
+ * worth it for big meshes that are read from a cold disk.
+ *
+ * Usage:
+ *   shapecook [--weld-epsilon <epsilon>] [--compress] <vertices.txt> <indices.txt> <output.mesh>
+ *   shapecook [--weld-epsilon <epsilon>] [--compress] --assets <assets/data directory> <output directory>
+ */
+#include "../include/MeshFile.h"
+#include "../include/MeshOptimizer.h"
+#include "../include/MeshParser.h"
+#include "../include/MeshSimplifier.h"
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+static const int SUCCESS = 0;
+static const int FAILURE = 1;
+
+static void cook(const fs::path &verticesPath, const fs::path &indicesPath, const fs::path &outputPath, float weldEpsilon,
+                 bool compress)
+{
+    std::vector<float> vertices = readVertexFile(verticesPath.c_str());
+    std::vector<std::uint32_t> indices = readIndexFile(indicesPath.c_str());
+    // writeMeshFile checks these too, but the optimizer needs a valid mesh first
+    if (vertices.size() % 6 != 0)
+    {
+        throw std::runtime_error("Vertex data in " + verticesPath.string() + " is not a multiple of 6 floats");
+    }
+    for (std::uint32_t index : indices)
+    {
+        if (index >= vertices.size() / 6)
+        {
+            throw std::runtime_error("Index " + std::to_string(index) + " is out of range in " + indicesPath.string());
+        }
+    }
+    MeshOptimizationReport report = optimizeMesh(vertices, indices, weldEpsilon);
+    std::vector<MeshFileLod> lods;
+    for (const LodLevel &level : buildLodChain(vertices, indices))
+    {
+        lods.push_back({level.indexOffset, level.indexCount, level.error, 0});
+    }
+    writeMeshFile(outputPath.c_str(), vertices.data(), vertices.size(), indices.data(), indices.size(), lods.data(), lods.size(),
+                  compress);
+
+    MappedMesh mesh(outputPath.c_str());
+    if (!mesh.verifyChecksum())
+    {
+        throw std::runtime_error("Checksum mismatch after writing " + outputPath.string());
+    }
+    std::cout << outputPath.string() << ": " << mesh.getHeader().vertexCount << " vertices, "
+              << mesh.getHeader().indexCount << " indices, welded " << report.weld.verticesRemoved << " vertices ("
+              << report.weld.bytesRemoved << " bytes), ACMR " << report.before.acmr << " -> " << report.after.acmr
+              << ", ATVR " << report.before.atvr << " -> " << report.after.atvr << ", " << lods.size() << " LODs";
+    if (compress)
+    {
+        std::size_t rawBytes = vertices.size() * sizeof(float) + indices.size() * sizeof(std::uint32_t);
+        std::size_t storedBytes = mesh.getHeader().vertexBytes + mesh.getHeader().indexBytes;
+        std::cout << ", compressed " << rawBytes << " -> " << storedBytes << " bytes";
+    }
+    std::cout << std::endl;
+    for (std::size_t level = 1; level < lods.size(); level++)
+    {
+        std::cout << "  LOD " << level << ": " << lods[level].indexCount / 3 << " triangles, error " << lods[level].error << std::endl;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<std::string> args(argv + 1, argv + argc);
+    try
+    {
+        float weldEpsilon = WELD_EPSILON;
+        bool compress = false;
+        while (!args.empty())
+        {
+            if (args.size() >= 2 && args[0] == "--weld-epsilon")
+            {
+                try
+                {
+                    weldEpsilon = std::stof(args[1]);
+                }
+                catch (const std::logic_error &)
+                {
+                    throw std::runtime_error("Invalid weld epsilon " + args[1]);
+                }
+                args.erase(args.begin(), args.begin() + 2);
+            }
+            else if (args[0] == "--compress")
+            {
+                compress = true;
+                args.erase(args.begin());
+            }
+            else
+            {
+                break;
+            }
+        }
+        if (args.size() == 3 && args[0] == "--assets")
+        {
+            // every Vertices/<name>.txt with a matching Indices/<name>.txt becomes <output>/<name>.mesh
+            fs::path dataPath = args[1];
+            fs::path outputPath = args[2];
+            fs::create_directories(outputPath);
+            for (const fs::directory_entry &entry : fs::directory_iterator(dataPath / "Vertices"))
+            {
+                fs::path indicesPath = dataPath / "Indices" / entry.path().filename();
+                if (entry.path().extension() != ".txt" || !fs::exists(indicesPath))
+                {
+                    continue;
+                }
+                fs::path meshPath = outputPath / entry.path().stem();
+                meshPath += ".mesh";
+                cook(entry.path(), indicesPath, meshPath, weldEpsilon, compress);
+            }
+            return SUCCESS;
+        }
+        if (args.size() == 3)
+        {
+            cook(args[0], args[1], args[2], weldEpsilon, compress);
+            return SUCCESS;
+        }
+    }
+    catch (const std::exception &error)
+    {
+        std::cerr << "shapecook: " << error.what() << std::endl;
+        return FAILURE;
+    }
+    std::cerr << "Usage: shapecook [--weld-epsilon <epsilon>] [--compress] <vertices.txt> <indices.txt> <output.mesh>\n"
+              << "       shapecook [--weld-epsilon <epsilon>] [--compress] --assets <assets/data directory> <output directory>" << std::endl;
+    return FAILURE;
+}